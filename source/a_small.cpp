@@ -884,8 +884,7 @@ static bool SM_WaitFinished(sc_callback_t *callback)
       {
          int secnum = -1;
          
-         while((secnum = P_FindSectorFromTag(callback->wait_data, 
-                                             secnum)) >= 0)
+         P_FOR_SECTORS_WITH_TAG(callback->wait_data, secnum)
          {
             sector_t *sec = &sectors[secnum];
             if(sec->floordata || sec->ceilingdata || sec->lightingdata)
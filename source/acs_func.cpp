@@ -706,7 +706,7 @@ static void ACS_funcSectorDamage(ACS_FUNCARG)
    int       secnum = -1;
    sector_t *sector;
 
-   while((secnum = P_FindSectorFromTag(tag, secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(tag, secnum)
    {
       sector = &sectors[secnum];
 
@@ -823,6 +823,9 @@ static void ACS_setLineBlocking(int tag, int block)
          break;
       }
    }
+
+   // block-all lines block sight
+   P_InvalidateSightCache();
 }
 
 //
@@ -1425,7 +1428,7 @@ static int32_t ACS_thingCountSector(int32_t tag, mobjtype_t type, int32_t tid)
    int count = 0;
    int secnum = -1;
 
-   while((secnum = P_FindSectorFromTag(tag, secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(tag, secnum)
    {
       sector = &sectors[secnum];
 
@@ -256,7 +256,7 @@ static bool ACS_checkTag(ACSThinker *th)
    int tag = static_cast<int>(th->sdata);
    int secnum = -1;
 
-   while((secnum = P_FindSectorFromTag(tag, secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(tag, secnum)
    {
       sector_t *sec = &sectors[secnum];
       if(sec->floordata || sec->ceilingdata)
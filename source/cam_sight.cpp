@@ -66,6 +66,7 @@
 #include "m_fixed.h"
 #include "p_chase.h"
 #include "p_maputl.h"
+#include "p_pvs.h"
 #include "p_setup.h"
 #include "polyobj.h"
 #include "r_defs.h"
@@ -95,13 +96,18 @@ public:
    fixed_t openbottom;  // bottom of linedef silhouette
    fixed_t openrange;   // height of opening
 
-   // Intercepts vector
-   PODCollection<intercept_t> intercepts;
+   // Intercepts array
+   intercept_t *intercepts;
+   size_t       numintercepts;
+   size_t       maxintercepts;
 
    // linedef validcount substitute
    byte *validlines;
    byte *validpolys;
 
+   // worker thread storage, or NULL on the main thread
+   camsightscratch_t *scratch;
+
    // portal traversal information
    int  fromid;        // current source group id
    int  toid;          // group id of the target
@@ -113,29 +119,74 @@ public:
    // pointer to invocation parameters
    const camsightparams_t *params;
 
-   CamSight(const camsightparams_t &sp)
+   CamSight(const camsightparams_t &sp, camsightscratch_t *pScratch = NULL)
       : cx(sp.cx), cy(sp.cy), tx(sp.tx), ty(sp.ty), 
         opentop(0), openbottom(0), openrange(0),
-        intercepts(),
+        intercepts(NULL), numintercepts(0), maxintercepts(0),
+        scratch(pScratch),
         fromid(sp.cgroupid), toid(sp.tgroupid), 
         hitpblock(false), addedportal(false), 
         portalresult(false), portalexit(false),
         params(&sp)
    {
+      size_t lineslen = ((numlines + 7) & ~7) / 8;
+      size_t polyslen = ((numPolyObjects + 7) & ~7) / 8;
+
       memset(&trace, 0, sizeof(trace));
     
       sightzstart = params->cz + params->cheight - (params->cheight >> 2);
       bottomslope = params->tz - sightzstart;
       topslope    = bottomslope + params->theight;
 
-      validlines = ecalloc(byte *, 1, ((numlines + 7) & ~7) / 8);
-      validpolys = ecalloc(byte *, 1, ((numPolyObjects + 7) & ~7) / 8);
+      if(scratch)
+      {
+         validlines    = scratch->validlines;
+         validpolys    = scratch->validpolys;
+         intercepts    = scratch->intercepts;
+         maxintercepts = scratch->maxintercepts;
+         memset(validlines, 0, lineslen);
+         memset(validpolys, 0, polyslen);
+      }
+      else
+      {
+         validlines = ecalloc(byte *, 1, lineslen);
+         validpolys = ecalloc(byte *, 1, polyslen);
+      }
    }
 
    ~CamSight()
    {
-      efree(validlines);
-      efree(validpolys);
+      if(!scratch)
+      {
+         efree(validlines);
+         efree(validpolys);
+         if(intercepts)
+            efree(intercepts);
+      }
+   }
+
+   //
+   // addIntercept
+   //
+   // Returns NULL if worker storage is exhausted.
+   //
+   intercept_t *addIntercept()
+   {
+      if(numintercepts >= maxintercepts)
+      {
+         if(scratch)
+         {
+            scratch->failed = true;
+            return NULL;
+         }
+         maxintercepts = maxintercepts ? maxintercepts * 2 : 32;
+         intercepts = erealloc(intercept_t *, intercepts, 
+                               maxintercepts * sizeof(intercept_t));
+      }
+
+      intercept_t *in = &intercepts[numintercepts++];
+      memset(in, 0, sizeof(*in));
+      return in;
    }
 };
 
@@ -268,6 +319,13 @@ static bool CAM_SightTraverse(CamSight &cam, intercept_t *in)
    if(li->pflags & PS_PASSABLE)
    {
       camsightparams_t params;
+
+      // recursion allocates; leave this check to the main thread
+      if(cam.scratch)
+      {
+         cam.scratch->failed = true;
+         return false;
+      }
       int newfromid = li->portal->data.link.toid;
 
       if(newfromid == cam.fromid) // not taking us anywhere...
@@ -343,7 +401,10 @@ static bool CAM_SightCheckLine(CamSight &cam, int linenum)
    }
 
    // store the line for later intersection testing
-   cam.intercepts.addNew().d.line = ld;
+   intercept_t *in = cam.addIntercept();
+   if(!in)
+      return false;
+   in->d.line = ld;
 
    // if this is a passable portal line, remember we just added it
    if(ld->pflags & PS_PASSABLE)
@@ -437,15 +498,15 @@ static bool CAM_SightTraverseIntercepts(CamSight &cam)
    size_t    count;
    fixed_t   dist;
    divline_t dl;
-   PODCollection<intercept_t>::iterator scan, end, in;
+   intercept_t *scan, *end, *in;
 
-   count = cam.intercepts.getLength();
-   end   = cam.intercepts.end();
+   count = cam.numintercepts;
+   end   = cam.intercepts + cam.numintercepts;
 
    //
    // calculate intercept distance
    //
-   for(scan = cam.intercepts.begin(); scan < end; scan++)
+   for(scan = cam.intercepts; scan < end; scan++)
    {
       P_MakeDivline(scan->d.line, &dl);
       scan->frac = P_InterceptVector(&cam.trace, &dl);
@@ -460,7 +521,7 @@ static bool CAM_SightTraverseIntercepts(CamSight &cam)
    {
       dist = D_MAXINT;
 
-      for(scan = cam.intercepts.begin(); scan < end; scan++)
+      for(scan = cam.intercepts; scan < end; scan++)
       {
          if(scan->frac < dist)
          {
@@ -666,12 +727,13 @@ static bool CAM_SightPathTraverse(CamSight &cam)
 }
 
 //
-// CAM_CheckSight
+// CAM_checkSight
 //
 // Returns true if a straight line between the camera location and a
 // thing's coordinates is unobstructed.
 //
-bool CAM_CheckSight(const camsightparams_t &params)
+static bool CAM_checkSight(const camsightparams_t &params, 
+                           camsightscratch_t *scratch)
 {
    sector_t *csec, *tsec;
    int s1, s2, pnum;
@@ -693,7 +755,9 @@ bool CAM_CheckSight(const camsightparams_t &params)
    s2   = (tsec = R_PointInSubsector(params.tx, params.ty)->sector) - sectors;
    pnum = s1 * numsectors + s2;
 	
-   if(link || !(rejectmatrix[pnum >> 3] & (1 << (pnum & 7))))
+   // also consult the PVS, which may reject pairs that REJECT does not
+   if(link || (!(rejectmatrix[pnum >> 3] & (1 << (pnum & 7))) &&
+               P_PVSCheckSight(s1, s2)))
    {
       // killough 4/19/98: make fake floors and ceilings block monster view
       if((csec->heightsec != -1 &&
@@ -712,7 +776,7 @@ bool CAM_CheckSight(const camsightparams_t &params)
       //
       // check precisely
       //
-      CamSight newCam(params);
+      CamSight newCam(params, scratch);
 
       // if there is a valid portal link, adjust the target's coordinates now
       // so that we trace in the proper direction given the current link
@@ -738,5 +802,58 @@ bool CAM_CheckSight(const camsightparams_t &params)
    return result;
 }
 
+//
+// CAM_CheckSight
+//
+bool CAM_CheckSight(const camsightparams_t &params)
+{
+   return CAM_checkSight(params, NULL);
+}
+
+//
+// CAM_InitSightScratch
+//
+// Size worker thread storage for the current level. Must be called on the
+// main thread.
+//
+#define SCRATCHINTERCEPTS 1024
+
+void CAM_InitSightScratch(camsightscratch_t &scratch)
+{
+   size_t lineslen = ((numlines + 7) & ~7) / 8 + 1;
+   size_t polyslen = ((numPolyObjects + 7) & ~7) / 8 + 1;
+
+   if(scratch.lineslen < lineslen)
+   {
+      scratch.validlines = erealloc(byte *, scratch.validlines, lineslen);
+      scratch.lineslen   = lineslen;
+   }
+   if(scratch.polyslen < polyslen)
+   {
+      scratch.validpolys = erealloc(byte *, scratch.validpolys, polyslen);
+      scratch.polyslen   = polyslen;
+   }
+   if(!scratch.intercepts)
+   {
+      scratch.intercepts    = emalloc(intercept_t *, 
+                                      SCRATCHINTERCEPTS * sizeof(intercept_t));
+      scratch.maxintercepts = SCRATCHINTERCEPTS;
+   }
+}
+
+//
+// CAM_CheckSightScratch
+//
+// As CAM_CheckSight, but safe to call from a worker thread while the
+// main thread is not modifying the level. If scratch.failed is set
+// afterward, the result is meaningless.
+//
+bool CAM_CheckSightScratch(const camsightparams_t &params, 
+                           camsightscratch_t &scratch)
+{
+   scratch.failed = false;
+   return CAM_checkSight(params, &scratch);
+}
+
 // EOF
 
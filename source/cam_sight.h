@@ -29,9 +29,11 @@
 #ifndef CAM_SIGHT_H__
 #define CAM_SIGHT_H__
 
+#include "doomtype.h"
 #include "m_fixed.h"
 
 struct camera_t;
+struct intercept_t;
 class  Mobj;
 
 struct camsightparams_t
@@ -56,6 +58,29 @@ struct camsightparams_t
 
 bool CAM_CheckSight(const camsightparams_t &params);
 
+//
+// camsightscratch_t
+//
+// Storage for sight checks run on worker threads, which must not touch the
+// zone heap. It is allocated on the main thread for the current level. A
+// check that would need more room than it has, or would recurse through a
+// portal, sets failed and its result must be discarded.
+//
+struct camsightscratch_t
+{
+   byte        *validlines;
+   byte        *validpolys;
+   size_t       lineslen;      // bytes allocated for validlines
+   size_t       polyslen;      // bytes allocated for validpolys
+   intercept_t *intercepts;
+   size_t       maxintercepts;
+   bool         failed;
+};
+
+void CAM_InitSightScratch(camsightscratch_t &scratch);
+bool CAM_CheckSightScratch(const camsightparams_t &params, 
+                           camsightscratch_t &scratch);
+
 #endif
 
 // EOF
@@ -496,6 +496,7 @@ void D_LoadEDF(gfs_t *gfs)
 //
 static void D_reInitWadfiles()
 {
+   P_CancelLevelPrefetch(); // lump and texture numbers are about to change
    R_FreeData();
    E_ProcessNewEDF();      // haleyjd 03/24/10: process any new EDF lumps
    XL_ParseHexenScripts(); // haleyjd 03/27/11: process Hexen scripts
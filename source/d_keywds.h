@@ -40,6 +40,15 @@
 
 // haleyjd 04/13/11: C++ supports inline natively
 
+// Thread-local storage class. Used for the renderer's drawing state, of
+// which each worker thread needs its own copy. Older compilers we support
+// lack C++11 thread_local, so the extensions are used instead.
+#if defined(_MSC_VER)
+#define EE_THREADLOCAL __declspec(thread)
+#else
+#define EE_THREADLOCAL __thread
+#endif
+
 //
 // Non-standard function availability defines
 //
@@ -67,7 +67,9 @@
 #include "m_argv.h"
 #include "m_compare.h"
 #include "m_misc.h"
+#include "m_profile.h"
 #include "m_syscfg.h"
+#include "m_workers.h"
 #include "m_qstr.h"
 #include "mn_engin.h"
 #include "p_chase.h"
@@ -610,8 +612,11 @@ void D_Display()
             R_RenderPlayerView(&players[displayplayer], camera);
          }
          
-         ST_Drawer(scaledwindow.height == SCREENHEIGHT);  // killough 11/98
-         HU_Drawer();
+         {
+            ProfileScope profile(PROF_HUD);
+            ST_Drawer(scaledwindow.height == SCREENHEIGHT);  // killough 11/98
+            HU_Drawer();
+         }
          break;
       case GS_INTERMISSION:
          IN_Drawer();
@@ -709,12 +714,18 @@ void D_Display()
    if(d_drawfps)
       D_showDrawnFPS();
 
+   if(prof_active && !benchmark) // keep benchmark frames free of the overlay
+      M_ProfileDrawer();
+
 #ifdef INSTRUMENTED
    if(printstats)
       D_showMemStats();
 #endif
    
-   I_FinishUpdate();              // page flip or blit buffer
+   {
+      ProfileScope profile(PROF_BLIT);
+      I_FinishUpdate();           // page flip or blit buffer
+   }
 
    i_haltimer.EndDisplay();
 }
@@ -1421,6 +1432,16 @@ static void D_DoomInit()
    {
       if((p = M_CheckParm("-fastdemo")) && p < myargc-1)  // killough
          fastdemo = true;            // run at fastest speed possible
+      else if((p = M_CheckParm("-benchmark")) && p < myargc-1)
+      {
+         fastdemo  = true;
+         benchmark = BENCHMARK_FULL; // headless fastdemo with JSON results
+      }
+      else if((p = M_CheckParm("-simbench")) && p < myargc-1)
+      {
+         fastdemo  = true;
+         benchmark = BENCHMARK_PLAYSIM;
+      }
       else
          p = M_CheckParm("-timedemo");
    }
@@ -1513,15 +1534,15 @@ static void D_DoomInit()
 
    //jff 1/22/98 add command line parms to disable sound and music
    {
-      bool nosound = !!M_CheckParm("-nosound");
+      bool nosound = M_CheckParm("-nosound") || benchmark;
       nomusicparm  = nosound || M_CheckParm("-nomusic");
       nosfxparm    = nosound || M_CheckParm("-nosfx");
    }
    //jff end of sound/music command line parms
 
    // killough 3/2/98: allow -nodraw -noblit generally
-   nodrawers = !!M_CheckParm("-nodraw");
-   noblit    = !!M_CheckParm("-noblit");
+   nodrawers = M_CheckParm("-nodraw") || benchmark == BENCHMARK_PLAYSIM;
+   noblit    = M_CheckParm("-noblit") || benchmark; // draw offscreen only
 
    // haleyjd: need to do this before M_LoadDefaults
    C_InitPlayerName();
@@ -1641,6 +1662,9 @@ static void D_DoomInit()
    startupmsg("I_Init","Setting up machine state.");
    I_Init();
 
+   startupmsg("M_InitWorkers", "Starting worker threads.");
+   M_InitWorkers();
+
    // devparm override of early set graphics mode
    if(!textmode_startup && !devparm)
    {
@@ -1822,6 +1846,13 @@ static void D_DoomInit()
       G_DeferedPlayDemo(myargv[p]);
       singledemo = true;              // quit after one demo
    }
+   else if(((p = M_CheckParm("-benchmark")) || (p = M_CheckParm("-simbench"))) && 
+           ++p < myargc)
+   {
+      timingdemo = true;              // results are written as JSON on exit
+      G_DeferedPlayDemo(myargv[p]);
+      singledemo = true;
+   }
    else if((p = M_CheckParm("-timedemo")) && ++p < myargc)
    {
       // haleyjd 10/16/08: restored to MBF status
@@ -1905,6 +1936,9 @@ void D_DoomMain()
    // killough 12/98: inlined D_DoomLoop
    while(1)
    {
+      // close out the last frame's timings
+      M_ProfileFrame();
+
       // frame synchronous IO operations
       I_StartFrame();
 
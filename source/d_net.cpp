@@ -42,6 +42,7 @@
 #include "g_dmflag.h"
 #include "g_game.h"
 #include "hal/i_timer.h"
+#include "m_profile.h"
 #include "m_random.h"
 #include "mn_engin.h"
 #include "i_net.h"
@@ -292,6 +293,8 @@ void NetUpdate()
    int newtics;
    int realstart;
    int gameticdiv;
+
+   ProfileScope profile(PROF_NETUPDATE);
    
    // check time
    nowtime = i_haltimer.GetTime() / ticdup;
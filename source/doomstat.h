@@ -254,6 +254,14 @@ extern  bool singledemo;
 extern  bool timingdemo;
 // Run tick clock at fastest speed possible while playing demo.  killough
 extern  bool fastdemo;
+// Benchmark mode; results are written as JSON after a timed demo.
+enum
+{
+   BENCHMARK_NONE,
+   BENCHMARK_FULL,    // -benchmark: render every frame offscreen
+   BENCHMARK_PLAYSIM  // -simbench: run the playsim only
+};
+extern  int  benchmark;
 
 extern  gamestate_t  gamestate;
 
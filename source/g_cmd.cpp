@@ -98,6 +98,32 @@ CONSOLE_COMMAND(z_dumpcore, cf_hidden)
    Z_DumpCore();
 }
 
+// Show object pool occupancy
+CONSOLE_COMMAND(z_poolstats, 0)
+{
+   zpoolstats_t stats[128];
+   int numpools = Z_GetPoolStats(stats, earrlen(stats));
+   int totalused = 0, totalslots = 0;
+
+   if(!numpools)
+   {
+      C_Printf("No object pools are in use\n");
+      return;
+   }
+
+   C_Printf(FC_HI "size  slabs   used  total   peak\n");
+   for(int i = 0; i < numpools; i++)
+   {
+      C_Printf("%4u  %5d  %5d  %5d  %5d\n", 
+               (unsigned int)stats[i].slotsize, stats[i].numslabs,
+               stats[i].used, stats[i].total, stats[i].peak);
+      totalused  += stats[i].used;
+      totalslots += stats[i].total;
+   }
+   C_Printf(FC_HI "%d of %d slots in use (%d%%)\n", totalused, totalslots,
+            totalslots ? totalused * 100 / totalslots : 0);
+}
+
 CONSOLE_COMMAND(starttitle, cf_notnet)
 {
    // haleyjd 04/18/03
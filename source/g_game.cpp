@@ -60,6 +60,7 @@
 #include "m_argv.h"
 #include "m_collection.h"
 #include "m_misc.h"
+#include "m_profile.h"
 #include "m_random.h"
 #include "m_shots.h"
 #include "metaapi.h"
@@ -117,6 +118,7 @@ bool            sendpause;     // send a pause event next tic
 bool            sendsave;      // send a save event next tic
 bool            usergame;      // ok to save / end game
 bool            timingdemo;    // if true, exit with report on completion
+int             benchmark;     // if set, also write results as JSON
 bool            fastdemo;      // if true, run at full speed -- killough
 bool            nodrawers;     // for comparative timing purposes
 int             startgametic;
@@ -1236,6 +1238,9 @@ void G_DoPlayDemo(void)
          starttime = i_haltimer.GetRealTime();
          startgametic = gametic;
          first = 0;
+
+         if(benchmark)
+            M_ProfileBeginSession(benchmark == BENCHMARK_PLAYSIM);
       }
    }
 }
@@ -1490,6 +1495,45 @@ static bool G_doFinale()
    return true;
 }
 
+//
+// G_nextMapName
+//
+// Figures out the name and number of the map that follows the intermission.
+//
+static const char *G_nextMapName(int &nextmap)
+{
+   nextmap = wminfo.next+1;
+
+   // haleyjd: handle heretic hidden levels via missioninfo samelevel rules
+   if(GameModeInfo->missionInfo->sameLevels)
+   {
+      samelevel_t *sameLevel = GameModeInfo->missionInfo->sameLevels;
+      while(sameLevel->episode != -1)
+      {
+         if(gameepisode == sameLevel->episode && nextmap == sameLevel->map)
+         {
+            --nextmap; // return to same level by default
+            break;
+         }
+         ++sameLevel;
+      }
+   }
+   
+   // haleyjd: customizable secret exits
+   if(secretexit)
+   {
+      if(*LevelInfo.nextSecret)
+         return LevelInfo.nextSecret;
+   }
+   else
+   {
+      // haleyjd 12/14/01: don't use nextlevel for secret exits here either!
+      if(*LevelInfo.nextLevel)
+         return LevelInfo.nextLevel;
+   }
+
+   return G_GetNameForMap(gameepisode, nextmap);
+}
 
 //
 // G_DoCompleted
@@ -1587,45 +1631,19 @@ static void G_DoCompleted()
       memcpy(statcopy, &wminfo, sizeof(wminfo));
    
    IN_Start(&wminfo);
+
+   // start reading in the next level while the intermission is up
+   int nextmap;
+   P_StartLevelPrefetch(g_dir, G_nextMapName(nextmap));
 }
 
 static void G_DoWorldDone()
 {
+   P_CancelLevelPrefetch();
+
    idmusnum = -1; //jff 3/17/98 allow new level's music to be loaded
    gamestate = GS_LOADING;
-   gamemap = wminfo.next+1;
-
-   // haleyjd: handle heretic hidden levels via missioninfo samelevel rules
-   if(GameModeInfo->missionInfo->sameLevels)
-   {
-      samelevel_t *sameLevel = GameModeInfo->missionInfo->sameLevels;
-      while(sameLevel->episode != -1)
-      {
-         if(gameepisode == sameLevel->episode && gamemap == sameLevel->map)
-         {
-            --gamemap; // return to same level by default
-            break;
-         }
-         ++sameLevel;
-      }
-   }
-   
-   // haleyjd: customizable secret exits
-   if(secretexit)
-   {
-      if(*LevelInfo.nextSecret)
-         G_SetGameMapName(LevelInfo.nextSecret);
-      else
-         G_SetGameMapName(G_GetNameForMap(gameepisode, gamemap));
-   }
-   else
-   {
-      // haleyjd 12/14/01: don't use nextlevel for secret exits here either!
-      if(*LevelInfo.nextLevel)
-         G_SetGameMapName(LevelInfo.nextLevel);
-      else
-         G_SetGameMapName(G_GetNameForMap(gameepisode, gamemap));
-   }
+   G_SetGameMapName(G_nextMapName(gamemap));
 
    // haleyjd 10/24/10: if in Master Levels mode, see if the next map exists
    // in the wad directory, and if so, use it. Otherwise, return to the Master
@@ -2057,6 +2075,7 @@ void G_Ticker()
       {
       case GS_INTERMISSION:
          IN_Ticker();
+         P_RunLevelPrefetch();
          break;
       case GS_FINALE:
          F_Ticker();
@@ -3396,6 +3415,103 @@ void G_TimeDemo(const char *name, bool showmenu)
    timingdemo = true;      // show stats after quit   
 }
 
+//
+// G_writeJSONString
+//
+static void G_writeJSONString(FILE *f, const char *s)
+{
+   fputc('"', f);
+   for(; *s; s++)
+   {
+      if(*s == '"' || *s == '\\')
+         fputc('\\', f);
+      fputc(*s, f);
+   }
+   fputc('"', f);
+}
+
+//
+// G_writeBenchmark
+//
+// Writes the results of a -benchmark run as JSON to the file named with
+// -benchout, or to benchmark.json, and exits.
+//
+static void G_writeBenchmark()
+{
+   const char   *filename = "benchmark.json";
+   unsigned int  tics = (unsigned int)(gametic - startgametic);
+   profsummary_t summary;
+   double        fps, ticrate;
+   FILE         *f;
+   int           p;
+
+   if((p = M_CheckParm("-benchout")) && p < myargc - 1)
+      filename = myargv[p + 1];
+
+   if(!M_ProfileGetSummary(summary))
+      I_Error("G_writeBenchmark: no frames were timed\n");
+
+   if(!(f = fopen(filename, "w")))
+      I_Error("G_writeBenchmark: could not open %s for writing\n", filename);
+
+   fps     = summary.seconds > 0.0 ? summary.frames / summary.seconds : 0.0;
+   ticrate = summary.seconds > 0.0 ? tics / summary.seconds : 0.0;
+
+   fputs("{\n  \"demo\": ", f);
+   G_writeJSONString(f, defdemoname);
+   fprintf(f, ",\n  \"gametics\": %u,\n", tics);
+   fprintf(f, "  \"frames\": %d,\n", summary.frames);
+   fprintf(f, "  \"seconds\": %.3f,\n", summary.seconds);
+   fprintf(f, "  \"fps\": %.2f,\n", fps);
+   fprintf(f, "  \"tics_per_second\": %.2f,\n", ticrate);
+   fprintf(f, "  \"frametime_ms\": { \"min\": %.3f, \"avg\": %.3f, "
+              "\"p99\": %.3f, \"max\": %.3f },\n",
+           summary.frameMin, summary.frameAvg, summary.frameP99, summary.frameMax);
+   fputs("  \"stages_ms\": {", f);
+   for(int i = 0; i < PROF_NUMSTAGES; i++)
+   {
+      fprintf(f, "%s\n    \"%s\": %.3f", i ? "," : "", 
+              M_ProfileStageName(i), summary.stageAvg[i]);
+   }
+   fputs("\n  }", f);
+
+   if(prof_thinkers)
+   {
+      PODCollection<profthinker_t> &classes = M_ProfileGetThinkers();
+
+      // count is the average number of live thinkers of the class per tic
+      fputs(",\n  \"thinkers\": [", f);
+      for(size_t i = 0; i < classes.getLength(); i++)
+      {
+         const profthinker_t &pt = classes[i];
+
+         fprintf(f, "%s\n    { \"class\": \"%s\", \"count\": %.1f, "
+                    "\"calls\": %llu, \"ms\": %.3f, \"ns_per_call\": %.1f }",
+                 i ? "," : "", pt.type->getName(), 
+                 tics ? (double)pt.calls / tics : 0.0,
+                 (unsigned long long)pt.calls, pt.time / 1000000.0, 
+                 pt.calls ? (double)pt.time / pt.calls : 0.0);
+      }
+      fputs("\n  ]", f);
+   }
+
+   fputs("\n}\n", f);
+   fclose(f);
+
+   if(benchmark == BENCHMARK_PLAYSIM)
+   {
+      I_ExitWithMessage("Simulated %u gametics in %.2f seconds = %-.1f tics per second\n"
+                        "Benchmark results written to %s\n", 
+                        tics, summary.seconds, ticrate, filename);
+   }
+   else
+   {
+      I_ExitWithMessage("Timed %u gametics in %d frames = %-.1f frames per second\n"
+                        "Benchmark results written to %s\n", 
+                        tics, summary.frames, fps, filename);
+   }
+}
+
 //
 // G_CheckDemoStatus
 //
@@ -3426,6 +3542,9 @@ bool G_CheckDemoStatus()
    {
       int endtime = i_haltimer.GetRealTime();
 
+      if(benchmark)
+         G_writeBenchmark();
+
       // killough -- added fps information and made it work for longer demos:
       unsigned int realtics = endtime - starttime;
       I_Error("Timed %u gametics in %u realtics = %-.1f frames per second\n",
@@ -0,0 +1,119 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    Hardware Abstraction Layer for read-only file mappings
+//
+//-----------------------------------------------------------------------------
+
+#include "../z_zone.h"
+
+#include "i_platform.h"
+#include "i_mmap.h"
+
+#if EE_CURRENT_PLATFORM == EE_PLATFORM_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#elif EE_CURRENT_PLATFORM != EE_PLATFORM_UNKNOWN
+#include <sys/mman.h>
+#define EE_POSIX_MMAP
+#endif
+
+//=============================================================================
+//
+// Global Interface
+//
+
+//
+// I_MapFile
+//
+// Map the first length bytes of an open file read-only. Returns false if the
+// platform cannot map it, in which case the caller must keep using stdio.
+// The FILE must stay open for as long as the mapping exists.
+//
+bool I_MapFile(FILE *f, size_t length, filemapping_t &mapping)
+{
+   mapping.data   = NULL;
+   mapping.length = 0;
+   mapping.handle = NULL;
+
+   if(!f || !length)
+      return false;
+
+#if EE_CURRENT_PLATFORM == EE_PLATFORM_WINDOWS
+   HANDLE hfile = (HANDLE)_get_osfhandle(_fileno(f));
+   HANDLE hmap;
+   void  *view;
+
+   if(hfile == INVALID_HANDLE_VALUE)
+      return false;
+
+   if(!(hmap = CreateFileMapping(hfile, NULL, PAGE_READONLY, 0, 0, NULL)))
+      return false;
+
+   if(!(view = MapViewOfFile(hmap, FILE_MAP_READ, 0, 0, length)))
+   {
+      CloseHandle(hmap);
+      return false;
+   }
+
+   mapping.data   = view;
+   mapping.length = length;
+   mapping.handle = hmap;
+   return true;
+#elif defined(EE_POSIX_MMAP)
+   void *view = mmap(NULL, length, PROT_READ, MAP_SHARED, fileno(f), 0);
+
+   if(view == MAP_FAILED)
+      return false;
+
+   mapping.data   = view;
+   mapping.length = length;
+   return true;
+#else
+   return false;
+#endif
+}
+
+//
+// I_UnmapFile
+//
+// Release a mapping made by I_MapFile. Any pointers into it become invalid.
+//
+void I_UnmapFile(filemapping_t &mapping)
+{
+   if(!mapping.data)
+      return;
+
+#if EE_CURRENT_PLATFORM == EE_PLATFORM_WINDOWS
+   UnmapViewOfFile(mapping.data);
+   CloseHandle((HANDLE)mapping.handle);
+#elif defined(EE_POSIX_MMAP)
+   munmap(const_cast<void *>(mapping.data), mapping.length);
+#endif
+
+   mapping.data   = NULL;
+   mapping.length = 0;
+   mapping.handle = NULL;
+}
+
+// EOF
+
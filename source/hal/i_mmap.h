@@ -0,0 +1,48 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    Hardware Abstraction Layer for read-only file mappings
+//
+//-----------------------------------------------------------------------------
+
+#ifndef I_MMAP_H__
+#define I_MMAP_H__
+
+//
+// filemapping_t
+//
+// A read-only view of an entire open file. handle is private to the
+// implementation.
+//
+struct filemapping_t
+{
+   const void *data;   // start of the mapped file
+   size_t      length; // number of bytes mapped
+   void       *handle; // platform mapping object, if any
+};
+
+bool I_MapFile(FILE *f, size_t length, filemapping_t &mapping);
+void I_UnmapFile(filemapping_t &mapping);
+
+#endif
+
+// EOF
+
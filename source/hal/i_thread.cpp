@@ -0,0 +1,131 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    Hardware Abstraction Layer for Threads
+//
+//-----------------------------------------------------------------------------
+
+#include "../z_zone.h"
+#include "../m_argv.h"
+
+#include "i_platform.h"
+#include "i_thread.h"
+
+#if EE_CURRENT_PLATFORM == EE_PLATFORM_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// drivers
+#ifdef _SDL_VER
+#include "../sdl/i_sdlthread.h"
+#endif
+
+// Singleton instance of HALThreads
+HALThreads i_halthreads;
+
+//=============================================================================
+//
+// Global Interface
+//
+
+typedef bool (*HAL_ThreadInitFunc)();
+
+//
+// HAL Thread Driver Struct
+//
+struct halthreaddriveritem_t
+{
+   int id;                  // HAL driver ID number
+   const char *name;        // name of driver
+   HAL_ThreadInitFunc Init; // pointer to driver init routine, if supported
+};
+
+static halthreaddriveritem_t halThreadDrivers[] =
+{
+   // SDL Thread Driver
+   {
+      0,
+      "SDL Threads",
+#ifdef _SDL_VER
+      I_SDLInitThreads
+#else
+      NULL
+#endif
+   },
+
+   // Dummy - leaves i_halthreads.Available false; all work is serial.
+   {
+      1,
+      "No Threads",
+      NULL
+   }
+};
+
+//
+// I_InitHALThreads
+//
+// Initialize the thread subsystem. The -nothreads parameter forces serial
+// operation, which is useful when chasing down suspected races.
+//
+void I_InitHALThreads()
+{
+   memset(&i_halthreads, 0, sizeof(i_halthreads));
+
+   if(M_CheckParm("-nothreads"))
+      return;
+
+   // choose the first available thread driver that initializes
+   for(size_t i = 0; i < earrlen(halThreadDrivers); i++)
+   {
+      if(halThreadDrivers[i].Init && halThreadDrivers[i].Init())
+      {
+         i_halthreads.Available = true;
+         break;
+      }
+   }
+}
+
+//
+// I_GetNumCPUs
+//
+// Returns the number of logical processors available, or 1 if it cannot be
+// determined.
+//
+int I_GetNumCPUs()
+{
+   int numcpus = 1;
+
+#if EE_CURRENT_PLATFORM == EE_PLATFORM_WINDOWS
+   SYSTEM_INFO info;
+   GetSystemInfo(&info);
+   numcpus = (int)info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+   numcpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+   return numcpus > 0 ? numcpus : 1;
+}
+
+// EOF
+
@@ -0,0 +1,76 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    Hardware Abstraction Layer for Threads
+//
+//-----------------------------------------------------------------------------
+
+#ifndef I_THREAD_H__
+#define I_THREAD_H__
+
+// Opaque handles; the implementing layer defines what these point to.
+struct HALThreadHandle;
+struct HALMutex;
+struct HALCondition;
+
+typedef int (*HAL_ThreadFunc)(void *);
+
+typedef HALThreadHandle *(*HAL_CreateThreadFunc)(HAL_ThreadFunc, void *);
+typedef void             (*HAL_WaitThreadFunc)(HALThreadHandle *);
+typedef HALMutex        *(*HAL_CreateMutexFunc)();
+typedef void             (*HAL_MutexFunc)(HALMutex *);
+typedef HALCondition    *(*HAL_CreateCondFunc)();
+typedef void             (*HAL_CondFunc)(HALCondition *);
+typedef void             (*HAL_CondWaitFunc)(HALCondition *, HALMutex *);
+
+//
+// HALThreads
+//
+// Like HALTimer, this is a POD structure with function pointers that is
+// initialized by the implementing layer. If no thread driver is available,
+// Available is false and callers must run their work serially on the main
+// thread instead.
+//
+struct HALThreads
+{
+   bool                 Available;     // true if a driver is installed
+   HAL_CreateThreadFunc CreateThread;  // start a thread running a function
+   HAL_WaitThreadFunc   WaitThread;    // join a thread
+   HAL_CreateMutexFunc  CreateMutex;   // create a mutex
+   HAL_MutexFunc        DestroyMutex;  // destroy a mutex
+   HAL_MutexFunc        LockMutex;     // lock a mutex
+   HAL_MutexFunc        UnlockMutex;   // unlock a mutex
+   HAL_CreateCondFunc   CreateCond;    // create a condition variable
+   HAL_CondFunc         DestroyCond;   // destroy a condition variable
+   HAL_CondWaitFunc     CondWait;      // wait on condition; mutex must be held
+   HAL_CondFunc         CondSignal;    // wake one waiter
+   HAL_CondFunc         CondBroadcast; // wake all waiters
+};
+
+extern HALThreads i_halthreads;
+
+void I_InitHALThreads();
+int  I_GetNumCPUs();
+
+#endif
+
+// EOF
+
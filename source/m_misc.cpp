@@ -60,6 +60,7 @@
 #include "hu_stuff.h"
 #include "i_sound.h"
 #include "i_video.h"
+#include "m_workers.h"
 #include "mn_engin.h"
 #include "mn_files.h"
 #include "mn_menus.h"
@@ -70,6 +71,7 @@
 #include "p_user.h"
 #include "r_draw.h"
 #include "r_main.h"
+#include "r_parallel.h"
 #include "r_sky.h"
 #include "r_things.h"
 #include "s_sound.h"
@@ -812,11 +814,14 @@ default_t defaults[] =
    
    DEFAULT_INT("r_columnengine",&r_column_engine_num, NULL, 
                1, 0, NUMCOLUMNENGINES - 1, default_t::wad_no, 
-               "0 = normal, 1 = optimized quad cache"),
+               "0 = normal, 1 = optimized quad cache, 2 = SSE2, 3 = wide cache"),
    
    DEFAULT_INT("r_spanengine",&r_span_engine_num, NULL,
                0, 0, NUMSPANENGINES - 1, default_t::wad_no, 
-               "0 = high precision, 1 = low precision"),
+               "0 = high precision, 1 = SSE2"),
+
+   DEFAULT_INT("r_threads", &r_numthreads, NULL, 0, 0, MAXWORKERTHREADS, default_t::wad_no,
+               "number of threads to draw with (0 = off)"),
 
    DEFAULT_INT("r_tlstyle", &r_tlstyle, NULL, 1, 0, R_TLSTYLE_NUM - 1, default_t::wad_yes,
                "Doom object translucency style (0 = none, 1 = Boom, 2 = new)"),
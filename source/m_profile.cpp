@@ -0,0 +1,406 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    Frame profiler.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+
+#include "c_io.h"
+#include "c_runcmd.h"
+#include "e_fonts.h"
+#include "m_profile.h"
+#include "m_qstr.h"
+#include "v_font.h"
+#include "v_misc.h"
+#include "hal/i_timer.h"
+
+// Number of frames kept for the overlay and CSV dumps
+#define PROF_HISTORY 256
+
+// Number of frames the overlay averages over
+#define PROF_AVERAGE 32
+
+struct profstage_t
+{
+   const char *name;
+   int         parent; // enclosing stage, or -1
+};
+
+static profstage_t profstages[PROF_NUMSTAGES] =
+{
+   { "playsim",   -1            },
+   { "thinkers",  PROF_PLAYSIM  },
+   { "netupdate", -1            },
+   { "render",    -1            },
+   { "bsp",       PROF_RENDER   },
+   { "segs",      PROF_RENDER   },
+   { "portals",   PROF_RENDER   },
+   { "planes",    PROF_RENDER   },
+   { "masked",    PROF_RENDER   },
+   { "deferred",  PROF_RENDER   },
+   { "hud",       -1            },
+   { "blit",      -1            },
+};
+
+struct profframe_t
+{
+   unsigned int frametime;                  // whole frame, in microseconds
+   unsigned int stagetime[PROF_NUMSTAGES];  // per stage, in microseconds
+};
+
+bool prof_active;          // timers are running this frame
+static bool prof_enabled;  // console toggle; takes effect on the next frame
+
+// current frame, in nanoseconds
+static uint64_t framestart;
+static uint64_t stagestart[PROF_NUMSTAGES];
+static uint64_t stagetime[PROF_NUMSTAGES];
+static int      stagedepth[PROF_NUMSTAGES];
+
+static profframe_t profhistory[PROF_HISTORY];
+static int         profhead;  // next slot to write
+static int         profcount; // number of valid frames
+
+// Session data keeps every frame rather than a window of recent ones
+static bool                        sessionactive;
+static PODCollection<unsigned int> sessionframes;
+static uint64_t                    sessionstages[PROF_NUMSTAGES];
+
+bool prof_thinkers; // time every Think() call by class
+
+static PODCollection<profthinker_t> thinkerclasses;
+static size_t                       lastclass;
+
+//
+// M_ProfileStart
+//
+void M_ProfileStart(int stage)
+{
+   if(!stagedepth[stage]++)
+      stagestart[stage] = i_haltimer.GetNanoseconds();
+}
+
+//
+// M_ProfileStop
+//
+void M_ProfileStop(int stage)
+{
+   if(stagedepth[stage] > 0 && !--stagedepth[stage])
+      stagetime[stage] += i_haltimer.GetNanoseconds() - stagestart[stage];
+}
+
+//
+// M_ProfileFrame
+//
+// Call once per pass through the main loop. Closes out the previous frame's
+// timings and starts the next frame. Turning the profiler on or off only
+// happens here, so that no timer is ever left half-open.
+//
+void M_ProfileFrame()
+{
+   uint64_t now;
+
+   if(!prof_active && !prof_enabled)
+      return;
+
+   now = i_haltimer.GetNanoseconds();
+
+   if(prof_active)
+   {
+      profframe_t &frame = profhistory[profhead];
+
+      frame.frametime = (unsigned int)((now - framestart) / 1000);
+      for(int i = 0; i < PROF_NUMSTAGES; i++)
+         frame.stagetime[i] = (unsigned int)(stagetime[i] / 1000);
+
+      profhead = (profhead + 1) % PROF_HISTORY;
+      if(profcount < PROF_HISTORY)
+         ++profcount;
+
+      if(sessionactive)
+      {
+         sessionframes.add(frame.frametime);
+         for(int i = 0; i < PROF_NUMSTAGES; i++)
+            sessionstages[i] += frame.stagetime[i];
+      }
+   }
+   else
+   {
+      // starting up; throw away the last session's history
+      profhead = profcount = 0;
+   }
+
+   memset(stagetime,  0, sizeof(stagetime));
+   memset(stagedepth, 0, sizeof(stagedepth));
+   
+   framestart  = now;
+   prof_active = prof_enabled;
+}
+
+//
+// M_ProfileStageName
+//
+const char *M_ProfileStageName(int stage)
+{
+   return profstages[stage].name;
+}
+
+//
+// M_ProfileBeginSession
+//
+// Turns the profiler on and starts keeping every frame from the next one
+// on, until the program exits. Timing every thinker is optional, since it
+// adds two clock reads per Think() call.
+//
+void M_ProfileBeginSession(bool timethinkers)
+{
+   prof_enabled  = true;
+   sessionactive = true;
+   sessionframes.makeEmpty();
+   memset(sessionstages, 0, sizeof(sessionstages));
+
+   prof_thinkers = timethinkers;
+   thinkerclasses.makeEmpty();
+   lastclass = 0;
+}
+
+static int M_compareFrameTimes(const void *a, const void *b)
+{
+   unsigned int ta = *(const unsigned int *)a;
+   unsigned int tb = *(const unsigned int *)b;
+
+   return ta < tb ? -1 : ta > tb;
+}
+
+//
+// M_ProfileGetSummary
+//
+// Returns false if no session frames have been recorded.
+//
+bool M_ProfileGetSummary(profsummary_t &summary)
+{
+   size_t numframes = sessionframes.getLength();
+   unsigned int *sorted;
+   double total = 0.0;
+
+   if(!numframes)
+      return false;
+
+   sorted = ecalloc(unsigned int *, numframes, sizeof(unsigned int));
+   for(size_t i = 0; i < numframes; i++)
+   {
+      sorted[i] = sessionframes[i];
+      total += sorted[i];
+   }
+   qsort(sorted, numframes, sizeof(unsigned int), M_compareFrameTimes);
+
+   summary.frames   = (int)numframes;
+   summary.seconds  = total / 1000000.0;
+   summary.frameMin = sorted[0] / 1000.0;
+   summary.frameAvg = total / numframes / 1000.0;
+   summary.frameP99 = sorted[(numframes * 99 + 99) / 100 - 1] / 1000.0;
+   summary.frameMax = sorted[numframes - 1] / 1000.0;
+
+   for(int i = 0; i < PROF_NUMSTAGES; i++)
+      summary.stageAvg[i] = (double)sessionstages[i] / numframes / 1000.0;
+
+   efree(sorted);
+   return true;
+}
+
+//
+// M_ProfileThinker
+//
+// Adds one Think() call of the given class.
+//
+void M_ProfileThinker(const RTTIObject::Type *type, uint64_t ns)
+{
+   size_t numclasses = thinkerclasses.getLength();
+
+   // thinkers of one class tend to come in runs, so try the last one first
+   if(lastclass >= numclasses || thinkerclasses[lastclass].type != type)
+   {
+      for(lastclass = 0; lastclass < numclasses; lastclass++)
+      {
+         if(thinkerclasses[lastclass].type == type)
+            break;
+      }
+
+      if(lastclass == numclasses)
+      {
+         profthinker_t newclass = { type, 0, 0 };
+         thinkerclasses.add(newclass);
+      }
+   }
+
+   thinkerclasses[lastclass].calls++;
+   thinkerclasses[lastclass].time += ns;
+}
+
+static int M_compareThinkerTimes(const void *a, const void *b)
+{
+   uint64_t ta = static_cast<const profthinker_t *>(a)->time;
+   uint64_t tb = static_cast<const profthinker_t *>(b)->time;
+
+   return ta > tb ? -1 : ta < tb;
+}
+
+//
+// M_ProfileGetThinkers
+//
+// Returns the per-class thinker statistics, most expensive class first.
+//
+PODCollection<profthinker_t> &M_ProfileGetThinkers()
+{
+   if(thinkerclasses.getLength() > 1)
+   {
+      qsort(&thinkerclasses[0], thinkerclasses.getLength(), 
+            sizeof(profthinker_t), M_compareThinkerTimes);
+   }
+   lastclass = 0;
+
+   return thinkerclasses;
+}
+
+//
+// M_profileFrameAt
+//
+// Returns the nth most recent frame.
+//
+static profframe_t &M_profileFrameAt(int n)
+{
+   return profhistory[(profhead - 1 - n + PROF_HISTORY) % PROF_HISTORY];
+}
+
+//
+// M_ProfileDrawer
+//
+// Draws average and peak times over recent frames for every stage.
+//
+void M_ProfileDrawer()
+{
+   vfont_t *font = E_FontForName("ee_consolefont");
+   int numframes = profcount < PROF_AVERAGE ? profcount : PROF_AVERAGE;
+   double total = 0.0;
+   char buffer[128];
+   int y = 1;
+
+   if(!numframes)
+      return;
+
+   for(int n = 0; n < numframes; n++)
+      total += M_profileFrameAt(n).frametime;
+   total /= numframes;
+
+   psnprintf(buffer, sizeof(buffer), "%-14s %7.2f ms %6.1f fps", "frame", 
+             total / 1000.0, total > 0.0 ? 1000000.0 / total : 0.0);
+   V_FontWriteText(font, buffer, 1, y);
+   y += font->cy;
+
+   for(int i = 0; i < PROF_NUMSTAGES; i++)
+   {
+      char   label[32];
+      int    depth = 0;
+      double avg = 0.0, pct;
+      unsigned int peak = 0;
+
+      for(int p = profstages[i].parent; p != -1; p = profstages[p].parent)
+         ++depth;
+
+      for(int n = 0; n < numframes; n++)
+      {
+         unsigned int t = M_profileFrameAt(n).stagetime[i];
+         avg += t;
+         if(t > peak)
+            peak = t;
+      }
+      avg /= numframes;
+      pct  = total > 0.0 ? avg * 100.0 / total : 0.0;
+
+      psnprintf(label, sizeof(label), "%*s%s", depth * 2, "", profstages[i].name);
+      psnprintf(buffer, sizeof(buffer), "%-14s %7.2f ms %6.2f max %5.1f%%", 
+                label, avg / 1000.0, peak / 1000.0, pct);
+      V_FontWriteText(font, buffer, 1, y);
+      y += font->cy;
+   }
+}
+
+//
+// M_profileDump
+//
+// Writes the frame history to a CSV file, oldest frame first, with all
+// times in microseconds.
+//
+static void M_profileDump(const char *filename)
+{
+   FILE *f;
+
+   if(!profcount)
+   {
+      C_Printf(FC_ERROR "No profile data; enable d_profile first\n");
+      return;
+   }
+
+   if(!(f = fopen(filename, "w")))
+   {
+      C_Printf(FC_ERROR "Could not open %s for writing\n", filename);
+      return;
+   }
+
+   fputs("frame,total", f);
+   for(int i = 0; i < PROF_NUMSTAGES; i++)
+      fprintf(f, ",%s", profstages[i].name);
+   fputc('\n', f);
+
+   for(int n = profcount - 1; n >= 0; n--)
+   {
+      profframe_t &frame = M_profileFrameAt(n);
+
+      fprintf(f, "%d,%u", profcount - 1 - n, frame.frametime);
+      for(int i = 0; i < PROF_NUMSTAGES; i++)
+         fprintf(f, ",%u", frame.stagetime[i]);
+      fputc('\n', f);
+   }
+
+   fclose(f);
+   C_Printf("Wrote %d frames to %s\n", profcount, filename);
+}
+
+//=============================================================================
+//
+// Console Commands
+//
+
+VARIABLE_TOGGLE(prof_enabled, NULL, onoff);
+CONSOLE_VARIABLE(d_profile, prof_enabled, 0) {}
+
+CONSOLE_COMMAND(d_profiledump, 0)
+{
+   if(!Console.argc)
+      C_Printf("usage: d_profiledump filename\n");
+   else
+      M_profileDump(Console.argv[0]->constPtr());
+}
+
+// EOF
+
@@ -0,0 +1,120 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    Frame profiler.
+//
+//    Scoped timers around the major stages of a frame, accumulated per
+//    frame into a history that can be shown as an overlay or dumped to a
+//    CSV file. Timers are only read while the profiler is enabled, and only
+//    from the main thread.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef M_PROFILE_H__
+#define M_PROFILE_H__
+
+#include "e_rtti.h"
+#include "m_collection.h"
+
+// Profiled stages. Times are inclusive: a stage's time contains the time
+// of every stage nested inside it.
+enum profstage_e
+{
+   PROF_PLAYSIM,   // P_Ticker
+   PROF_THINKERS,  //  Thinker::RunThinkers
+   PROF_NETUPDATE, // NetUpdate
+   PROF_RENDER,    // R_RenderPlayerView
+   PROF_BSP,       //  R_RenderBSPNode, main view only
+   PROF_SEGS,      //  R_StoreWallRange, in all views
+   PROF_PORTALS,   //  R_RenderPortals, everything in portal views
+   PROF_PLANES,    //  R_DrawPlanes, main view only
+   PROF_MASKED,    //  R_DrawPostBSP
+   PROF_DEFERRED,  //  R_FlushDeferred
+   PROF_HUD,       // ST_Drawer, HU_Drawer
+   PROF_BLIT,      // I_FinishUpdate
+   PROF_NUMSTAGES
+};
+
+//
+// Whole-session statistics, for benchmark runs. Times are in milliseconds.
+//
+struct profsummary_t
+{
+   int    frames;
+   double seconds;                  // sum of all frame times
+   double frameMin, frameAvg, frameP99, frameMax;
+   double stageAvg[PROF_NUMSTAGES]; // per frame
+};
+
+//
+// Per-class thinker statistics, kept by playsim benchmark sessions.
+//
+struct profthinker_t
+{
+   const RTTIObject::Type *type;
+   uint64_t calls; // number of Think() calls
+   uint64_t time;  // total time in nanoseconds
+};
+
+extern bool prof_active;
+extern bool prof_thinkers;
+
+void M_ProfileStart(int stage);
+void M_ProfileStop(int stage);
+void M_ProfileFrame();
+void M_ProfileDrawer();
+
+const char *M_ProfileStageName(int stage);
+void M_ProfileBeginSession(bool timethinkers);
+bool M_ProfileGetSummary(profsummary_t &summary);
+
+void M_ProfileThinker(const RTTIObject::Type *type, uint64_t ns);
+PODCollection<profthinker_t> &M_ProfileGetThinkers();
+
+//
+// ProfileScope
+//
+// Times the stage for as long as the object is in scope. Stages may be 
+// re-entered, as the BSP is by portals; only the outermost scope counts.
+//
+class ProfileScope
+{
+protected:
+   int stage;
+
+public:
+   explicit ProfileScope(int p_stage) : stage(p_stage)
+   {
+      if(prof_active)
+         M_ProfileStart(stage);
+   }
+
+   ~ProfileScope()
+   {
+      if(prof_active)
+         M_ProfileStop(stage);
+   }
+};
+
+#endif
+
+// EOF
+
@@ -0,0 +1,226 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    Worker thread pool. Runs batches of independent jobs across all
+//    available CPUs, with the calling thread participating in the batch.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+#include "hal/i_thread.h"
+#include "m_argv.h"
+#include "m_workers.h"
+
+static int numHelpers;                      // threads besides the main thread
+static int helperNums[MAXWORKERTHREADS];    // thread number for each helper
+static HALThreadHandle *helperThreads[MAXWORKERTHREADS];
+
+static HALMutex     *workMutex;
+static HALCondition *workCond;  // signalled when a new batch is posted
+static HALCondition *doneCond;  // signalled when a batch completes
+
+// Current batch; all protected by workMutex
+static workerfunc_t batchFunc;
+static void        *batchData;
+static int          batchJobs;
+static int          nextJob;
+static int          jobsDone;
+static unsigned int batchSerial;
+static bool         helpersQuit; // set at exit to stop the helpers
+
+//
+// M_doJobs
+//
+// Claim and run jobs from the current batch until none remain. Called with
+// workMutex held; the lock is dropped while each job runs.
+//
+static void M_doJobs(int threadnum)
+{
+   while(nextJob < batchJobs)
+   {
+      int job = nextJob++;
+
+      i_halthreads.UnlockMutex(workMutex);
+      batchFunc(job, threadnum, batchData);
+      i_halthreads.LockMutex(workMutex);
+
+      if(++jobsDone == batchJobs)
+         i_halthreads.CondSignal(doneCond);
+   }
+}
+
+//
+// M_workerThread
+//
+// Helper threads sleep until a batch is posted, then help drain it.
+//
+static int M_workerThread(void *data)
+{
+   int threadnum = *static_cast<int *>(data);
+   unsigned int lastSerial = 0;
+
+   i_halthreads.LockMutex(workMutex);
+   for(;;)
+   {
+      while(batchSerial == lastSerial && !helpersQuit)
+         i_halthreads.CondWait(workCond, workMutex);
+      if(helpersQuit)
+         break;
+      lastSerial = batchSerial;
+      M_doJobs(threadnum);
+   }
+   i_halthreads.UnlockMutex(workMutex);
+
+   return 0;
+}
+
+//
+// M_shutdownWorkers
+//
+// atexit handler. Stops and joins the helper threads, so that none of them
+// is left waiting on the pool's objects when they are destroyed.
+//
+static void M_shutdownWorkers()
+{
+   i_halthreads.LockMutex(workMutex);
+   helpersQuit = true;
+   i_halthreads.CondBroadcast(workCond);
+   i_halthreads.UnlockMutex(workMutex);
+
+   for(int i = 0; i < numHelpers; i++)
+      i_halthreads.WaitThread(helperThreads[i]);
+   numHelpers = 0;
+
+   i_halthreads.DestroyCond(doneCond);
+   i_halthreads.DestroyCond(workCond);
+   i_halthreads.DestroyMutex(workMutex);
+   doneCond  = NULL;
+   workCond  = NULL;
+   workMutex = NULL;
+}
+
+//
+// M_InitWorkers
+//
+// Start one helper thread per additional CPU. -workers <n> overrides the
+// total thread count; -workers 1 disables helpers entirely.
+//
+void M_InitWorkers()
+{
+   int numthreads, p;
+
+   if(!i_halthreads.Available)
+      return;
+
+   numthreads = I_GetNumCPUs();
+
+   if((p = M_CheckParm("-workers")) && p < myargc - 1)
+      numthreads = atoi(myargv[p + 1]);
+
+   if(numthreads > MAXWORKERTHREADS)
+      numthreads = MAXWORKERTHREADS;
+   if(numthreads <= 1)
+      return;
+
+   workMutex = i_halthreads.CreateMutex();
+   workCond  = i_halthreads.CreateCond();
+   doneCond  = i_halthreads.CreateCond();
+
+   if(!workMutex || !workCond || !doneCond)
+   {
+      if(doneCond)
+         i_halthreads.DestroyCond(doneCond);
+      if(workCond)
+         i_halthreads.DestroyCond(workCond);
+      if(workMutex)
+         i_halthreads.DestroyMutex(workMutex);
+      doneCond  = NULL;
+      workCond  = NULL;
+      workMutex = NULL;
+      return;
+   }
+
+   for(int i = 1; i < numthreads; i++)
+   {
+      HALThreadHandle *thread;
+
+      helperNums[numHelpers] = i;
+      if(!(thread = i_halthreads.CreateThread(M_workerThread, 
+                                              &helperNums[numHelpers])))
+         break;
+      helperThreads[numHelpers++] = thread;
+   }
+
+   atexit(M_shutdownWorkers);
+}
+
+//
+// M_NumWorkerThreads
+//
+// Returns the number of threads that may run jobs, including the main thread.
+//
+int M_NumWorkerThreads()
+{
+   return numHelpers + 1;
+}
+
+//
+// M_RunJobs
+//
+// Run a batch of jobs and wait for its completion. Without helpers the jobs
+// simply run in order on the calling thread.
+//
+void M_RunJobs(workerfunc_t func, void *data, int numjobs)
+{
+   if(numjobs <= 0)
+      return;
+
+   if(!numHelpers || numjobs == 1)
+   {
+      for(int i = 0; i < numjobs; i++)
+         func(i, 0, data);
+      return;
+   }
+
+   i_halthreads.LockMutex(workMutex);
+
+   batchFunc = func;
+   batchData = data;
+   batchJobs = numjobs;
+   nextJob   = 0;
+   jobsDone  = 0;
+   ++batchSerial;
+   i_halthreads.CondBroadcast(workCond);
+
+   M_doJobs(0);
+
+   while(jobsDone < batchJobs)
+      i_halthreads.CondWait(doneCond, workMutex);
+
+   batchFunc = NULL;
+   batchData = NULL;
+   batchJobs = 0;
+
+   i_halthreads.UnlockMutex(workMutex);
+}
+
+// EOF
+
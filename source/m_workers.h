@@ -0,0 +1,48 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    Worker thread pool. Runs batches of independent jobs across all
+//    available CPUs, with the calling thread participating in the batch.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef M_WORKERS_H__
+#define M_WORKERS_H__
+
+// Job callback. jobnum is in [0, numjobs); threadnum is in 
+// [0, M_NumWorkerThreads()) and is 0 for the main thread, so it may be used
+// to index per-thread scratch data.
+typedef void (*workerfunc_t)(int jobnum, int threadnum, void *data);
+
+// Maximum number of threads, including the main thread.
+#define MAXWORKERTHREADS 16
+
+void M_InitWorkers();
+int  M_NumWorkerThreads();
+
+// Run numjobs jobs and wait for all of them to complete. Must only be called
+// from the main thread, and is not reentrant.
+void M_RunJobs(workerfunc_t func, void *data, int numjobs);
+
+#endif
+
+// EOF
+
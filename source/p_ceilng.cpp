@@ -322,7 +322,7 @@ int EV_DoCeiling(line_t *line, ceiling_e type)
    }
   
    // affects all sectors with the same tag as the linedef
-   while((secnum = P_FindSectorFromLineTag(line,secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(line->tag, secnum)
    {
       sec = &sectors[secnum];
       
@@ -553,7 +553,7 @@ void P_ChangeCeilingTex(const char *name, int tag)
    if((flatnum = R_CheckForFlat(name)) == -1)
       return;
 
-   while((secnum = P_FindSectorFromTag(tag, secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(tag, secnum)
       P_SetSectorCeilingPic(&sectors[secnum], flatnum);
 }
 
@@ -41,11 +41,15 @@
 #include "m_random.h"
 #include "mn_engin.h"
 #include "p_anim.h"
+#include "p_enemy.h"
 #include "p_info.h"
 #include "p_map.h"
 #include "p_mobj.h"
 #include "p_inter.h"
+#include "p_pvs.h"
+#include "p_spatial.h"
 #include "p_spec.h"
+#include "p_tick.h"
 #include "p_user.h"
 #include "r_draw.h"
 #include "v_misc.h"
@@ -229,6 +233,30 @@ CONSOLE_NETVAR(nukage, enable_nuke, cf_server, netcmd_nukage) {}
 VARIABLE_TOGGLE(pitchedflight, &default_pitchedflight, onoff)
 CONSOLE_NETVAR(p_pitchedflight, pitchedflight, cf_server, netcmd_pitchedflight) {}
 
+// Run thinkers grouped by class outside of demos/netgames
+VARIABLE_TOGGLE(thinker_queues, NULL, onoff);
+CONSOLE_VARIABLE(p_thinkerqueues, thinker_queues, 0) {}
+
+// Let countdown thinkers skip idle tics
+VARIABLE_TOGGLE(thinker_dormancy, NULL, onoff);
+CONSOLE_VARIABLE(p_dormantthinkers, thinker_dormancy, 0) {}
+
+// Use Mobj spatial hash outside of demos/netgames
+VARIABLE_TOGGLE(spatial_hash, NULL, onoff);
+CONSOLE_VARIABLE(p_spatialhash, spatial_hash, 0) {}
+
+// Memoize P_CheckSight results within a tic
+VARIABLE_TOGGLE(sight_cache, NULL, onoff);
+CONSOLE_VARIABLE(p_sightcache, sight_cache, 0) {}
+
+// Sector PVS for sight rejection and render culling
+VARIABLE_TOGGLE(pvs_enable, NULL, onoff);
+CONSOLE_VARIABLE(p_pvs, pvs_enable, 0) {}
+
+// Precompute monster sight checks on worker threads
+VARIABLE_TOGGLE(ai_parallel, NULL, onoff);
+CONSOLE_VARIABLE(p_parallelai, ai_parallel, 0) {}
+
 // 'auto exit' variables
 
 VARIABLE_INT(levelTimeLimit,    NULL,           0, 100,         NULL);
@@ -369,5 +397,28 @@ CONSOLE_COMMAND(thunder, 0)
    P_ForceLightning();
 }
 
+// Sight cache hit rate; "p_sightstats reset" clears it
+CONSOLE_COMMAND(p_sightstats, 0)
+{
+   sightcachestats_t stats;
+
+   if(Console.argc >= 1 && !Console.argv[0]->strCaseCmp("reset"))
+   {
+      P_ResetSightCacheStats();
+      C_Printf("Sight cache statistics reset\n");
+      return;
+   }
+
+   P_GetSightCacheStats(stats);
+
+   C_Printf(FC_HI "Sight cache:\n"
+            FC_NORMAL "lookups: %u\nhits: %u (%u%%)\ninvalidations: %u\n"
+            "primed: %u\n",
+            stats.lookups, stats.hits, 
+            stats.lookups ? 
+               (unsigned int)((double)stats.hits * 100.0 / stats.lookups) : 0,
+            stats.invalidations, stats.primed);
+}
+
 // EOF
 
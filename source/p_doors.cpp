@@ -358,7 +358,7 @@ int EV_DoDoor(line_t *line, vldoor_e type)
    VerticalDoorThinker *door;
 
    // open all doors with the same tag as the activating line
-   while((secnum = P_FindSectorFromLineTag(line, secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(line->tag, secnum)
    {
       sec = &sectors[secnum];
       // if the ceiling already moving, don't start the door action
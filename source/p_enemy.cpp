@@ -34,6 +34,7 @@
 #include "a_small.h"
 #include "c_io.h"
 #include "c_runcmd.h"
+#include "cam_sight.h"
 #include "d_gi.h"
 #include "d_io.h"
 #include "d_mod.h"
@@ -48,6 +49,7 @@
 #include "g_game.h"
 #include "m_bbox.h"
 #include "m_random.h"
+#include "m_workers.h"
 #include "metaapi.h"
 #include "p_anim.h"      // haleyjd
 #include "p_enemy.h"
@@ -59,6 +61,7 @@
 #include "p_mobjcol.h"
 #include "p_partcl.h"
 #include "p_setup.h"
+#include "p_spatial.h"
 #include "p_spec.h"
 #include "p_tick.h"
 #include "r_defs.h"
@@ -358,7 +361,7 @@ static bool P_IsOnLift(const Mobj *actor)
    // activated as a lift.
    if((line.tag = sec->tag))
    {
-      for(l = -1; (l = P_FindLineFromLineTag(&line, l)) >= 0;)
+      P_FOR_LINES_WITH_TAG(line.tag, l)
       {
          switch(lines[l].special)
          {
@@ -818,7 +821,7 @@ static fixed_t P_AvoidDropoff(Mobj *actor)
    {
       // all contacted lines
       for(by = yl; by <= yh; ++by)
-         P_BlockLinesIterator(bx, by, PIT_AvoidDropoff);
+         P_BlockLinesIteratorBox(bx, by, clip.bbox, PIT_AvoidDropoff);
    }
    
    // Non-zero if movement prescribed
@@ -1007,6 +1010,43 @@ static bool PIT_FindTarget(Mobj *mo)
    return false;
 }
 
+//
+// P_isTargetCandidate
+//
+// The cheap part of PIT_FindTarget, used to filter spatial hash queries
+// before sorting: the thing must be alive, killable, and on the other side
+// from current_actor.
+//
+static bool P_isTargetCandidate(Mobj *mo)
+{
+   return (mo->flags ^ current_actor->flags) & MF_FRIEND && mo->health > 0 &&
+          (mo->flags & MF_COUNTKILL || mo->flags3 & MF3_KILLABLE);
+}
+
+//
+// P_findNearbyTarget
+//
+// Spatial hash version of the block ring search in P_LookForMonsters.
+// Candidates within the same 4-block radius are tried nearest first;
+// returns true if PIT_FindTarget accepted one.
+//
+static bool P_findNearbyTarget(Mobj *actor)
+{
+   static PODCollection<Mobj *> candidates;
+   fixed_t range = 4 * MAPBLOCKSIZE + MAPBLOCKSIZE / 2;
+
+   P_SpatialNearest(actor->x, actor->y, range, 0, P_isTargetCandidate, 
+                    candidates);
+
+   for(size_t i = 0; i < candidates.getLength(); i++)
+   {
+      if(!PIT_FindTarget(candidates[i]))
+         return true;
+   }
+
+   return false;
+}
+
 //
 // P_HereticMadMelee
 //
@@ -1207,29 +1247,38 @@ static bool P_LookForMonsters(Mobj *actor, int allaround)
 
       current_actor = actor;
       current_allaround = allaround;
-      
-      // Search first in the immediate vicinity.
-      
-      if(!P_BlockThingsIterator(x, y, PIT_FindTarget))
-         return true;
 
-      for(d = 1; d < 5; ++d)
+      // use the spatial hash when allowed
+      if(P_SpatialHashActive())
       {
-         int i = 1 - d;
-         do
-         {
-            if(!P_BlockThingsIterator(x+i, y-d, PIT_FindTarget) ||
-               !P_BlockThingsIterator(x+i, y+d, PIT_FindTarget))
-               return true;
-         }
-         while(++i < d);
-         do
+         if(P_findNearbyTarget(actor))
+            return true;
+      }
+      else
+      {
+         // Search first in the immediate vicinity.
+
+         if(!P_BlockThingsIterator(x, y, PIT_FindTarget))
+            return true;
+
+         for(d = 1; d < 5; ++d)
          {
-            if(!P_BlockThingsIterator(x-d, y+i, PIT_FindTarget) ||
-               !P_BlockThingsIterator(x+d, y+i, PIT_FindTarget))
-               return true;
+            int i = 1 - d;
+            do
+            {
+               if(!P_BlockThingsIterator(x+i, y-d, PIT_FindTarget) ||
+                  !P_BlockThingsIterator(x+i, y+d, PIT_FindTarget))
+                  return true;
+            }
+            while(++i < d);
+            do
+            {
+               if(!P_BlockThingsIterator(x-d, y+i, PIT_FindTarget) ||
+                  !P_BlockThingsIterator(x+d, y+i, PIT_FindTarget))
+                  return true;
+            }
+            while(--i + d >= 0);
          }
-         while(--i + d >= 0);
       }
 
       {   // Random number of monsters, to prevent patterns from forming
@@ -1271,6 +1320,129 @@ bool P_LookForTargets(Mobj *actor, int allaround)
       P_LookForPlayers (actor, allaround) || P_LookForMonsters(actor, allaround);
 }
 
+//=============================================================================
+//
+// Parallel AI Evaluation
+//
+// Before thinkers run, the sight checks that monsters about to change
+// state are likely to make (against their target, or against the players
+// if they have none) are evaluated on all worker threads. The world is not
+// modified while they run, so every thread sees the state at the start of
+// the tic. The results are then stored in the sight cache in thinker
+// order, and thinkers run serially as always. Because the cache is exact,
+// each P_CheckSight returns what it would have computed itself, so
+// behavior and demo sync are unchanged.
+//
+
+struct aiquery_t
+{
+   Mobj            *looker;
+   Mobj            *target;
+   camsightparams_t params;
+   bool             result;
+   bool             valid;
+};
+
+#define AIQUERYBATCH 32 // queries per job
+#define AIQUERYMIN   64 // fewer than this aren't worth waking the workers
+
+bool ai_parallel = true; // console toggle: p_parallelai
+
+static PODCollection<aiquery_t> aiqueries;
+static camsightscratch_t        aiscratch[MAXWORKERTHREADS];
+
+//
+// P_aiQueryJob
+//
+// Runs on any thread; must not touch the zone heap or the level.
+//
+static void P_aiQueryJob(int jobnum, int threadnum, void *data)
+{
+   aiquery_t *queries = aiqueries.begin();
+   size_t     start   = (size_t)jobnum * AIQUERYBATCH;
+   size_t     stop    = start + AIQUERYBATCH;
+
+   if(stop > aiqueries.getLength())
+      stop = aiqueries.getLength();
+
+   for(size_t i = start; i < stop; i++)
+   {
+      aiquery_t &q = queries[i];
+
+      q.result = CAM_CheckSightScratch(q.params, aiscratch[threadnum]);
+      q.valid  = !aiscratch[threadnum].failed;
+   }
+}
+
+//
+// P_addAIQuery
+//
+static void P_addAIQuery(Mobj *looker, Mobj *target)
+{
+   aiquery_t &q = aiqueries.addNew();
+
+   q.looker      = looker;
+   q.target      = target;
+   q.params.prev = NULL;
+   q.params.setLookerMobj(looker);
+   q.params.setTargetMobj(target);
+}
+
+//
+// P_RunAIQueries
+//
+// Called from P_Ticker before thinkers run.
+//
+void P_RunAIQueries()
+{
+   int numthreads = M_NumWorkerThreads();
+
+   if(!ai_parallel || numthreads < 2 || !P_SightCacheUsesCam())
+      return;
+
+   aiqueries.makeEmpty();
+
+   for(Thinker *th = thinkercap.next; th != &thinkercap; th = th->next)
+   {
+      Mobj *mo = thinker_cast<Mobj *>(th);
+
+      // only monsters whose next state (and its action) begins this tic
+      if(!mo || mo->tics != 1 || mo->health <= 0 || mo->player ||
+         !(mo->flags & MF_SHOOTABLE) || mo->info->seestate == NullStateNum)
+         continue;
+
+      if(mo->target)
+      {
+         if(mo->target->health > 0)
+            P_addAIQuery(mo, mo->target);
+      }
+      else if(!(mo->flags & MF_FRIEND))
+      {
+         for(int i = 0; i < MAXPLAYERS; i++)
+         {
+            if(playeringame[i] && players[i].mo && 
+               players[i].playerstate == PST_LIVE)
+               P_addAIQuery(mo, players[i].mo);
+         }
+      }
+   }
+
+   if(aiqueries.getLength() < AIQUERYMIN)
+      return;
+
+   for(int i = 0; i < numthreads; i++)
+      CAM_InitSightScratch(aiscratch[i]);
+
+   M_RunJobs(P_aiQueryJob, NULL, 
+             (int)((aiqueries.getLength() + AIQUERYBATCH - 1) / AIQUERYBATCH));
+
+   for(aiquery_t *q = aiqueries.begin(); q != aiqueries.end(); q++)
+   {
+      if(q->valid)
+         P_PrimeSightCache(q->looker, q->target, q->result);
+   }
+}
+
 //
 // P_HelpFriend
 //
@@ -51,12 +51,14 @@ extern fixed_t xspeed[8];
 extern fixed_t yspeed[8];
 
 extern int p_lastenemyroar;
+extern bool ai_parallel;
 
 bool P_CheckMissileRange(Mobj *actor);
 bool P_HelpFriend(Mobj *actor);
 bool P_HitFriend(Mobj *actor);
 bool P_LookForPlayers(Mobj *actor, int allaround);
 bool P_LookForTargets(Mobj *actor, int allaround);
+void P_RunAIQueries();
 int  P_Move(Mobj *actor, int dropoff); // killough 9/12/98
 void P_NewChaseDir(Mobj *actor);
 bool P_SmartMove(Mobj *actor);
@@ -396,7 +396,7 @@ int EV_DoFloor(line_t *line, floor_e floortype )
    secnum = -1;
    rtn = 0;
    // move all floors with the same tag as the linedef
-   while((secnum = P_FindSectorFromLineTag(line,secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(line->tag, secnum)
    {
       sec = &sectors[secnum];
       
@@ -640,7 +640,7 @@ int EV_DoChange(line_t *line, change_e changetype)
    secnum = -1;
    rtn = 0;
    // change all sectors with the same tag as the linedef
-   while((secnum = P_FindSectorFromLineTag(line,secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(line->tag, secnum)
    {
       sec = &sectors[secnum];
       
@@ -947,7 +947,7 @@ int EV_DoDonut(line_t *line)
    secnum = -1;
    rtn = 0;
    // do function on all sectors with same tag as linedef
-   while((secnum = P_FindSectorFromLineTag(line,secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(line->tag, secnum)
    {
       s1 = &sectors[secnum];                // s1 is pillar's sector
               
@@ -1054,7 +1054,7 @@ int EV_DoElevator
    secnum = -1;
    rtn = 0;
    // act on all sectors with the same tag as the triggering linedef
-   while((secnum = P_FindSectorFromLineTag(line,secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(line->tag, secnum)
    {
       sec = &sectors[secnum];
               
@@ -1139,7 +1139,7 @@ int EV_PillarBuild(line_t *line, pillardata_t *pd)
       goto manual_pillar;
    }
 
-   while((sectornum = P_FindSectorFromTag(pd->tag, sectornum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(pd->tag, sectornum)
    {
       sector = &sectors[sectornum];
 
@@ -1228,7 +1228,7 @@ int EV_PillarOpen(line_t *line, pillardata_t *pd)
       goto manual_pillar;
    }
 
-   while((sectornum = P_FindSectorFromTag(pd->tag, sectornum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(pd->tag, sectornum)
    {
       sector = &sectors[sectornum];
 
@@ -1294,7 +1294,7 @@ void P_ChangeFloorTex(const char *name, int tag)
 
    flatnum = R_FindFlat(name);
 
-   while((secnum = P_FindSectorFromTag(tag, secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(tag, secnum)
       sectors[secnum].floorpic = flatnum;
 }
 
@@ -1402,7 +1402,7 @@ int EV_StartFloorWaggle(line_t *line, int tag, int height, int speed,
       goto manual_waggle;
    }
    
-   while((sectorIndex = P_FindSectorFromTag(tag, sectorIndex)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(tag, sectorIndex)
    {
       sector = &sectors[sectorIndex];
 
@@ -78,7 +78,7 @@ int EV_DoParamFloor(line_t *line, int tag, floordata_t *fd)
 
    secnum = -1;
    // if not manual do all sectors tagged the same as the line
-   while((secnum = P_FindSectorFromTag(tag, secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(tag, secnum)
    {
       sec = &sectors[secnum];
       
@@ -325,7 +325,7 @@ int EV_DoParamCeiling(line_t *line, int tag, ceilingdata_t *cd)
 
    secnum = -1;
    // if not manual do all sectors tagged the same as the line
-   while((secnum = P_FindSectorFromTag(tag, secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(tag, secnum)
    {
       sec = &sectors[secnum];
 
@@ -592,7 +592,7 @@ int EV_DoGenLift(line_t *line)
    }
 
    // if not manual do all sectors tagged the same as the line
-   while((secnum = P_FindSectorFromLineTag(line,secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(line->tag, secnum)
    {
       sec = &sectors[secnum];
       
@@ -738,7 +738,7 @@ int EV_DoParamStairs(line_t *line, int tag, stairdata_t *sd)
 
    secnum = -1;
    // if not manual do all sectors tagged the same as the line
-   while((secnum = P_FindSectorFromTag(tag, secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(tag, secnum)
    {
       sec = &sectors[secnum];
       
@@ -1001,7 +1001,7 @@ int EV_DoGenCrusher(line_t *line)
    
    secnum = -1;
    // if not manual do all sectors tagged the same as the line
-   while((secnum = P_FindSectorFromLineTag(line,secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(line->tag, secnum)
    {
       sec = &sectors[secnum];
       
@@ -1142,7 +1142,7 @@ int EV_DoParamDoor(line_t *line, int tag, doordata_t *dd)
    rtn = 0;
 
    // if not manual do all sectors tagged the same as the line
-   while((secnum = P_FindSectorFromTag(tag, secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(tag, secnum)
    {
       sec = &sectors[secnum];
 manual_door:
@@ -58,7 +58,12 @@ void FireFlickerThinker::Think()
    int amount;
    
    if(--this->count)
+   {
+      // nothing happens until the count runs out
+      if(sleepFor(this->count))
+         this->count = 1;
       return;
+   }
    
    amount = (P_Random(pr_lights)&3)*16;
    
@@ -79,7 +84,13 @@ void FireFlickerThinker::serialize(SaveArchive &arc)
 {
    Super::serialize(arc);
 
-   arc << count << maxlight << minlight;
+   // account for tics skipped while dormant
+   int curcount = count + dormantTics();
+
+   arc << curcount << maxlight << minlight;
+
+   if(arc.isLoading())
+      count = curcount;
 }
 
 
@@ -96,7 +107,12 @@ IMPLEMENT_THINKER_TYPE(LightFlashThinker)
 void LightFlashThinker::Think()
 {
    if(--this->count)
+   {
+      // nothing happens until the count runs out
+      if(sleepFor(this->count))
+         this->count = 1;
       return;
+   }
    
    if(this->sector->lightlevel == this->maxlight)
    {
@@ -119,7 +135,13 @@ void LightFlashThinker::serialize(SaveArchive &arc)
 {
    Super::serialize(arc);
 
-   arc << count << maxlight << minlight << maxtime << mintime;
+   // account for tics skipped while dormant
+   int curcount = count + dormantTics();
+
+   arc << curcount << maxlight << minlight << maxtime << mintime;
+
+   if(arc.isLoading())
+      count = curcount;
 }
 
 //
@@ -160,7 +182,12 @@ IMPLEMENT_THINKER_TYPE(StrobeThinker)
 void StrobeThinker::Think()
 {
    if(--this->count)
+   {
+      // nothing happens until the count runs out
+      if(sleepFor(this->count))
+         this->count = 1;
       return;
+   }
    
    if(this->sector->lightlevel == this->minlight)
    {
@@ -183,7 +210,13 @@ void StrobeThinker::serialize(SaveArchive &arc)
 {
    Super::serialize(arc);
 
-   arc << count << minlight << maxlight << darktime << brighttime;
+   // account for tics skipped while dormant
+   int curcount = count + dormantTics();
+
+   arc << curcount << minlight << maxlight << darktime << brighttime;
+
+   if(arc.isLoading())
+      count = curcount;
 }
 
 //
@@ -462,7 +495,7 @@ int EV_StartLightStrobing(line_t *line)
    
    secnum = -1;
    // start lights strobing in all sectors tagged same as line
-   while((secnum = P_FindSectorFromLineTag(line, secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(line->tag, secnum)
    {
       sec = &sectors[secnum];
       // if already doing a lighting function, don't start a second
@@ -486,10 +519,12 @@ int EV_StartLightStrobing(line_t *line)
 //
 int EV_TurnTagLightsOff(line_t* line)
 {
+   int j;
+
    // search sectors for those with same tag as activating line
    
    // killough 10/98: replaced inefficient search with fast search
-   for(int j = -1; (j = P_FindSectorFromLineTag(line, j)) >= 0; )
+   P_FOR_SECTORS_WITH_TAG(line->tag, j)
    {
       sector_t *sector = sectors + j, *tsec;
       int min = sector->lightlevel;
@@ -526,7 +561,7 @@ int EV_LightTurnOn(line_t *line, int bright)
    // search all sectors for ones with same tag as activating line
    
    // killough 10/98: replace inefficient search with fast search
-   for(i = -1; (i = P_FindSectorFromLineTag(line, i)) >= 0;)
+   P_FOR_SECTORS_WITH_TAG(line->tag, i)
    {
       sector_t *temp, *sector = sectors+i;
       int j, tbright = bright; //jff 5/17/98 search for maximum PER sector
@@ -578,7 +613,7 @@ int EV_LightTurnOnPartway(int tag, fixed_t level)
       level = FRACUNIT;
 
    // search all sectors for ones with same tag as activating line
-   for(i = -1; (i = P_FindSectorFromTag(tag, i)) >= 0;)
+   P_FOR_SECTORS_WITH_TAG(tag, i)
    {
       sector_t *temp, *sector = sectors + i;
       int j, bright = 0, min = sector->lightlevel;
@@ -626,7 +661,7 @@ int EV_SetLight(line_t *line, int tag, setlight_e type, int lvl)
       goto dobackside;
    }
 
-   for(i = -1; (i = P_FindSectorFromTag(tag, i)) >= 0;)
+   P_FOR_SECTORS_WITH_TAG(tag, i)
    {      
 dobackside:
       s = &sectors[i];
@@ -686,7 +721,7 @@ int EV_FadeLight(line_t *line, int tag, int destvalue, int speed)
    }
    
    // search all sectors for ones with tag
-   for(i = -1; (i = P_FindSectorFromTag(tag, i)) >= 0;)
+   P_FOR_SECTORS_WITH_TAG(tag, i)
    {
 dobackside:
       rtn = 1;
@@ -746,7 +781,7 @@ int EV_GlowLight(line_t *line, int tag, int maxval, int minval, int speed)
    }
    
    // search all sectors for ones with tag
-   for(i = -1; (i = P_FindSectorFromTag(tag, i)) >= 0;)
+   P_FOR_SECTORS_WITH_TAG(tag, i)
    {
 dobackside:
       rtn = 1;
@@ -798,7 +833,7 @@ int EV_StrobeLight(line_t *line, int tag,
       goto dobackside;
    }
    
-   for(i = -1; (i = P_FindSectorFromTag(tag, i)) >= 0;)
+   P_FOR_SECTORS_WITH_TAG(tag, i)
    {
 dobackside:
       rtn = 1;
@@ -844,7 +879,7 @@ int EV_FlickerLight(line_t *line, int tag, int maxval, int minval)
       goto dobackside;
    }
    
-   for(i = -1; (i = P_FindSectorFromTag(tag, i)) >= 0;)
+   P_FOR_SECTORS_WITH_TAG(tag, i)
    {
 dobackside:
       rtn = 1;
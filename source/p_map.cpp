@@ -46,6 +46,7 @@
 #include "p_portal.h"
 #include "p_setup.h"
 #include "p_skin.h"
+#include "p_spatial.h"
 #include "p_spec.h"
 #include "p_tick.h"
 #include "p_user.h"
@@ -1205,7 +1206,7 @@ bool P_CheckPosition(Mobj *thing, fixed_t x, fixed_t y)
    {
       for(by = yl; by <= yh; by++)
       {
-         if(!P_BlockLinesIterator(bx, by, PIT_CheckLine))
+         if(!P_BlockLinesIteratorBox(bx, by, clip.bbox, PIT_CheckLine))
             return false; // doesn't fit
       }
    }
@@ -1698,7 +1699,7 @@ void P_ApplyTorque(Mobj *mo)
       
    for(bx = xl ; bx <= xh ; bx++)
       for(by = yl ; by <= yh ; by++)
-         P_BlockLinesIterator(bx, by, PIT_ApplyTorque);
+         P_BlockLinesIteratorBox(bx, by, clip.bbox, PIT_ApplyTorque);
       
    // If any momentum, mark object as 'falling' using engine-internal flags
    if (mo->momx | mo->momy)
@@ -2125,6 +2126,9 @@ static int bombindex;              // current index into bombs array
 static bombdata_t bombs[MAXBOMBS]; // bombs away!
 static bombdata_t *theBomb;        // it's the bomb, man. (the current explosion)
 
+// Things caught in each explosion, by recursion depth
+static PODCollection<Mobj *> bombvictims[MAXBOMBS];
+
 //
 // PIT_RadiusAttack
 //
@@ -2245,9 +2249,33 @@ void P_RadiusAttack(Mobj *spot, Mobj *source, int damage, int distance,
    theBomb->bombmod      = mod;
    theBomb->bombflags    = flags;
    
-   for(y = yl; y <= yh; ++y)
-      for(x = xl; x <= xh; ++x)
-         P_BlockThingsIterator(x, y, PIT_RadiusAttack);
+   // outside of demos and netgames, only visit things that are actually
+   // within range, via the spatial hash.
+   if(P_SpatialHashActive())
+   {
+      PODCollection<Mobj *> &victims = bombvictims[theBomb - bombs];
+      int64_t reach = ((int64_t)distance << FRACBITS) + P_SpatialMaxRadius();
+
+      // a thing is in range if its edge is, so reach out by the largest
+      // radius any thing can have
+      P_SpatialBoxQuery(spot->x, spot->y, 
+                        reach > D_MAXINT ? D_MAXINT : (fixed_t)reach, 
+                        NULL, victims);
+
+      // things removed by an earlier victim's death are skipped, as they
+      // would have been unlinked from the blockmap
+      for(size_t i = 0; i < victims.getLength(); i++)
+      {
+         if(!victims[i]->isRemoved())
+            PIT_RadiusAttack(victims[i]);
+      }
+   }
+   else
+   {
+      for(y = yl; y <= yh; ++y)
+         for(x = xl; x <= xh; ++x)
+            P_BlockThingsIterator(x, y, PIT_RadiusAttack);
+   }
 
    if(demo_version >= 335 && bombindex > 0)
       theBomb = &bombs[--bombindex];
@@ -2684,7 +2712,7 @@ msecnode_t *P_CreateSecNodeList(Mobj *thing, fixed_t x, fixed_t y)
    for(bx = xl; bx <= xh; bx++)
    {
       for(by = yl; by <= yh; by++)
-         P_BlockLinesIterator(bx, by, PIT_GetSectors);
+         P_BlockLinesIteratorBox(bx, by, pClip->bbox, PIT_GetSectors);
    }
 
    // Add the sector of the (x,y) point to sector_list.
@@ -87,6 +87,23 @@ bool P_PortalTeleportMove(Mobj *thing, fixed_t x, fixed_t y);
 //
 
 bool P_CheckSight(Mobj *t1, Mobj *t2);
+
+// Per-tic sight check cache
+struct sightcachestats_t
+{
+   unsigned int lookups;       // calls to P_CheckSight through the cache
+   unsigned int hits;          // calls answered without a traversal
+   unsigned int invalidations; // epoch changes (new tics and moved geometry)
+   unsigned int primed;        // results stored from parallel evaluation
+};
+
+void P_InvalidateSightCache();
+void P_PrimeSightCache(Mobj *t1, Mobj *t2, bool result);
+bool P_SightCacheUsesCam();
+void P_GetSightCacheStats(sightcachestats_t &stats);
+void P_ResetSightCacheStats();
+
+extern bool sight_cache;
 void P_UseLines(player_t *player);
 
 // killough 8/2/98: add 'mask' argument to prevent friends autoaiming at others
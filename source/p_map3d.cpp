@@ -689,7 +689,7 @@ bool P_CheckPosition3D(Mobj *thing, fixed_t x, fixed_t y)
 
    for(bx = xl; bx <= xh; ++bx)
       for(by = yl; by <= yh; ++by)
-         if(!P_BlockLinesIterator(bx, by, PIT_CheckLine))
+         if(!P_BlockLinesIteratorBox(bx, by, clip.bbox, PIT_CheckLine))
             return false; // doesn't fit
 
    if(clip.ceilingz - clip.floorz < thing->height)
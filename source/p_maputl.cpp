@@ -34,12 +34,19 @@
 #include "p_map3d.h"
 #include "p_maputl.h"
 #include "p_setup.h"
+#include "p_spatial.h"
 #include "polyobj.h"
 #include "r_data.h"
 #include "r_main.h"
 #include "r_portal.h"
 #include "r_state.h"
 
+// SSE2 bbox rejection for the compact blockmap
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define P_BLOCKBOX_SSE2
+#include <emmintrin.h>
+#endif
+
 
 //
 // P_AproxDistance
@@ -387,6 +394,9 @@ void P_UnsetThingPosition(Mobj *thing)
       if(bprev && (*bprev = bnext = thing->bnext))  // unlink from block map
          bnext->bprev = bprev;
    }
+
+   // unlink from spatial hash; safe if not linked
+   P_SpatialUnlink(thing);
 }
 
 //
@@ -460,6 +470,9 @@ void P_SetThingPosition(Mobj *thing)
       }
       else        // thing is off the map
          thing->bnext = NULL, thing->bprev = NULL;
+
+      // link into spatial hash
+      P_SpatialLink(thing);
    }
 }
 
@@ -512,27 +525,13 @@ bool ThingIsOnLine(Mobj *t, line_t *l)
 //
 
 //
-// P_BlockLinesIterator
-// The validcount flags are used to avoid checking lines
-// that are marked in multiple mapblocks,
-// so increment validcount before the first call
-// to P_BlockLinesIterator, then make one or more calls
-// to it.
+// P_blockPolyLinesIterator
 //
-// killough 5/3/98: reformatted, cleaned up
+// haleyjd 02/22/06: consider polyobject lines in a blockmap cell.
 //
-bool P_BlockLinesIterator(int x, int y, bool func(line_t*))
+static bool P_blockPolyLinesIterator(int offset, bool func(line_t *))
 {
-   int        offset;
-   const int  *list;     // killough 3/1/98: for removal of blockmap limit
-   DLListItem<polymaplink_t> *plink; // haleyjd 02/22/06
-   
-   if(x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight)
-      return true;
-   offset = y * bmapwidth + x;
-
-   // haleyjd 02/22/06: consider polyobject lines
-   plink = polyblocklinks[offset];
+   DLListItem<polymaplink_t> *plink = polyblocklinks[offset];
 
    while(plink)
    {
@@ -555,34 +554,156 @@ bool P_BlockLinesIterator(int x, int y, bool func(line_t*))
       plink = plink->dllNext;
    }
 
-   // original was reading delimiting 0 as linedef 0 -- phares
-   offset = *(blockmap + offset);
-   list = blockmaplump + offset;
+   return true;
+}
+
+//
+// P_blockVisitLine
+//
+// Common validcount check and callback for the blockmap line iterators.
+//
+inline static bool P_blockVisitLine(line_t *ld, bool func(line_t *))
+{
+   if(ld->validcount == validcount)
+      return true;       // line has already been checked
+   ld->validcount = validcount;
+   return func(ld);
+}
+
+//
+// P_BlockLinesIterator
+// The validcount flags are used to avoid checking lines
+// that are marked in multiple mapblocks,
+// so increment validcount before the first call
+// to P_BlockLinesIterator, then make one or more calls
+// to it.
+//
+// killough 5/3/98: reformatted, cleaned up
+//
+bool P_BlockLinesIterator(int x, int y, bool func(line_t*))
+{
+   int offset;
+   const blockcell_t *cell;
+   const int *list, *end;
+   
+   if(x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight)
+      return true;
+   offset = y * bmapwidth + x;
+
+   if(!P_blockPolyLinesIterator(offset, func))
+      return false;
+
+   // lines come from the compact blockmap, where padding and invalid list
+   // entries have already been turned into -1.
+   cell = &blockcells[offset];
 
    // killough 1/31/98: for compatibility we need to use the old method.
    // Most demos go out of sync, and maybe other problems happen, if we
    // don't consider linedef 0. For safety this should be qualified.
 
    // killough 2/22/98: demo_compatibility check
-   // skip 0 starting delimiter -- phares
-   if(!demo_compatibility)
-      list++;     
-   for( ; *list != -1; list++)
+   // original was reading delimiting 0 as linedef 0 -- phares
+   if(demo_compatibility)
    {
-      line_t *ld;
-      
+      if(cell->head == -1)
+         return true;
+
       // haleyjd 04/06/10: to avoid some crashes during demo playback due to
       // invalid blockmap lumps
-      if(*list >= numlines)
-         continue;
-
-      ld = &lines[*list];
-      if(ld->validcount == validcount)
-         continue;       // line has already been checked
-      ld->validcount = validcount;
-      if(!func(ld))
+      if(cell->head >= 0 && cell->head < numlines && 
+         !P_blockVisitLine(&lines[cell->head], func))
+         return false;
+   }
+
+   list = blocklineboxes.linenum + cell->start;
+   end  = list + cell->count;
+
+   for(; list != end; list++)
+   {
+      if(*list >= 0 && !P_blockVisitLine(&lines[*list], func))
+         return false;
+   }
+   return true;  // everything was checked
+}
+
+//
+// P_BlockLinesIteratorBox
+//
+// Variant of P_BlockLinesIterator for callbacks which start by ignoring every
+// line whose bounding box doesn't strictly overlap bbox (PIT_CheckLine and
+// friends). Those lines are rejected using the compact blockmap's bounding
+// box arrays, four at a time with SSE2, without touching their line_t. The
+// lines that remain are visited in the same order and with the same
+// validcount marking as P_BlockLinesIterator, and since a rejected line would
+// have had no effect, the results are identical.
+//
+bool P_BlockLinesIteratorBox(int x, int y, const fixed_t *bbox, 
+                             bool func(line_t *))
+{
+   int offset;
+   const blockcell_t *cell;
+   const blocklineboxes_t &b = blocklineboxes;
+   
+   if(x < 0 || y < 0 || x >= bmapwidth || y >= bmapheight)
+      return true;
+   offset = y * bmapwidth + x;
+
+   if(!P_blockPolyLinesIterator(offset, func))
+      return false;
+
+   cell = &blockcells[offset];
+
+   // see P_BlockLinesIterator
+   if(demo_compatibility)
+   {
+      if(cell->head == -1)
+         return true;
+
+      if(cell->head >= 0 && cell->head < numlines && 
+         !P_blockVisitLine(&lines[cell->head], func))
          return false;
    }
+
+#ifdef P_BLOCKBOX_SSE2
+   const __m128i bl = _mm_set1_epi32(bbox[BOXLEFT]);
+   const __m128i br = _mm_set1_epi32(bbox[BOXRIGHT]);
+   const __m128i bb = _mm_set1_epi32(bbox[BOXBOTTOM]);
+   const __m128i bt = _mm_set1_epi32(bbox[BOXTOP]);
+#endif
+
+   for(int i = cell->start, end = cell->start + cell->count; i < end; i += 4)
+   {
+      int touching;
+
+#ifdef P_BLOCKBOX_SSE2
+      __m128i l = _mm_loadu_si128((const __m128i *)(b.left   + i));
+      __m128i r = _mm_loadu_si128((const __m128i *)(b.right  + i));
+      __m128i d = _mm_loadu_si128((const __m128i *)(b.bottom + i));
+      __m128i t = _mm_loadu_si128((const __m128i *)(b.top    + i));
+
+      __m128i hit = _mm_and_si128(
+         _mm_and_si128(_mm_cmpgt_epi32(br, l), _mm_cmpgt_epi32(r, bl)),
+         _mm_and_si128(_mm_cmpgt_epi32(bt, d), _mm_cmpgt_epi32(t, bb)));
+
+      touching = _mm_movemask_ps(_mm_castsi128_ps(hit));
+#else
+      touching = 0;
+      for(int j = 0; j < 4; j++)
+      {
+         if(bbox[BOXRIGHT]  > b.left[i+j]   && bbox[BOXLEFT]   < b.right[i+j] &&
+            bbox[BOXTOP]    > b.bottom[i+j] && bbox[BOXBOTTOM] < b.top[i+j])
+            touching |= 1 << j;
+      }
+#endif
+
+      for(int j = 0; touching; j++, touching >>= 1)
+      {
+         if((touching & 1) && 
+            !P_blockVisitLine(&lines[b.linenum[i+j]], func))
+            return false;
+      }
+   }
+
    return true;  // everything was checked
 }
 
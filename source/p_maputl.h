@@ -109,6 +109,8 @@ void    P_LineOpening (line_t *linedef, Mobj *mo);
 void P_UnsetThingPosition(Mobj *thing);
 void P_SetThingPosition(Mobj *thing);
 bool P_BlockLinesIterator (int x, int y, bool func(line_t *));
+bool P_BlockLinesIteratorBox(int x, int y, const fixed_t *bbox, 
+                             bool func(line_t *));
 bool P_BlockThingsIterator(int x, int y, bool func(Mobj *));
 bool ThingIsOnLine(Mobj *t, line_t *l);  // killough 3/15/98
 bool P_PathTraverse(fixed_t x1, fixed_t y1, fixed_t x2, fixed_t y2,
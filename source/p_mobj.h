@@ -226,6 +226,11 @@ public:
    Mobj  *bnext;
    Mobj **bprev; // killough 8/11/98: change to ptr-to-ptr
 
+   // links in spatial hash (see p_spatial.cpp)
+   Mobj        *hnext;
+   Mobj       **hprev;
+   unsigned int hashkey; // packed hash cell coordinates
+
    subsector_t *subsector;
 
    // The closest interval over all contacted Sectors.
@@ -405,6 +410,7 @@ void  P_MobjThinker(Mobj *mobj);
 void  P_SpawnPuff(fixed_t x, fixed_t y, fixed_t z, angle_t dir, int updown, bool ptcl);
 void  P_SpawnBlood(fixed_t x, fixed_t y, fixed_t z, angle_t dir, int damage, Mobj *target);
 Mobj *P_SpawnMapThing(mapthing_t *);
+int   P_FindDoomedNum(int type);
 bool  P_CheckMissileSpawn(Mobj *);  // killough 8/2/98
 void  P_ExplodeMissile(Mobj *);     // killough
 
@@ -71,6 +71,7 @@
 #include "p_maputl.h"
 #include "p_mobj.h"
 #include "p_partcl.h"
+#include "p_pvs.h"
 #include "p_setup.h"
 #include "p_spec.h"
 #include "r_defs.h"
@@ -366,14 +367,49 @@ static void P_UnsetParticlePosition(particle_t *ptcl)
 // field in the particle_t will be useful in the future,
 // I am sure.
 //
-static void P_SetParticlePosition(particle_t *ptcl)
+// The particle stays linked where it is if it is still inside the same
+// subsector, and the BSP isn't even consulted if it has not moved in x or
+// y.
+//
+static void P_SetParticlePosition(particle_t *ptcl, bool xymoved = true)
 {
-   subsector_t *ss = R_PointInSubsector(ptcl->x, ptcl->y);
+   subsector_t *ss;
+   
+   if(ptcl->subsector && !xymoved)
+      return;
+
+   ss = R_PointInSubsector(ptcl->x, ptcl->y);
+
+   if(ss == ptcl->subsector)
+      return;
+
+   if(ptcl->subsector)
+      P_UnsetParticlePosition(ptcl);
 
    ptcl->seclinks.insert(ptcl, &(ss->sector->ptcllist));
    ptcl->subsector = ss;
 }
 
+//
+// P_MoveParticle
+//
+// Adds velocity to position, then acceleration to velocity. Returns true if
+// the particle moved in x or y.
+//
+static bool P_MoveParticle(particle_t *ptcl)
+{
+   bool moved = (ptcl->velx | ptcl->vely) != 0;
+
+   ptcl->x += ptcl->velx;
+   ptcl->y += ptcl->vely;
+   ptcl->z += ptcl->velz;
+   ptcl->velx += ptcl->accx;
+   ptcl->vely += ptcl->accy;
+   ptcl->velz += ptcl->accz;
+
+   return moved;
+}
+
 void P_ParticleThinker(void)
 {
    int i;
@@ -390,9 +426,6 @@ void P_ParticleThinker(void)
       particle = Particles + i;
       i = particle->next;
 
-      // haleyjd: unlink the particle from the world
-      P_UnsetParticlePosition(particle);
-
       // haleyjd: particles with fall to ground style don't start
       // fading or counting down their TTL until they hit the floor
       if(!(particle->styleflags & PS_FALLTOGROUND))
@@ -404,6 +437,8 @@ void P_ParticleThinker(void)
          // is it time to kill this particle?
          if(oldtrans < particle->trans || --particle->ttl == 0)
          {
+            // haleyjd: unlink the particle from the world
+            P_UnsetParticlePosition(particle);
             memset(particle, 0, sizeof(particle_t));
             if(prev)
                prev->next = i;
@@ -415,16 +450,8 @@ void P_ParticleThinker(void)
          }
       }
 
-      // update and link to new position
-      particle->x += particle->velx;
-      particle->y += particle->vely;
-      particle->z += particle->velz;
-      P_SetParticlePosition(particle);
-
-      // apply accelerations
-      particle->velx += particle->accx;
-      particle->vely += particle->accy;
-      particle->velz += particle->accz;
+      // update and link to new position, and apply accelerations
+      P_SetParticlePosition(particle, P_MoveParticle(particle));
 
       // handle special movement flags (post-position-set)
 
@@ -447,7 +474,6 @@ void P_ParticleThinker(void)
       {
          linkdata_t *ldata = R_FPLink(psec);
 
-         P_UnsetParticlePosition(particle);
          particle->x += ldata->deltax;
          particle->y += ldata->deltay;
          particle->z += ldata->deltaz;
@@ -480,6 +506,7 @@ void P_RunEffects(void)
 {
    int snum = 0;
    Thinker *th = &thinkercap;
+   const byte *pvsrow;
 
    if(camera)
    {
@@ -492,6 +519,9 @@ void P_RunEffects(void)
       snum = (ss->sector - sectors) * numsectors;
    }
 
+   // the PVS is tighter than REJECT when available
+   pvsrow = P_PVSRow(snum / numsectors);
+
    while((th = th->next) != &thinkercap)
    {
       Mobj *mobj;
@@ -501,7 +531,8 @@ void P_RunEffects(void)
          if(mobj->effects)
          {
             // run only if possibly visible
-            if(!(rejectmatrix[rnum>>3] & (1<<(rnum&7))))
+            if(!(rejectmatrix[rnum>>3] & (1<<(rnum&7))) &&
+               (!pvsrow || P_PVSVisible(pvsrow, mobj->subsector->sector - sectors)))
                P_RunEffect(mobj, mobj->effects);
          }
       }
@@ -289,7 +289,7 @@ bool EV_DoPlat(line_t *line, plattype_e type, int amount )
    }
       
    // act on all sectors tagged the same as the activating linedef
-   while((secnum = P_FindSectorFromLineTag(line, secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(line->tag, secnum)
    {
       sec = &sectors[secnum];
       
@@ -426,7 +426,7 @@ bool EV_DoParamPlat(line_t *line, int *args, paramplattype_e type)
       goto manual_plat;
    }
 
-   while((secnum = P_FindSectorFromTag(args[0], secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(args[0], secnum)
    {
       sec = &sectors[secnum];
 
@@ -827,6 +827,9 @@ void P_SetFloorHeight(sector_t *sec, fixed_t h)
    sec->floorheight = h;
    sec->floorheightf = M_FixedToFloat(sec->floorheight);
 
+   // cached sight checks through this sector are now stale
+   P_InvalidateSightCache();
+
    // check floor portal state
    P_CheckFPortalState(sec);
 }
@@ -843,6 +846,9 @@ void P_SetCeilingHeight(sector_t *sec, fixed_t h)
    sec->ceilingheight = h;
    sec->ceilingheightf = M_FixedToFloat(sec->ceilingheight);
 
+   // cached sight checks through this sector are now stale
+   P_InvalidateSightCache();
+
    // check ceiling portal state
    P_CheckCPortalState(sec);
 }
@@ -852,6 +858,7 @@ void P_SetPortalBehavior(portal_t *portal, int newbehavior)
    int   i;
    
    portal->flags = newbehavior & PF_FLAGMASK;
+   P_InvalidateSightCache();
    for(i = 0; i < numsectors; i++)
    {
       sector_t *sec = sectors + i;
@@ -0,0 +1,929 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    Sector potentially-visible sets (PVS).
+//
+//    REJECT is frequently empty in modern maps, so this computes a
+//    conservative sector-to-sector visibility matrix from the level geometry
+//    itself. Visibility flows from each sector through the two-sided lines
+//    bounding it; each further line is clipped against the separating lines
+//    formed by the first line crossed and the current one, in the manner of
+//    a 2D portal flow. Sector heights, one-sided walls and polyobjects are
+//    ignored, so a pair is only marked invisible when no straight line at all
+//    could connect the two sectors.
+//
+//    The matrix is built by a background thread after the level loads and
+//    is cached on disk, keyed by a checksum of the geometry it was built
+//    from. Until it is ready, every pair is treated as visible.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+#include "i_system.h"
+
+#include "c_io.h"
+#include "doomstat.h"
+#include "hal/i_directory.h"
+#include "hal/i_thread.h"
+#include "m_hash.h"
+#include "m_qstr.h"
+#include "p_pvs.h"
+#include "p_setup.h"
+#include "r_defs.h"
+#include "r_state.h"
+
+#define PVS_MAXSECTORS 16384  // matrix would be 32 MB beyond this
+#define PVS_STEPLIMIT  65536  // flow steps per sector before falling back
+#define PVS_MAXDEPTH   256    // maximum lines crossed in one flow
+#define PVS_EPSILON    (1.0 / 64.0)
+#define PVS_VERSION    1
+
+static const char pvsmagic[8] = { 'E', 'E', 'P', 'V', 'S', '\0', '\0', '\0' };
+
+// A two-sided line between two different sectors
+struct pvsportal_t
+{
+   double x1, y1, x2, y2;
+   int    sectors[2]; // front (right of v1->v2) and back
+};
+
+struct pvsseg_t
+{
+   double x1, y1, x2, y2;
+};
+
+// Normalized line equation; distance is positive on the kept side
+struct pvsplane_t
+{
+   double nx, ny, d;
+};
+
+struct pvscacheheader_t
+{
+   char     magic[8];
+   uint32_t version;
+   uint32_t key;
+   int32_t  numsectors;
+   int32_t  rowbytes;
+};
+
+//
+// State for one build. Everything the build thread touches is allocated
+// here by the main thread beforehand with plain malloc, since the zone heap
+// is not thread-safe and the level data may change while the thread runs.
+//
+struct pvsbuild_t
+{
+   int          numsectors;
+   int          rowbytes;
+   int          numportals;
+   pvsportal_t *portals;
+   int         *firstportal; // numsectors + 1 offsets into secportals
+   int         *secportals;  // portal numbers, grouped by sector
+   byte        *matrix;      // result, numsectors rows of rowbytes
+   byte        *onpath;      // per portal; crossed by the current flow
+   int         *floodstack;  // numsectors entries for the fallback flood
+   unsigned int steps;
+   bool         overbudget;
+   char        *cachefile;
+   uint32_t     key;
+
+   HALThreadHandle *thread;
+   HALMutex        *mutex;
+   bool             done;    // protected by mutex
+   bool             abort;   // protected by mutex
+   bool             success; // valid once done
+};
+
+bool pvs_enable = true; // console toggle: p_pvs
+
+static byte       *pvsmatrix;   // current level's matrix, or NULL
+static int         pvsrowbytes;
+static pvsbuild_t *pvsbuild;    // build in progress, if any
+
+//=============================================================================
+//
+// Geometry
+//
+
+//
+// P_pvsMakePlane
+//
+// Line through two points, positive to the left of (x1, y1)->(x2, y2).
+// Returns false if the points coincide.
+//
+static bool P_pvsMakePlane(double x1, double y1, double x2, double y2, 
+                           pvsplane_t &pl)
+{
+   double dx = x2 - x1, dy = y2 - y1;
+   double len = sqrt(dx * dx + dy * dy);
+
+   if(len < PVS_EPSILON)
+      return false;
+
+   pl.nx = -dy / len;
+   pl.ny =  dx / len;
+   pl.d  = -(pl.nx * x1 + pl.ny * y1);
+   return true;
+}
+
+static double P_pvsDist(const pvsplane_t &pl, double x, double y)
+{
+   return pl.nx * x + pl.ny * y + pl.d;
+}
+
+static void P_pvsFlip(pvsplane_t &pl)
+{
+   pl.nx = -pl.nx;
+   pl.ny = -pl.ny;
+   pl.d  = -pl.d;
+}
+
+//
+// P_pvsPortalPlane
+//
+// Plane of a portal line, with the kept side facing the given side of it.
+//
+static bool P_pvsPortalPlane(const pvsportal_t &p, int side, pvsplane_t &pl)
+{
+   if(!P_pvsMakePlane(p.x1, p.y1, p.x2, p.y2, pl))
+      return false;
+
+   // the front sector lies to the right of the line
+   if(side == 0)
+      P_pvsFlip(pl);
+   return true;
+}
+
+//
+// P_pvsClip
+//
+// Keep the part of a segment on the kept side of a plane. The cut is moved
+// outward by PVS_EPSILON so that rounding can only add visibility. Returns
+// false if nothing remains.
+//
+static bool P_pvsClip(pvsseg_t &s, const pvsplane_t &pl)
+{
+   double d1 = P_pvsDist(pl, s.x1, s.y1);
+   double d2 = P_pvsDist(pl, s.x2, s.y2);
+   double t, x, y;
+
+   if(d1 >= -PVS_EPSILON && d2 >= -PVS_EPSILON)
+      return true;
+   if(d1 < -PVS_EPSILON && d2 < -PVS_EPSILON)
+      return false;
+
+   t = (d1 + PVS_EPSILON) / (d1 - d2);
+   x = s.x1 + (s.x2 - s.x1) * t;
+   y = s.y1 + (s.y2 - s.y1) * t;
+
+   if(d1 < -PVS_EPSILON)
+      s.x1 = x, s.y1 = y;
+   else
+      s.x2 = x, s.y2 = y;
+
+   return true;
+}
+
+//
+// P_pvsSeparators
+//
+// Find the lines through an endpoint of the source and an endpoint of the
+// pass which have the source and pass on opposite sides. Anything seen
+// through both must lie on the pass side of all of them.
+//
+static int P_pvsSeparators(const pvsseg_t &a, const pvsseg_t &b, 
+                           pvsplane_t *out)
+{
+   const double ax[2] = { a.x1, a.x2 }, ay[2] = { a.y1, a.y2 };
+   const double bx[2] = { b.x1, b.x2 }, by[2] = { b.y1, b.y2 };
+   int num = 0;
+
+   for(int i = 0; i < 2; i++)
+   {
+      for(int j = 0; j < 2; j++)
+      {
+         pvsplane_t pl;
+         double da, db;
+
+         if(!P_pvsMakePlane(ax[i], ay[i], bx[j], by[j], pl))
+            continue;
+
+         da = P_pvsDist(pl, ax[i^1], ay[i^1]);
+         db = P_pvsDist(pl, bx[j^1], by[j^1]);
+
+         if(da < -PVS_EPSILON && db > PVS_EPSILON)
+            out[num++] = pl;
+         else if(da > PVS_EPSILON && db < -PVS_EPSILON)
+         {
+            P_pvsFlip(pl);
+            out[num++] = pl;
+         }
+      }
+   }
+
+   return num;
+}
+
+//=============================================================================
+//
+// Builder
+//
+
+#define PVS_SETBIT(row, n) ((row)[(n) >> 3] |= (1 << ((n) & 7)))
+#define PVS_GETBIT(row, n) ((row)[(n) >> 3] & (1 << ((n) & 7)))
+
+//
+// P_pvsFlow
+//
+// Sight has entered a sector through the pass, having first left the 
+// source sector through the source line. Mark and recurse into every sector
+// reachable through the remaining lines of this one.
+//
+static void P_pvsFlow(pvsbuild_t *b, const pvsseg_t &source, 
+                      const pvsplane_t &sourceplane, const pvsseg_t &pass,
+                      const pvsplane_t &passplane, int sector, byte *row,
+                      int depth)
+{
+   pvsplane_t seps[4];
+   int numseps = 0;
+
+   if(++b->steps > PVS_STEPLIMIT || depth >= PVS_MAXDEPTH)
+   {
+      b->overbudget = true;
+      return;
+   }
+
+   if(depth > 0)
+      numseps = P_pvsSeparators(source, pass, seps);
+
+   for(int i = b->firstportal[sector]; i < b->firstportal[sector + 1]; i++)
+   {
+      int pnum = b->secportals[i];
+      const pvsportal_t &p = b->portals[pnum];
+      int side, next, k;
+      pvsseg_t seg;
+      pvsplane_t nextplane;
+
+      if(b->onpath[pnum]) // a straight line crosses each line only once
+         continue;
+
+      side = (p.sectors[0] == sector) ? 0 : 1;
+      next = p.sectors[side ^ 1];
+
+      seg.x1 = p.x1;
+      seg.y1 = p.y1;
+      seg.x2 = p.x2;
+      seg.y2 = p.y2;
+
+      if(!P_pvsClip(seg, sourceplane) || !P_pvsClip(seg, passplane))
+         continue;
+      for(k = 0; k < numseps; k++)
+      {
+         if(!P_pvsClip(seg, seps[k]))
+            break;
+      }
+      if(k < numseps)
+         continue;
+
+      PVS_SETBIT(row, next);
+
+      if(!P_pvsPortalPlane(p, side ^ 1, nextplane))
+         continue;
+
+      b->onpath[pnum] = 1;
+      P_pvsFlow(b, source, sourceplane, seg, nextplane, next, row, depth + 1);
+      b->onpath[pnum] = 0;
+
+      if(b->overbudget)
+         return;
+   }
+}
+
+//
+// P_pvsFlood
+//
+// Fallback for sectors whose flow exceeded its budget: mark every sector
+// connected to this one. The row is cleared first, since it doubles as the
+// visited set and the partial flow has marked sectors without expanding them.
+//
+static void P_pvsFlood(pvsbuild_t *b, int secnum, byte *row)
+{
+   int sp = 0;
+
+   memset(row, 0, b->rowbytes);
+   PVS_SETBIT(row, secnum);
+   b->floodstack[sp++] = secnum;
+
+   while(sp)
+   {
+      int sector = b->floodstack[--sp];
+
+      for(int i = b->firstportal[sector]; i < b->firstportal[sector + 1]; i++)
+      {
+         const pvsportal_t &p = b->portals[b->secportals[i]];
+         int next = p.sectors[p.sectors[0] == sector ? 1 : 0];
+
+         if(!PVS_GETBIT(row, next))
+         {
+            PVS_SETBIT(row, next);
+            b->floodstack[sp++] = next;
+         }
+      }
+   }
+}
+
+//
+// P_pvsBuildSector
+//
+static void P_pvsBuildSector(pvsbuild_t *b, int secnum)
+{
+   byte *row = b->matrix + secnum * b->rowbytes;
+
+   PVS_SETBIT(row, secnum);
+   b->steps      = 0;
+   b->overbudget = false;
+
+   for(int i = b->firstportal[secnum]; i < b->firstportal[secnum + 1]; i++)
+   {
+      int pnum = b->secportals[i];
+      const pvsportal_t &p = b->portals[pnum];
+      int side = (p.sectors[0] == secnum) ? 0 : 1;
+      int next = p.sectors[side ^ 1];
+      pvsseg_t   source;
+      pvsplane_t sourceplane;
+
+      PVS_SETBIT(row, next);
+
+      if(!P_pvsPortalPlane(p, side ^ 1, sourceplane))
+         continue;
+
+      source.x1 = p.x1;
+      source.y1 = p.y1;
+      source.x2 = p.x2;
+      source.y2 = p.y2;
+
+      b->onpath[pnum] = 1;
+      P_pvsFlow(b, source, sourceplane, source, sourceplane, next, row, 0);
+      b->onpath[pnum] = 0;
+
+      if(b->overbudget)
+      {
+         P_pvsFlood(b, secnum, row);
+         break;
+      }
+   }
+}
+
+//
+// P_pvsAborted
+//
+static bool P_pvsAborted(pvsbuild_t *b)
+{
+   bool abort;
+
+   if(!b->mutex)
+      return false;
+
+   i_halthreads.LockMutex(b->mutex);
+   abort = b->abort;
+   i_halthreads.UnlockMutex(b->mutex);
+
+   return abort;
+}
+
+//
+// P_pvsWriteCache
+//
+// Runs on the build thread, so stdio is used directly rather than 
+// M_WriteFile, which touches the disk icon.
+//
+static void P_pvsWriteCache(pvsbuild_t *b)
+{
+   pvscacheheader_t header;
+   size_t size = (size_t)b->numsectors * b->rowbytes;
+   FILE  *f;
+   bool   ok;
+
+   if(!b->cachefile || !(f = fopen(b->cachefile, "wb")))
+      return;
+
+   memcpy(header.magic, pvsmagic, sizeof(header.magic));
+   header.version    = PVS_VERSION;
+   header.key        = b->key;
+   header.numsectors = b->numsectors;
+   header.rowbytes   = b->rowbytes;
+
+   ok = (fwrite(&header, sizeof(header), 1, f) == 1 &&
+         fwrite(b->matrix, 1, size, f) == size);
+   fclose(f);
+
+   if(!ok)
+      remove(b->cachefile);
+}
+
+//
+// P_pvsBuild
+//
+// Compute the whole matrix. Returns false if the build was aborted.
+//
+static bool P_pvsBuild(pvsbuild_t *b)
+{
+   int n = b->numsectors;
+
+   for(int s = 0; s < n; s++)
+   {
+      if(!(s & 63) && P_pvsAborted(b))
+         return false;
+      P_pvsBuildSector(b, s);
+   }
+
+   // Sight is symmetric; merging both directions covers any asymmetry
+   // introduced by rounding.
+   for(int s1 = 0; s1 < n; s1++)
+   {
+      byte *row1 = b->matrix + s1 * b->rowbytes;
+
+      for(int s2 = s1 + 1; s2 < n; s2++)
+      {
+         byte *row2 = b->matrix + s2 * b->rowbytes;
+
+         if(PVS_GETBIT(row1, s2) || PVS_GETBIT(row2, s1))
+         {
+            PVS_SETBIT(row1, s2);
+            PVS_SETBIT(row2, s1);
+         }
+      }
+   }
+
+   P_pvsWriteCache(b);
+   return true;
+}
+
+//
+// P_pvsThread
+//
+static int P_pvsThread(void *data)
+{
+   pvsbuild_t *b = static_cast<pvsbuild_t *>(data);
+   bool success = P_pvsBuild(b);
+
+   i_halthreads.LockMutex(b->mutex);
+   b->success = success;
+   b->done    = true;
+   i_halthreads.UnlockMutex(b->mutex);
+
+   return 0;
+}
+
+//
+// P_pvsFreeBuild
+//
+// Free a build which is not running. If keepMatrix is true, ownership of
+// the matrix passes to the caller.
+//
+static void P_pvsFreeBuild(pvsbuild_t *b, bool keepMatrix)
+{
+   if(b->mutex)
+      i_halthreads.DestroyMutex(b->mutex);
+   if(!keepMatrix)
+      free(b->matrix);
+   free(b->portals);
+   free(b->firstportal);
+   free(b->secportals);
+   free(b->onpath);
+   free(b->floodstack);
+   free(b->cachefile);
+   free(b);
+}
+
+//=============================================================================
+//
+// Level Setup
+//
+
+struct pvsvertexref_t
+{
+   int     secnum;
+   fixed_t x, y;
+};
+
+static int P_pvsCompareRefs(const void *a, const void *b)
+{
+   const pvsvertexref_t *r1 = static_cast<const pvsvertexref_t *>(a);
+   const pvsvertexref_t *r2 = static_cast<const pvsvertexref_t *>(b);
+
+   if(r1->secnum != r2->secnum)
+      return r1->secnum < r2->secnum ? -1 : 1;
+   if(r1->x != r2->x)
+      return r1->x < r2->x ? -1 : 1;
+   if(r1->y != r2->y)
+      return r1->y < r2->y ? -1 : 1;
+   return 0;
+}
+
+//
+// P_pvsSectorsClosed
+//
+// The flow assumes sight can only pass between sectors by crossing a line
+// bounding both of them. That holds only if every sector is enclosed by its
+// own boundary lines, which means an even number of boundary line ends at
+// each vertex. Self-referencing sectors and unclosed sectors fail this, and
+// disable the PVS for the map.
+//
+static bool P_pvsSectorsClosed()
+{
+   pvsvertexref_t *refs = ecalloc(pvsvertexref_t *, numlines * 4, sizeof(*refs));
+   byte *hasline     = ecalloc(byte *, numsectors, 1);
+   byte *hasboundary = ecalloc(byte *, numsectors, 1);
+   int   numrefs = 0;
+   bool  closed  = true;
+
+   for(int i = 0; i < numlines; i++)
+   {
+      const line_t *li = &lines[i];
+      int front = li->frontsector ? li->frontsector - sectors : -1;
+      int back  = li->backsector  ? li->backsector  - sectors : -1;
+      int secs[2] = { front, back };
+
+      if(front >= 0)
+         hasline[front] = 1;
+      if(back >= 0)
+         hasline[back] = 1;
+
+      if(front == back)
+         continue;
+
+      for(int s = 0; s < 2; s++)
+      {
+         if(secs[s] < 0)
+            continue;
+
+         hasboundary[secs[s]] = 1;
+
+         refs[numrefs].secnum = secs[s];
+         refs[numrefs].x      = li->v1->x;
+         refs[numrefs].y      = li->v1->y;
+         ++numrefs;
+         refs[numrefs].secnum = secs[s];
+         refs[numrefs].x      = li->v2->x;
+         refs[numrefs].y      = li->v2->y;
+         ++numrefs;
+      }
+   }
+
+   for(int i = 0; i < numsectors; i++)
+   {
+      if(hasline[i] && !hasboundary[i])
+         closed = false;
+   }
+
+   if(closed)
+   {
+      qsort(refs, numrefs, sizeof(*refs), P_pvsCompareRefs);
+
+      for(int i = 0; i < numrefs; )
+      {
+         int j = i + 1;
+
+         while(j < numrefs && !P_pvsCompareRefs(&refs[i], &refs[j]))
+            ++j;
+
+         if((j - i) & 1)
+         {
+            closed = false;
+            break;
+         }
+         i = j;
+      }
+   }
+
+   efree(hasboundary);
+   efree(hasline);
+   efree(refs);
+
+   return closed;
+}
+
+//
+// P_pvsHasPortals
+//
+// Portals connect sectors without a shared line, which the flow cannot see.
+//
+static bool P_pvsHasPortals()
+{
+   for(int i = 0; i < numsectors; i++)
+   {
+      if(sectors[i].c_portal || sectors[i].f_portal)
+         return true;
+   }
+   for(int i = 0; i < numlines; i++)
+   {
+      if(lines[i].portal)
+         return true;
+   }
+   return false;
+}
+
+//
+// P_pvsCreateBuild
+//
+// Snapshot the level geometry the builder needs.
+//
+static pvsbuild_t *P_pvsCreateBuild()
+{
+   pvsbuild_t *b = static_cast<pvsbuild_t *>(calloc(1, sizeof(pvsbuild_t)));
+   HashData    hash(HashData::CRC32);
+   int32_t     hdr[3] = { PVS_VERSION, numsectors, numlines };
+
+   if(!b)
+      return NULL;
+
+   b->numsectors  = numsectors;
+   b->rowbytes    = (numsectors + 7) / 8;
+   b->portals     = static_cast<pvsportal_t *>(malloc(numlines * sizeof(pvsportal_t) + 1));
+   b->firstportal = static_cast<int *>(calloc(numsectors + 1, sizeof(int)));
+   b->secportals  = static_cast<int *>(malloc(2 * numlines * sizeof(int) + 1));
+   b->matrix      = static_cast<byte *>(calloc(numsectors, b->rowbytes));
+   b->onpath      = static_cast<byte *>(calloc(numlines + 1, 1));
+   b->floodstack  = static_cast<int *>(malloc(numsectors * sizeof(int)));
+
+   if(!b->portals || !b->firstportal || !b->secportals || !b->matrix ||
+      !b->onpath || !b->floodstack)
+   {
+      P_pvsFreeBuild(b, false);
+      return NULL;
+   }
+
+   hash.addData(reinterpret_cast<const uint8_t *>(hdr), sizeof(hdr));
+
+   for(int i = 0; i < numlines; i++)
+   {
+      const line_t *li = &lines[i];
+      int32_t data[6];
+
+      data[0] = li->v1->x;
+      data[1] = li->v1->y;
+      data[2] = li->v2->x;
+      data[3] = li->v2->y;
+      data[4] = li->frontsector ? li->frontsector - sectors : -1;
+      data[5] = li->backsector  ? li->backsector  - sectors : -1;
+      hash.addData(reinterpret_cast<const uint8_t *>(data), sizeof(data));
+
+      if(data[4] < 0 || data[5] < 0 || data[4] == data[5])
+         continue;
+
+      pvsportal_t &p = b->portals[b->numportals++];
+      p.x1 = M_FixedToDouble(li->v1->x);
+      p.y1 = M_FixedToDouble(li->v1->y);
+      p.x2 = M_FixedToDouble(li->v2->x);
+      p.y2 = M_FixedToDouble(li->v2->y);
+      p.sectors[0] = data[4];
+      p.sectors[1] = data[5];
+
+      ++b->firstportal[data[4] + 1];
+      ++b->firstportal[data[5] + 1];
+   }
+
+   hash.wrapUp();
+   b->key = hash.getDigestPart(0);
+
+   // convert counts to offsets, then bucket the portals by sector
+   for(int i = 0; i < numsectors; i++)
+      b->firstportal[i + 1] += b->firstportal[i];
+
+   int *fill = static_cast<int *>(malloc((numsectors + 1) * sizeof(int)));
+   if(!fill)
+   {
+      P_pvsFreeBuild(b, false);
+      return NULL;
+   }
+   memcpy(fill, b->firstportal, numsectors * sizeof(int));
+   for(int i = 0; i < b->numportals; i++)
+   {
+      b->secportals[fill[b->portals[i].sectors[0]]++] = i;
+      b->secportals[fill[b->portals[i].sectors[1]]++] = i;
+   }
+   free(fill);
+
+   return b;
+}
+
+//
+// P_pvsCachePath
+//
+static qstring P_pvsCachePath(uint32_t key)
+{
+   qstring path;
+   char    name[16];
+
+   psnprintf(name, sizeof(name), "%08x.pvs", key);
+   path = usergamepath;
+   path.pathConcatenate("pvs");
+   I_CreateDirectory(path);
+   path.pathConcatenate(name);
+
+   return path;
+}
+
+//
+// P_pvsLoadCache
+//
+// Returns true and installs the matrix if a valid cache file exists.
+//
+static bool P_pvsLoadCache(pvsbuild_t *b)
+{
+   FILE *f;
+   pvscacheheader_t header;
+   size_t size = (size_t)b->numsectors * b->rowbytes;
+   bool ok;
+
+   if(!b->cachefile || !(f = fopen(b->cachefile, "rb")))
+      return false;
+
+   ok = (fread(&header, sizeof(header), 1, f) == 1 &&
+         !memcmp(header.magic, pvsmagic, sizeof(header.magic)) &&
+         header.version    == PVS_VERSION   &&
+         header.key        == b->key        &&
+         header.numsectors == b->numsectors &&
+         header.rowbytes   == b->rowbytes   &&
+         fread(b->matrix, 1, size, f) == size);
+   fclose(f);
+
+   return ok;
+}
+
+//
+// P_pvsInstall
+//
+// Take ownership of a finished build's matrix.
+//
+static void P_pvsInstall(pvsbuild_t *b)
+{
+   pvsmatrix   = b->matrix;
+   pvsrowbytes = b->rowbytes;
+   P_pvsFreeBuild(b, true);
+}
+
+//
+// P_InitPVS
+//
+// Called at the end of level setup. Loads the PVS from the cache, or starts
+// building it.
+//
+void P_InitPVS()
+{
+   pvsbuild_t *b;
+
+   P_ClearPVS();
+
+   if(!pvs_enable || numsectors < 2 || numsectors > PVS_MAXSECTORS)
+      return;
+
+   if(P_pvsHasPortals() || !P_pvsSectorsClosed())
+      return;
+
+   if(!(b = P_pvsCreateBuild()))
+      return;
+
+   qstring path = P_pvsCachePath(b->key);
+   b->cachefile = strdup(path.constPtr());
+
+   if(P_pvsLoadCache(b))
+   {
+      P_pvsInstall(b);
+      return;
+   }
+
+   memset(b->matrix, 0, (size_t)b->numsectors * b->rowbytes);
+
+   if(i_halthreads.Available && (b->mutex = i_halthreads.CreateMutex()))
+   {
+      pvsbuild = b;
+      if((b->thread = i_halthreads.CreateThread(P_pvsThread, b)))
+         return;
+      pvsbuild = NULL;
+   }
+
+   // no thread available; build it now
+   if(P_pvsBuild(b))
+      P_pvsInstall(b);
+   else
+      P_pvsFreeBuild(b, false);
+}
+
+//
+// P_UpdatePVS
+//
+// Called every tic to pick up the result of a background build.
+//
+void P_UpdatePVS()
+{
+   pvsbuild_t *b = pvsbuild;
+   bool done;
+
+   if(!b)
+      return;
+
+   i_halthreads.LockMutex(b->mutex);
+   done = b->done;
+   i_halthreads.UnlockMutex(b->mutex);
+
+   if(!done)
+      return;
+
+   i_halthreads.WaitThread(b->thread);
+   pvsbuild = NULL;
+
+   if(b->success)
+      P_pvsInstall(b);
+   else
+      P_pvsFreeBuild(b, false);
+}
+
+//
+// P_ClearPVS
+//
+// Stop any build in progress and free the current level's PVS. Must be
+// called before the level's data is freed.
+//
+void P_ClearPVS()
+{
+   if(pvsbuild)
+   {
+      pvsbuild_t *b = pvsbuild;
+
+      i_halthreads.LockMutex(b->mutex);
+      b->abort = true;
+      i_halthreads.UnlockMutex(b->mutex);
+
+      i_halthreads.WaitThread(b->thread);
+      P_pvsFreeBuild(b, false);
+      pvsbuild = NULL;
+   }
+
+   if(pvsmatrix)
+   {
+      free(pvsmatrix);
+      pvsmatrix   = NULL;
+      pvsrowbytes = 0;
+   }
+}
+
+//=============================================================================
+//
+// Queries
+//
+
+//
+// P_PVSRow
+//
+// Returns the row of sectors potentially visible from a sector, or NULL if
+// no PVS is available.
+//
+const byte *P_PVSRow(int secnum)
+{
+   if(!pvsmatrix || !pvs_enable)
+      return NULL;
+
+   return pvsmatrix + secnum * pvsrowbytes;
+}
+
+//
+// P_PVSCheckSight
+//
+// Returns false if sight between two sectors is impossible. Demos and 
+// netgames never use it, since early rejection skips a validcount increment
+// that a full sight check would have made, and the PVS becomes available at
+// a time that depends on the machine.
+//
+bool P_PVSCheckSight(int secnum1, int secnum2)
+{
+   const byte *row;
+
+   if(demorecording || demoplayback || netgame || !(row = P_PVSRow(secnum1)))
+      return true;
+
+   return P_PVSVisible(row, secnum2);
+}
+
+// EOF
+
@@ -0,0 +1,54 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    Sector potentially-visible sets, built from the level geometry in a
+//    background thread and cached on disk.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef P_PVS_H__
+#define P_PVS_H__
+
+#include "doomtype.h"
+
+void P_InitPVS();
+void P_ClearPVS();
+void P_UpdatePVS();
+
+const byte *P_PVSRow(int secnum);
+bool P_PVSCheckSight(int secnum1, int secnum2);
+
+//
+// P_PVSVisible
+//
+// Test a sector against a row returned by P_PVSRow.
+//
+inline bool P_PVSVisible(const byte *row, int secnum)
+{
+   return !!(row[secnum >> 3] & (1 << (secnum & 7)));
+}
+
+extern bool pvs_enable;
+
+#endif
+
+// EOF
+
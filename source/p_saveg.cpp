@@ -1221,6 +1221,9 @@ void P_ArchiveButtons(SaveArchive &arc)
           << buttonlist[i].dopopout << buttonlist[i].line
           << buttonlist[i].side     << buttonlist[i].where;
    }
+
+   if(arc.isLoading())
+      P_CountActiveButtons();
 }
 
 //=============================================================================
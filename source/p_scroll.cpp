@@ -251,8 +251,8 @@ static void P_spawnCeilingScroller(int staticFn, line_t *l)
       staticFn == EV_STATIC_SCROLL_DISPLACE_CEILING)
       control = sides[*l->sidenum].sector - sectors;
 
-   for(int s = -1; (s = P_FindSectorFromLineTag(l, s)) >= 0;)
-      Add_Scroller(ScrollThinker::sc_ceiling, -dx, dy, control, s, accel);
+   for(const int *s = P_SectorsWithTag(l->tag); *s >= 0; s++)
+      Add_Scroller(ScrollThinker::sc_ceiling, -dx, dy, control, *s, accel);
 }
 
 //
@@ -277,8 +277,8 @@ static void P_spawnFloorScroller(int staticFn, line_t *l)
       staticFn == EV_STATIC_SCROLL_DISPLACE_FLOOR)
       control = sides[*l->sidenum].sector - sectors;
 
-   for(int s = -1; (s = P_FindSectorFromLineTag(l, s)) >= 0;)
-      Add_Scroller(ScrollThinker::sc_floor, -dx, dy, control, s, accel);
+   for(const int *s = P_SectorsWithTag(l->tag); *s >= 0; s++)
+      Add_Scroller(ScrollThinker::sc_floor, -dx, dy, control, *s, accel);
 }
 
 //
@@ -303,8 +303,8 @@ static void P_spawnFloorCarrier(int staticFn, line_t *l)
       staticFn == EV_STATIC_CARRY_DISPLACE_FLOOR)
       control = sides[*l->sidenum].sector - sectors;
 
-   for(int s = -1; (s = P_FindSectorFromLineTag(l, s)) >= 0;)
-      Add_Scroller(ScrollThinker::sc_carry, dx, dy, control, s, accel);
+   for(const int *s = P_SectorsWithTag(l->tag); *s >= 0; s++)
+      Add_Scroller(ScrollThinker::sc_carry, dx, dy, control, *s, accel);
 }
 
 //
@@ -330,7 +330,7 @@ static void P_spawnFloorScrollAndCarry(int staticFn, line_t *l)
       staticFn == EV_STATIC_SCROLL_CARRY_DISPLACE_FLOOR)
       control = sides[*l->sidenum].sector - sectors;
 
-   for(s = -1; (s = P_FindSectorFromLineTag(l, s)) >= 0; )
+   P_FOR_SECTORS_WITH_TAG(l->tag, s)
       Add_Scroller(ScrollThinker::sc_floor, -dx, dy, control, s, accel);
 
    dx = FixedMul(dx, CARRYFACTOR);
@@ -338,7 +338,7 @@ static void P_spawnFloorScrollAndCarry(int staticFn, line_t *l)
 
    // NB: don't fold these loops together. Even though it would be more
    // efficient, we must maintain BOOM-compatible thinker spawning order.
-   for(s = -1; (s = P_FindSectorFromLineTag(l, s)) >= 0; )
+   P_FOR_SECTORS_WITH_TAG(l->tag, s)
       Add_Scroller(ScrollThinker::sc_carry, dx, dy, control, s, accel);
 }
 
@@ -367,10 +367,10 @@ static void P_spawnDynamicWallScroller(int staticFn, line_t *l, int linenum)
 
    // killough 3/1/98: scroll wall according to linedef
    // (same direction and speed as scrolling floors)
-   for(int s = -1; (s = P_FindLineFromLineTag(l, s)) >= 0;)
+   for(const int *s = P_LinesWithTag(l->tag); *s >= 0; s++)
    {
-      if(s != linenum)
-         Add_WallScroller(dx, dy, lines + s, control, accel);
+      if(*s != linenum)
+         Add_WallScroller(dx, dy, lines + *s, control, accel);
    }
 }
 
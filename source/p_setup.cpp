@@ -27,6 +27,8 @@
 #include "z_zone.h"
 
 #include "a_small.h"
+#include "hal/i_timer.h"
+
 #include "acs_intr.h"
 #include "am_map.h"
 #include "c_io.h"
@@ -47,6 +49,7 @@
 #include "m_argv.h"
 #include "m_bbox.h"
 #include "m_binary.h"
+#include "m_collection.h"
 #include "p_anim.h"  // haleyjd: lightning
 #include "p_chase.h"
 #include "p_enemy.h"
@@ -57,9 +60,11 @@
 #include "p_mobjcol.h"
 #include "p_partcl.h"
 #include "p_portal.h"
+#include "p_pvs.h"
 #include "p_setup.h"
 #include "p_skin.h"
 #include "p_slopes.h"
+#include "p_spatial.h"
 #include "p_spec.h"
 #include "p_tick.h"
 #include "polyobj.h"
@@ -68,6 +73,7 @@
 #include "r_dynseg.h"
 #include "r_main.h"
 #include "r_sky.h"
+#include "r_state.h"
 #include "r_things.h"
 #include "s_sndseq.h"
 #include "s_sound.h"
@@ -143,6 +149,12 @@ Mobj    **blocklinks;             // for thing chains
 
 byte     *portalmap;              // haleyjd: for portals
 
+blockcell_t      *blockcells;     // compact blockmap
+blocklineboxes_t  blocklineboxes;
+
+static int blockmapsize;          // number of ints in blockmaplump
+static int numblockentries;       // number of entries in blocklineboxes
+
 //
 // REJECT
 // For fast sight rejection.
@@ -273,7 +285,7 @@ void P_LoadConsoleVertexes(int lump)
    numvertexes = setupwad->lumpLength(lump) / PSX_VERTEX_LEN;
 
    // Allocate
-   vertexes = estructalloctag(vertex_t, numvertexes, PU_LEVEL);
+   vertexes = estructalloclevel(vertex_t, numvertexes);
 
    // Load lump
    setupwad->cacheLumpAuto(lump, buf);
@@ -304,7 +316,7 @@ void P_LoadVertexes(int lump)
    numvertexes = setupwad->lumpLength(lump) / DOOM_VERTEX_LEN;
 
    // Allocate zone memory for buffer.
-   vertexes = estructalloctag(vertex_t, numvertexes, PU_LEVEL);
+   vertexes = estructalloclevel(vertex_t, numvertexes);
    
    // Load data into cache.
    setupwad->cacheLumpAuto(lump, buf);
@@ -333,7 +345,7 @@ void P_LoadSegs(int lump)
    byte *data;
    
    numsegs = setupwad->lumpLength(lump) / sizeof(mapseg_t);
-   segs = estructalloctag(seg_t, numsegs, PU_LEVEL);
+   segs = estructalloclevel(seg_t, numsegs);
    data = (byte *)(setupwad->cacheLumpNum(lump, PU_STATIC));
    
    for(i = 0; i < numsegs; ++i)
@@ -400,7 +412,7 @@ void P_LoadSubsectors(int lump)
    int  i;
    
    numsubsectors = setupwad->lumpLength(lump) / sizeof(mapsubsector_t);
-   subsectors = estructalloctag(subsector_t, numsubsectors, PU_LEVEL);
+   subsectors = estructalloclevel(subsector_t, numsubsectors);
    data = (byte *)(setupwad->cacheLumpNum(lump, PU_STATIC));
    
    for(i = 0; i < numsubsectors; ++i)
@@ -517,7 +529,7 @@ void P_LoadPSXSectors(int lumpnum)
    char namebuf[9];
    
    numsectors  = setupwad->lumpLength(lumpnum) / PSX_SECTOR_SIZE;
-   sectors     = estructalloctag(sector_t, numsectors, PU_LEVEL);
+   sectors     = estructalloclevel(sector_t, numsectors);
    
    setupwad->cacheLumpAuto(lumpnum, buf);
    auto data = buf.getAs<byte *>();
@@ -556,7 +568,7 @@ void P_LoadSectors(int lumpnum)
    char namebuf[9];
    
    numsectors  = setupwad->lumpLength(lumpnum) / DOOM_SECTOR_SIZE;
-   sectors     = estructalloctag(sector_t, numsectors, PU_LEVEL);
+   sectors     = estructalloclevel(sector_t, numsectors);
    
    setupwad->cacheLumpAuto(lumpnum, buf);
    auto data = buf.getAs<byte *>();
@@ -590,7 +602,7 @@ void P_LoadSectors(int lumpnum)
 //
 static void P_CreateSectorInterps()
 {
-   sectorinterps = estructalloctag(sectorinterp_t, numsectors, PU_LEVEL);
+   sectorinterps = estructalloclevel(sectorinterp_t, numsectors);
 
    for(int i = 0; i < numsectors; i++)
    {
@@ -654,7 +666,7 @@ static void P_CreateSoundZones()
    }
 
    // allocate soundzones
-   soundzones = estructalloctag(soundzone_t, numsoundzones, PU_LEVEL);
+   soundzones = estructalloclevel(soundzone_t, numsoundzones);
    
    // set all zones to level default reverb, or engine default if level default
    // is not a valid reverb.
@@ -711,8 +723,8 @@ void P_LoadNodes(int lump)
       return;
    }
 
-   nodes  = estructalloctag(node_t,  numnodes, PU_LEVEL);
-   fnodes = estructalloctag(fnode_t, numnodes, PU_LEVEL);
+   nodes  = estructalloclevel(node_t,  numnodes);
+   fnodes = estructalloclevel(fnode_t, numnodes);
    data   = (byte *)(setupwad->cacheLumpNum(lump, PU_STATIC));
 
    for(i = 0; i < numnodes; i++)
@@ -906,7 +918,7 @@ static void P_LoadZNodes(int lump)
    }
    else
    {
-      newvertarray = ecalloc(vertex_t *, orgVerts + newVerts, sizeof(vertex_t));
+      newvertarray = ecalloclevel(vertex_t *, orgVerts + newVerts, sizeof(vertex_t));
       memcpy(newvertarray, vertexes, orgVerts * sizeof(vertex_t));
    }
 
@@ -931,7 +943,6 @@ static void P_LoadZNodes(int lump)
          lines[i].v1 = lines[i].v1 - vertexes + newvertarray;
          lines[i].v2 = lines[i].v2 - vertexes + newvertarray;
       }
-      efree(vertexes);
       vertexes = newvertarray;
       numvertexes = (int)(orgVerts + newVerts);
    }
@@ -947,7 +958,7 @@ static void P_LoadZNodes(int lump)
       Z_Free(lumpptr);
       return;
    }
-   subsectors = ecalloc(subsector_t *, numsubsectors, sizeof(subsector_t));
+   subsectors = ecalloclevel(subsector_t *, numsubsectors, sizeof(subsector_t));
 
    CheckZNodesOverflow(len, numSubs * sizeof(uint32_t));
    for(i = currSeg = 0; i < numSubs; i++)
@@ -971,7 +982,7 @@ static void P_LoadZNodes(int lump)
    }
 
    numsegs = (int)numSegs;
-   segs = ecalloc(seg_t *, numsegs, sizeof(seg_t));
+   segs = ecalloclevel(seg_t *, numsegs, sizeof(seg_t));
 
    CheckZNodesOverflow(len, numsegs * 11);
    P_LoadZSegs(data);
@@ -982,8 +993,8 @@ static void P_LoadZNodes(int lump)
    numNodes = GetBinaryUDWord(&data);
 
    numnodes = numNodes;
-   nodes  = estructalloctag(node_t,  numNodes, PU_LEVEL);
-   fnodes = estructalloctag(fnode_t, numNodes, PU_LEVEL);
+   nodes  = estructalloclevel(node_t,  numNodes);
+   fnodes = estructalloclevel(fnode_t, numNodes);
 
    CheckZNodesOverflow(len, numNodes * 32);
    for (i = 0; i < numNodes; i++)
@@ -1278,7 +1289,7 @@ void P_LoadLineDefs(int lump)
    byte *data;
 
    numlines = setupwad->lumpLength(lump) / sizeof(maplinedef_t);
-   lines    = estructalloctag(line_t, numlines, PU_LEVEL);
+   lines    = estructalloclevel(line_t, numlines);
    data     = (byte *)(setupwad->cacheLumpNum(lump, PU_STATIC));
 
    for(int i = 0; i < numlines; i++)
@@ -1390,7 +1401,7 @@ void P_LoadHexenLineDefs(int lump)
    int  i;
 
    numlines = setupwad->lumpLength(lump) / sizeof(maplinedefhexen_t);
-   lines    = estructalloctag(line_t, numlines, PU_LEVEL);
+   lines    = estructalloclevel(line_t, numlines);
    data     = (byte *)(setupwad->cacheLumpNum(lump, PU_STATIC));
 
    for(i = 0; i < numlines; ++i)
@@ -1514,7 +1525,7 @@ void P_LoadLineDefs2()
 void P_LoadSideDefs(int lump)
 {
    numsides = setupwad->lumpLength(lump) / sizeof(mapsidedef_t);
-   sides    = estructalloctag(side_t, numsides, PU_LEVEL);
+   sides    = estructalloclevel(side_t, numsides);
 }
 
 // killough 4/4/98: delay using texture names until
@@ -1773,8 +1784,8 @@ static void P_CreateBlockMap(void)
          }
 
          // Allocate blockmap lump with computed count
-         blockmaplump = (int *)(Z_Malloc(sizeof(*blockmaplump) * count, 
-                                         PU_LEVEL, 0));
+         blockmaplump = ecalloclevel(int *, count, sizeof(*blockmaplump));
+         blockmapsize = count;
       }
 
       // Now compress the blockmap.
@@ -1880,6 +1891,139 @@ static bool P_VerifyBlockMap(int count)
    return isvalid;
 }
 
+//
+// P_blockEntryLine
+//
+// Returns the line number stored in a raw blockmap list entry, or -1 if
+// it does not name a valid line.
+//
+static int P_blockEntryLine(int entry)
+{
+   return (entry >= 0 && entry < numlines) ? entry : -1;
+}
+
+//
+// P_setBlockEntry
+//
+// Fills in one entry of the compact blockmap. Entries that do not refer to a
+// line get an inverted box which no bbox can overlap.
+//
+static void P_setBlockEntry(int index, int linenum)
+{
+   blocklineboxes_t &b = blocklineboxes;
+
+   b.linenum[index] = linenum;
+
+   if(linenum >= 0)
+   {
+      const fixed_t *bbox = lines[linenum].bbox;
+
+      b.left  [index] = bbox[BOXLEFT];
+      b.right [index] = bbox[BOXRIGHT];
+      b.bottom[index] = bbox[BOXBOTTOM];
+      b.top   [index] = bbox[BOXTOP];
+   }
+   else
+   {
+      b.left  [index] = D_MAXINT;
+      b.right [index] = D_MININT;
+      b.bottom[index] = D_MAXINT;
+      b.top   [index] = D_MININT;
+   }
+}
+
+//
+// P_BuildBlockCells
+//
+// Converts the blockmap into the compact per-cell form used by
+// P_BlockLinesIterator. Each cell stores the list exactly as it is walked
+// outside of demo_compatibility, from the entry after the cell's offset up
+// to the -1 terminator; the skipped first entry is kept as the cell's head
+// for demo_compatibility, which reads it as well.
+//
+static void P_BuildBlockCells()
+{
+   int numcells = bmapwidth * bmapheight;
+   int cellnum, total = 0;
+
+   blockcells = estructalloclevel(blockcell_t, numcells);
+
+   // first pass: count entries
+   for(cellnum = 0; cellnum < numcells; cellnum++)
+   {
+      blockcell_t *cell = &blockcells[cellnum];
+      int offset = blockmap[cellnum];
+      int count  = 0;
+
+      cell->start = total;
+      cell->head  = -1;
+
+      if(offset < 0 || offset >= blockmapsize)
+         continue;
+
+      cell->head = blockmaplump[offset];
+
+      for(int i = offset + 1; i < blockmapsize && blockmaplump[i] != -1; i++)
+         ++count;
+
+      cell->count = (count + 3) & ~3;
+      total += cell->count;
+   }
+
+   numblockentries = total;
+
+   blocklineboxes.left    = ecalloclevel(fixed_t *, total, sizeof(fixed_t));
+   blocklineboxes.right   = ecalloclevel(fixed_t *, total, sizeof(fixed_t));
+   blocklineboxes.bottom  = ecalloclevel(fixed_t *, total, sizeof(fixed_t));
+   blocklineboxes.top     = ecalloclevel(fixed_t *, total, sizeof(fixed_t));
+   blocklineboxes.linenum = ecalloclevel(int *,     total, sizeof(int));
+
+   // second pass: fill in line numbers and boxes
+   for(cellnum = 0; cellnum < numcells; cellnum++)
+   {
+      blockcell_t *cell = &blockcells[cellnum];
+      int index = cell->start;
+      int end   = cell->start + cell->count;
+
+      if(cell->count)
+      {
+         int offset = blockmap[cellnum];
+
+         for(int i = offset + 1; i < blockmapsize && blockmaplump[i] != -1; i++)
+            P_setBlockEntry(index++, P_blockEntryLine(blockmaplump[i]));
+      }
+
+      while(index < end)
+         P_setBlockEntry(index++, -1);
+   }
+}
+
+//
+// P_UnboxBlockLines
+//
+// Polyobject lines move, so the compact blockmap cannot cache their
+// bounding boxes. Every entry for a line marked in linemask is given a box
+// spanning the whole map, so that it always reaches the iterator callback,
+// which then tests the line's current bbox itself.
+//
+void P_UnboxBlockLines(const byte *linemask)
+{
+   blocklineboxes_t &b = blocklineboxes;
+
+   for(int i = 0; i < numblockentries; i++)
+   {
+      int linenum = b.linenum[i];
+
+      if(linenum >= 0 && linemask[linenum])
+      {
+         b.left  [i] = D_MININT;
+         b.right [i] = D_MAXINT;
+         b.bottom[i] = D_MININT;
+         b.top   [i] = D_MAXINT;
+      }
+   }
+}
+
 //
 // P_LoadBlockMap
 //
@@ -1906,6 +2050,7 @@ void P_LoadBlockMap(int lump)
       int16_t *wadblockmaplump = (int16_t *)(setupwad->cacheLumpNum(lump, PU_LEVEL));
       blockmaplump = (int *)(Z_Malloc(sizeof(*blockmaplump) * count,
                                       PU_LEVEL, NULL));
+      blockmapsize = count;
 
       // killough 3/1/98: Expand wad blockmap into larger internal one,
       // by treating all offsets except -1 as unsigned and zero-extending
@@ -1942,16 +2087,22 @@ void P_LoadBlockMap(int lump)
 
    // clear out mobj chains
    count      = sizeof(*blocklinks) * bmapwidth * bmapheight;
-   blocklinks = ecalloctag(Mobj **, 1, count, PU_LEVEL, NULL);
+   blocklinks = ecalloclevel(Mobj **, 1, count);
    blockmap   = blockmaplump + 4;
 
    // haleyjd 2/22/06: setup polyobject blockmap
    count = sizeof(*polyblocklinks) * bmapwidth * bmapheight;
-   polyblocklinks = ecalloctag(DLListItem<polymaplink_t> **, 1, count, PU_LEVEL, NULL);
+   polyblocklinks = ecalloclevel(DLListItem<polymaplink_t> **, 1, count);
 
    // haleyjd 05/17/13: setup portalmap
    count = sizeof(*portalmap) * bmapwidth * bmapheight;
-   portalmap = ecalloctag(byte *, 1, count, PU_LEVEL, NULL);
+   portalmap = ecalloclevel(byte *, 1, count);
+
+   // build compact blockmap
+   P_BuildBlockCells();
+
+   // create empty Mobj spatial hash
+   P_InitSpatialHash();
 }
 
 
@@ -2004,7 +2155,7 @@ void P_GroupLines()
    }
 
    // build line tables for each sector
-   linebuffer = (line_t **)(Z_Malloc(total * sizeof(*linebuffer), PU_LEVEL, 0));
+   linebuffer = ecalloclevel(line_t **, total, sizeof(*linebuffer));
 
    for(i = 0; i < numsectors; i++)
    {
@@ -2190,7 +2341,7 @@ static void P_LoadReject(int lump)
    else
    {
       // set to all zeroes so that the reject has no effect
-      rejectmatrix = (byte *)(Z_Calloc(1, expectedsize, PU_LEVEL, NULL));
+      rejectmatrix = ecalloclevel(byte *, 1, expectedsize);
 
       if(size > 0)
       {
@@ -2414,6 +2565,12 @@ static void P_PreZoneFreeLevel()
 
    P_ClearPlayerVars();
 
+   //==============================================
+   // Visibility
+
+   // stop any PVS build still reading this level
+   P_ClearPVS();
+
    //==============================================
    // Scripting
 
@@ -2588,6 +2745,12 @@ void P_SetupLevel(WadDirectory *dir, const char *mapname, int playermask,
    // this routine.
    gamestate = GS_LOADING;
 
+   // any prefetch still running is no longer of use
+   P_CancelLevelPrefetch();
+
+   // count lump lookups made while loading
+   W_BeginLookupStats();
+
    // haleyjd 06/14/10: support loading levels from private wad directories
    setupwad = dir;
    lumpinfo = setupwad->getLumpInfo();
@@ -2619,6 +2782,9 @@ void P_SetupLevel(WadDirectory *dir, const char *mapname, int playermask,
    // free the old level
    Z_FreeTags(PU_LEVEL, PU_LEVEL);
 
+   // nothing cached for the old level is valid now
+   P_InvalidateSightCache();
+
    // perform post-Z_FreeTags actions
    P_InitNewLevel(lumpnum, dir);
 
@@ -2733,6 +2899,9 @@ void P_SetupLevel(WadDirectory *dir, const char *mapname, int playermask,
    // SoM: Deferred specials that need to be spawned after P_SpawnSpecials
    P_SpawnDeferredSpecials();
 
+   // load or start building the PVS now that portals exist
+   P_InitPVS();
+
    // haleyjd
    P_InitLightning();
 
@@ -2760,6 +2929,257 @@ void P_SetupLevel(WadDirectory *dir, const char *mapname, int playermask,
       acslumpnum = setupwad->checkNumForName(LevelInfo.acsScriptLump);
 
    ACS_LoadLevelScript(dir, acslumpnum);
+
+   W_EndLookupStats();
+}
+
+//=============================================================================
+//
+// Level Prefetch
+//
+// While the intermission is up, the next map's lumps and the textures,
+// flats, and sprites it uses are read ahead into the cache, a little at a
+// time each tic, so that P_SetupLevel and R_PrecacheLevel find them already
+// loaded. Everything done here only warms caches; it has no effect on game
+// state, so a wrong guess at the next map costs nothing but the time spent.
+//
+
+enum
+{
+   PF_IDLE,     // nothing to do
+   PF_MAPLUMPS, // caching map lumps
+   PF_SCAN,     // finding the resources the map uses
+   PF_TEXTURES, // building textures
+   PF_SPRITES,  // caching sprite lumps
+};
+
+#define PREFETCH_MS 8 // time to spend per tic
+
+static int                pfstate = PF_IDLE;
+static WadDirectory      *pfdir;
+static int                pfmaplump;
+static int                pfformat;
+static int                pfpos;
+static PODCollection<int> pfitems;
+
+//
+// P_CancelLevelPrefetch
+//
+void P_CancelLevelPrefetch()
+{
+   pfstate = PF_IDLE;
+   pfdir   = NULL;
+   pfitems.clear();
+}
+
+//
+// P_StartLevelPrefetch
+//
+// Begin prefetching a map, replacing any prefetch in progress.
+//
+void P_StartLevelPrefetch(WadDirectory *dir, const char *mapname)
+{
+   int lumpnum;
+
+   P_CancelLevelPrefetch();
+
+   // like R_PrecacheLevel, stay out of the way of timed demos
+   if(!r_precache || demoplayback)
+      return;
+
+   if((lumpnum = dir->checkNumForName(mapname)) < 0)
+      return;
+
+   pfformat = P_CheckLevel(dir, lumpnum);
+   if(pfformat != LEVEL_FORMAT_DOOM && pfformat != LEVEL_FORMAT_HEXEN)
+      return;
+
+   pfdir     = dir;
+   pfmaplump = lumpnum;
+   pfpos     = ML_THINGS;
+   pfstate   = PF_MAPLUMPS;
+}
+
+//
+// P_prefetchScan
+//
+// Find the textures, flats, and sprites a map uses from its lumps, which
+// have already been cached.
+//
+static void P_prefetchScan()
+{
+   byte *hitlist = ecalloc(byte *, 1, texturecount > numsprites ? 
+                                      texturecount : numsprites);
+   PODCollection<int> lumps;
+   char name[9];
+   byte *data;
+   int   count;
+
+   name[8] = '\0';
+
+   // walls
+   data  = (byte *)(pfdir->cacheLumpNum(pfmaplump + ML_SIDEDEFS, PU_STATIC));
+   count = pfdir->lumpLength(pfmaplump + ML_SIDEDEFS) / sizeof(mapsidedef_t);
+
+   for(int i = 0; i < count; i++)
+   {
+      const mapsidedef_t *msd = (const mapsidedef_t *)data + i;
+      const char *texnames[3] = 
+      { 
+         msd->toptexture, msd->bottomtexture, msd->midtexture 
+      };
+      int texnum;
+
+      for(int t = 0; t < 3; t++)
+      {
+         memcpy(name, texnames[t], 8);
+         if((texnum = R_CheckForWall(name)) > 0)
+            hitlist[texnum] = 1;
+      }
+   }
+   Z_ChangeTag(data, PU_CACHE);
+
+   // flats
+   data  = (byte *)(pfdir->cacheLumpNum(pfmaplump + ML_SECTORS, PU_STATIC));
+   count = pfdir->lumpLength(pfmaplump + ML_SECTORS) / sizeof(mapsector_t);
+
+   for(int i = 0; i < count; i++)
+   {
+      const mapsector_t *ms = (const mapsector_t *)data + i;
+      int texnum;
+
+      memcpy(name, ms->floorpic, 8);
+      if((texnum = R_CheckForFlat(name)) >= 0)
+         hitlist[texnum] = 1;
+      memcpy(name, ms->ceilingpic, 8);
+      if((texnum = R_CheckForFlat(name)) >= 0)
+         hitlist[texnum] = 1;
+   }
+   Z_ChangeTag(data, PU_CACHE);
+
+   for(int i = 0; i < texturecount; i++)
+   {
+      if(!hitlist[i])
+         continue;
+
+      texture_t *tex = textures[i];
+
+      pfitems.add(i);
+      for(int c = 0; c < tex->ccount; c++)
+         lumps.add(tex->components[c].lump);
+   }
+
+   // sprites, from the spawn states of the map's things
+   memset(hitlist, 0, numsprites);
+
+   data  = (byte *)(pfdir->cacheLumpNum(pfmaplump + ML_THINGS, PU_STATIC));
+   if(pfformat == LEVEL_FORMAT_HEXEN)
+      count = pfdir->lumpLength(pfmaplump + ML_THINGS) / sizeof(mapthinghexen_t);
+   else
+      count = pfdir->lumpLength(pfmaplump + ML_THINGS) / sizeof(mapthingdoom_t);
+
+   for(int i = 0; i < count; i++)
+   {
+      int16_t type;
+      int     mobjtype, sprite;
+
+      if(pfformat == LEVEL_FORMAT_HEXEN)
+         type = SwapShort(((const mapthinghexen_t *)data)[i].type);
+      else
+         type = SwapShort(((const mapthingdoom_t *)data)[i].type);
+
+      if((mobjtype = P_FindDoomedNum(type)) >= NUMMOBJTYPES)
+         continue;
+
+      sprite = states[mobjinfo[mobjtype]->spawnstate]->sprite;
+      if(sprite >= 0 && sprite < numsprites)
+         hitlist[sprite] = 1;
+   }
+   Z_ChangeTag(data, PU_CACHE);
+
+   // the list switches to sprite lumps once the textures are done
+   pfpos = pfitems.getLength();
+   for(int i = 0; i < numsprites; i++)
+   {
+      if(!hitlist[i])
+         continue;
+
+      for(int j = 0; j < sprites[i].numframes; j++)
+      {
+         const spriteframe_t &frame = sprites[i].spriteframes[j];
+
+         for(int k = 0; k < (frame.rotate ? 8 : 1); k++)
+         {
+            int lump;
+
+            if(frame.lump[k] < 0)
+               continue;
+
+            lump = firstspritelump + frame.lump[k];
+            pfitems.add(lump);
+            lumps.add(lump);
+         }
+      }
+   }
+
+   efree(hitlist);
+
+   // inflate any of them that come from zip files all at once
+   if(!lumps.isEmpty())
+      wGlobalDir.prefetchLumps(&lumps[0], static_cast<int>(lumps.getLength()));
+}
+
+//
+// P_RunLevelPrefetch
+//
+// Do some prefetching; called every intermission tic.
+//
+void P_RunLevelPrefetch()
+{
+   static int spritestart;
+   unsigned int start = i_haltimer.GetTicks();
+
+   do
+   {
+      switch(pfstate)
+      {
+      case PF_MAPLUMPS:
+         if(pfpos <= ML_BEHAVIOR && pfmaplump + pfpos < pfdir->getNumLumps() &&
+            (pfpos < ML_BEHAVIOR || pfformat == LEVEL_FORMAT_HEXEN))
+         {
+            pfdir->cacheLumpNum(pfmaplump + pfpos, PU_CACHE);
+            ++pfpos;
+         }
+         else
+            pfstate = PF_SCAN;
+         break;
+
+      case PF_SCAN:
+         P_prefetchScan();
+         spritestart = pfpos;
+         pfpos   = 0;
+         pfstate = PF_TEXTURES;
+         break;
+
+      case PF_TEXTURES:
+         if(pfpos < spritestart)
+            R_CacheTexture(pfitems[pfpos++]);
+         else
+            pfstate = PF_SPRITES;
+         break;
+
+      case PF_SPRITES:
+         if(pfpos < static_cast<int>(pfitems.getLength()))
+            wGlobalDir.cacheLumpNum(pfitems[pfpos++], PU_CACHE);
+         else
+            P_CancelLevelPrefetch();
+         break;
+
+      default:
+         return;
+      }
+   }
+   while(i_haltimer.GetTicks() - start < PREFETCH_MS);
 }
 
 //
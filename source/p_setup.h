@@ -49,6 +49,9 @@ int P_CheckLevelName(WadDirectory *dir, const char *mapname);
 int P_CheckLevelMapNum(WadDirectory *dir, int mapnum);
 
 void P_SetupLevel(WadDirectory *dir, const char *mapname, int playermask, skill_t skill);
+void P_StartLevelPrefetch(WadDirectory *dir, const char *mapname);
+void P_RunLevelPrefetch();
+void P_CancelLevelPrefetch();
 void P_Init();                   // Called by startup code.
 void P_InitThingLists();
 
@@ -64,6 +67,32 @@ extern fixed_t  bmaporgy;        // origin of block map
 extern Mobj   **blocklinks;      // for thing chains
 extern byte    *portalmap;       // haleyjd: for fast linked portal checks
 
+// Compact blockmap, built from the one above at load time. Each cell's line
+// list is a contiguous run of entries in blocklineboxes, which keeps every
+// line's bounding box in structure-of-arrays form so that collision code can
+// reject lines without touching their line_t. Runs are padded to a multiple
+// of 4 entries with boxes that never touch anything.
+struct blockcell_t
+{
+   int start; // first entry of this cell in blocklineboxes
+   int count; // number of entries, including padding
+   int head;  // first raw list entry, only read under demo_compatibility
+};
+
+struct blocklineboxes_t
+{
+   fixed_t *left;    // line bounding boxes
+   fixed_t *right;
+   fixed_t *bottom;
+   fixed_t *top;
+   int     *linenum; // line numbers; -1 for padding and invalid entries
+};
+
+extern blockcell_t      *blockcells;
+extern blocklineboxes_t  blocklineboxes;
+
+void P_UnboxBlockLines(const byte *linemask);
+
 // haleyjd 05/17/13: portalmap flags
 enum
 {
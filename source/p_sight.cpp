@@ -30,7 +30,9 @@
 #include "doomstat.h"
 #include "e_exdata.h"
 #include "m_bbox.h"
+#include "p_map.h"
 #include "p_maputl.h"
+#include "p_pvs.h"
 #include "p_setup.h"
 #include "r_dynseg.h"
 #include "r_main.h"
@@ -319,8 +321,9 @@ static bool P_CrossBSPNode(int bspnum, register los_t *los)
 // Uses REJECT.
 //
 // killough 4/20/98: cleaned up, made to use new LOS struct
+// Renamed, now called through the sight cache below.
 
-bool P_CheckSight(Mobj *t1, Mobj *t2)
+static bool P_checkSightUncached(Mobj *t1, Mobj *t2)
 {
    if(full_demo_version >= make_full_version(340, 24))
    {
@@ -344,6 +347,10 @@ bool P_CheckSight(Mobj *t1, Mobj *t2)
    if(rejectmatrix[pnum>>3] & (1 << (pnum&7)))   // can't possibly be connected
       return false;
 
+   // the PVS can reject what REJECT doesn't
+   if(!P_PVSCheckSight(s1 - sectors, s2 - sectors))
+      return false;
+
    // killough 4/19/98: make fake floors and ceilings block monster view
    if((s1->heightsec != -1 &&
        ((t1->z + t1->height <= sectors[s1->heightsec].floorheight &&
@@ -394,6 +401,189 @@ bool P_CheckSight(Mobj *t1, Mobj *t2)
    return P_CrossBSPNode(numnodes-1, &los);
 }
 
+//=============================================================================
+//
+// Sight Check Cache
+//
+// A_Chase, P_CheckMissileRange, P_CheckMeleeRange and P_RadiusAttack
+// frequently repeat the same looker/target query within a single tic.
+// Results are memoized in a direct-mapped table keyed by every input the
+// traversal reads from the two objects. Entries belong to an epoch which
+// advances each tic and whenever level geometry moves, so a hit always
+// returns exactly what the full traversal would have.
+//
+
+#define SIGHTCACHESIZE 4096 // must be a power of two
+
+struct sightcacheentry_t
+{
+   fixed_t      x1, y1, z1, height1; // looker
+   fixed_t      x2, y2, z2, height2; // target
+   int          groupid1, groupid2;
+   unsigned int epoch;               // valid only if equal to sightepoch
+   int          validcount;          // validcount increments done by the check
+   bool         result;
+};
+
+static sightcacheentry_t sightcache[SIGHTCACHESIZE];
+static unsigned int      sightepoch = 1;
+static int               sightcachetic = -1;
+static sightcachestats_t sightstats;
+
+bool sight_cache = true;
+
+//
+// P_InvalidateSightCache
+//
+// Call whenever something the sight traversal depends on changes, such as
+// sector heights or polyobject positions.
+//
+void P_InvalidateSightCache()
+{
+   // on wraparound, old entries could alias the new epoch
+   if(++sightepoch == 0)
+   {
+      memset(sightcache, 0, sizeof(sightcache));
+      sightepoch = 1;
+   }
+   ++sightstats.invalidations;
+}
+
+//
+// P_GetSightCacheStats
+//
+void P_GetSightCacheStats(sightcachestats_t &stats)
+{
+   stats = sightstats;
+}
+
+//
+// P_ResetSightCacheStats
+//
+void P_ResetSightCacheStats()
+{
+   memset(&sightstats, 0, sizeof(sightstats));
+}
+
+//
+// P_sightCacheNewTic
+//
+// A new tic starts a new epoch.
+//
+static void P_sightCacheNewTic()
+{
+   if(leveltime != sightcachetic)
+   {
+      sightcachetic = leveltime;
+      P_InvalidateSightCache();
+   }
+}
+
+//
+// P_sightCacheSlot
+//
+static sightcacheentry_t &P_sightCacheSlot(const Mobj *t1, const Mobj *t2)
+{
+   uint32_t h;
+
+   h  = (uint32_t)t1->x * 0x9E3779B1u;
+   h ^= (uint32_t)t1->y * 0x85EBCA77u;
+   h ^= (uint32_t)t2->x * 0xC2B2AE3Du;
+   h ^= (uint32_t)t2->y * 0x27D4EB2Fu;
+   h ^= (uint32_t)(t1->z ^ (t2->z >> 7)) * 0x165667B1u;
+   h ^= h >> 15;
+
+   return sightcache[h & (SIGHTCACHESIZE - 1)];
+}
+
+//
+// P_sightCacheStore
+//
+static void P_sightCacheStore(sightcacheentry_t &entry, const Mobj *t1, 
+                              const Mobj *t2, bool result, int validcountinc)
+{
+   entry.x1         = t1->x;
+   entry.y1         = t1->y;
+   entry.z1         = t1->z;
+   entry.height1    = t1->height;
+   entry.x2         = t2->x;
+   entry.y2         = t2->y;
+   entry.z2         = t2->z;
+   entry.height2    = t2->height;
+   entry.groupid1   = t1->groupid;
+   entry.groupid2   = t2->groupid;
+   entry.epoch      = sightepoch;
+   entry.validcount = validcountinc;
+   entry.result     = result;
+}
+
+//
+// P_CheckSight
+//
+// Returns true if a straight line between t1 and t2 is unobstructed,
+// consulting the per-tic cache before doing a full traversal.
+//
+bool P_CheckSight(Mobj *t1, Mobj *t2)
+{
+   if(!sight_cache)
+      return P_checkSightUncached(t1, t2);
+
+   P_sightCacheNewTic();
+
+   sightcacheentry_t &entry = P_sightCacheSlot(t1, t2);
+
+   ++sightstats.lookups;
+
+   if(entry.epoch == sightepoch &&
+      entry.x1 == t1->x && entry.y1 == t1->y && 
+      entry.z1 == t1->z && entry.height1 == t1->height &&
+      entry.x2 == t2->x && entry.y2 == t2->y && 
+      entry.z2 == t2->z && entry.height2 == t2->height &&
+      entry.groupid1 == t1->groupid && entry.groupid2 == t2->groupid)
+   {
+      ++sightstats.hits;
+
+      // keep validcount advancing exactly as the traversal would have
+      validcount += entry.validcount;
+      return entry.result;
+   }
+
+   int  oldvalidcount = validcount;
+   bool result        = P_checkSightUncached(t1, t2);
+
+   P_sightCacheStore(entry, t1, t2, result, validcount - oldvalidcount);
+
+   return result;
+}
+
+//
+// P_PrimeSightCache
+//
+// Store a result computed elsewhere, such as by CAM_CheckSightScratch on
+// a worker thread. Only valid when P_CheckSight itself would use
+// CAM_CheckSight, which leaves validcount alone.
+//
+void P_PrimeSightCache(Mobj *t1, Mobj *t2, bool result)
+{
+   if(!sight_cache)
+      return;
+
+   P_sightCacheNewTic();
+   P_sightCacheStore(P_sightCacheSlot(t1, t2), t1, t2, result, 0);
+   ++sightstats.primed;
+}
+
+//
+// P_SightCacheUsesCam
+//
+// Returns true if sight checks for the current game go through
+// CAM_CheckSight, so that P_PrimeSightCache may be used.
+//
+bool P_SightCacheUsesCam()
+{
+   return sight_cache && full_demo_version >= make_full_version(340, 24);
+}
+
 //----------------------------------------------------------------------------
 //
 // $Log: p_sight.c,v $
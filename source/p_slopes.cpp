@@ -346,7 +346,7 @@ void P_CopySectorSlope(line_t *line, int staticFn)
    }
 
    // Check for copy linedefs
-   for(i = -1; (i = P_FindSectorFromLineTag(line, i)) >= 0;)
+   P_FOR_SECTORS_WITH_TAG(line->tag, i)
    {
       sector_t *srcsec = &sectors[i];
 
@@ -0,0 +1,305 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    Spatial hash of Mobjs for radius and nearest-neighbour queries.
+//
+//    Every Mobj that is linked into the blockmap is also linked into a hash
+//    of 64-unit cells, which is four times finer than the blockmap. Radius
+//    queries such as explosions and monster target searches then only look
+//    at things that are actually nearby. The hash is maintained by 
+//    P_SetThingPosition and P_UnsetThingPosition.
+//
+//    Query results come out in a different order than a blockmap walk, which
+//    can change the outcome of random number calls. Callers must therefore
+//    keep using the blockmap whenever P_SpatialHashActive returns false,
+//    which it does for demos and netgames.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+
+#include "doomstat.h"
+#include "info.h"
+#include "m_fixed.h"
+#include "p_map.h"
+#include "p_maputl.h"
+#include "p_mobj.h"
+#include "p_setup.h"
+#include "p_spatial.h"
+
+// 64-unit cells
+#define SPATIALCELLSHIFT (FRACBITS + 6)
+
+bool spatial_hash = true; // console toggle: p_spatialhash
+
+static Mobj **spatialbuckets;  // bucket heads; level arena
+static int    spatialbits;     // log2 of the number of buckets
+static fixed_t spatialmaxradius; // largest radius of any thing type
+
+//
+// P_spatialKey
+//
+// Packs a cell's coordinates into its 32-bit key.
+//
+inline static unsigned int P_spatialKey(int cx, int cy)
+{
+   return ((unsigned int)cy << 16) | ((unsigned int)cx & 0xffff);
+}
+
+//
+// P_spatialBucket
+//
+// Multiplicative hash of a cell key.
+//
+inline static unsigned int P_spatialBucket(unsigned int key)
+{
+   return (key * 2654435761u) >> (32 - spatialbits);
+}
+
+//
+// P_spatialCell
+//
+// Returns the cell coordinate for a map coordinate relative to the blockmap
+// origin. 64-bit math keeps query boxes from overflowing.
+//
+inline static int P_spatialCell(int64_t coord, fixed_t origin)
+{
+   return int((coord - origin) >> SPATIALCELLSHIFT);
+}
+
+//
+// P_InitSpatialHash
+//
+// Allocates an empty hash for the level. Called from P_LoadBlockMap once the
+// blockmap dimensions are known. A 64-unit cell is a quarter of a blockmap
+// block, so the table is sized at about one bucket per cell, or four per
+// block.
+//
+void P_InitSpatialHash()
+{
+   unsigned int numcells = (unsigned int)(bmapwidth * bmapheight) * 4;
+
+   // EDF and DeHackEd are both done with the thing types by now
+   spatialmaxradius = MAXRADIUS;
+   for(int i = 0; i < NUMMOBJTYPES; i++)
+   {
+      if(mobjinfo[i]->radius > spatialmaxradius)
+         spatialmaxradius = mobjinfo[i]->radius;
+   }
+
+   spatialbits = 8;
+   while(spatialbits < 20 && (1u << spatialbits) < numcells)
+      ++spatialbits;
+
+   spatialbuckets = ecalloclevel(Mobj **, 1u << spatialbits, sizeof(Mobj *));
+}
+
+//
+// P_SpatialLink
+//
+// Links a thing into the hash at its current position.
+//
+void P_SpatialLink(Mobj *mo)
+{
+   if(!spatialbuckets)
+   {
+      mo->hnext = NULL;
+      mo->hprev = NULL;
+      return;
+   }
+
+   unsigned int key = P_spatialKey(P_spatialCell(mo->x, bmaporgx),
+                                   P_spatialCell(mo->y, bmaporgy));
+   Mobj **link = &spatialbuckets[P_spatialBucket(key)];
+   Mobj  *hnext = *link;
+
+   mo->hashkey = key;
+   if((mo->hnext = hnext))
+      hnext->hprev = &mo->hnext;
+   mo->hprev = link;
+   *link = mo;
+}
+
+//
+// P_SpatialUnlink
+//
+// Removes a thing from the hash, if it is in it.
+//
+void P_SpatialUnlink(Mobj *mo)
+{
+   Mobj *hnext, **hprev = mo->hprev;
+
+   if(hprev && (*hprev = hnext = mo->hnext))
+      hnext->hprev = hprev;
+
+   mo->hnext = NULL;
+   mo->hprev = NULL;
+}
+
+//
+// P_SpatialHashActive
+//
+// Returns true if queries may be answered from the hash. Demos and netgames
+// depend on the exact order of blockmap iteration, so they never use it.
+//
+bool P_SpatialHashActive()
+{
+   return spatial_hash && spatialbuckets && 
+          !demorecording && !demoplayback && !netgame;
+}
+
+//
+// P_spatialAccept
+//
+// Tests whether a thing lies within the query box and passes the filter.
+//
+inline static bool P_spatialAccept(Mobj *mo, fixed_t x, fixed_t y, 
+                                   fixed_t halfwidth, spatialfilter_t filter)
+{
+   int64_t dx = (int64_t)mo->x - x;
+   int64_t dy = (int64_t)mo->y - y;
+
+   return dx >= -halfwidth && dx <= halfwidth &&
+          dy >= -halfwidth && dy <= halfwidth &&
+          (!filter || filter(mo));
+}
+
+//
+// P_SpatialBoxQuery
+//
+// Collects every hashed thing whose origin lies within halfwidth of (x, y)
+// on both axes and which passes the optional filter. Callers should extend
+// halfwidth by P_SpatialMaxRadius if they care about things that merely
+// overlap the box.
+//
+void P_SpatialBoxQuery(fixed_t x, fixed_t y, fixed_t halfwidth,
+                       spatialfilter_t filter, PODCollection<Mobj *> &results)
+{
+   results.makeEmpty();
+
+   if(!spatialbuckets)
+      return;
+
+   int cx1 = P_spatialCell((int64_t)x - halfwidth, bmaporgx);
+   int cx2 = P_spatialCell((int64_t)x + halfwidth, bmaporgx);
+   int cy1 = P_spatialCell((int64_t)y - halfwidth, bmaporgy);
+   int cy2 = P_spatialCell((int64_t)y + halfwidth, bmaporgy);
+   int64_t numcells = (int64_t)(cx2 - cx1 + 1) * (cy2 - cy1 + 1);
+   unsigned int numbuckets = 1u << spatialbits;
+
+   // A huge box is cheaper to answer by walking every bucket once.
+   if(numcells > (int64_t)numbuckets)
+   {
+      for(unsigned int i = 0; i < numbuckets; i++)
+      {
+         for(Mobj *mo = spatialbuckets[i]; mo; mo = mo->hnext)
+         {
+            if(P_spatialAccept(mo, x, y, halfwidth, filter))
+               results.add(mo);
+         }
+      }
+      return;
+   }
+
+   for(int cy = cy1; cy <= cy2; cy++)
+   {
+      for(int cx = cx1; cx <= cx2; cx++)
+      {
+         unsigned int key = P_spatialKey(cx, cy);
+
+         // other cells may share this bucket; only take this cell's things
+         for(Mobj *mo = spatialbuckets[P_spatialBucket(key)]; mo; mo = mo->hnext)
+         {
+            if(mo->hashkey == key && P_spatialAccept(mo, x, y, halfwidth, filter))
+               results.add(mo);
+         }
+      }
+   }
+}
+
+//
+// P_SpatialMaxRadius
+//
+// Returns the largest radius any thing in the level can have, which is how
+// far a thing can reach beyond its origin.
+//
+fixed_t P_SpatialMaxRadius()
+{
+   return spatialmaxradius;
+}
+
+struct spatialhit_t
+{
+   Mobj   *mo;
+   fixed_t dist;
+   size_t  order; // tiebreaker, keeps the sort stable
+};
+
+static int P_compareHits(const void *a, const void *b)
+{
+   const spatialhit_t *ha = static_cast<const spatialhit_t *>(a);
+   const spatialhit_t *hb = static_cast<const spatialhit_t *>(b);
+
+   if(ha->dist != hb->dist)
+      return ha->dist < hb->dist ? -1 : 1;
+
+   return ha->order < hb->order ? -1 : ha->order > hb->order;
+}
+
+//
+// P_SpatialNearest
+//
+// As P_SpatialBoxQuery, but the results are sorted nearest first by
+// P_AproxDistance and, if k is non-zero, cut down to the k nearest.
+//
+void P_SpatialNearest(fixed_t x, fixed_t y, fixed_t halfwidth, size_t k,
+                      spatialfilter_t filter, PODCollection<Mobj *> &results)
+{
+   static PODCollection<spatialhit_t> hits;
+
+   P_SpatialBoxQuery(x, y, halfwidth, filter, results);
+
+   size_t numhits = results.getLength();
+   if(numhits < 2)
+      return;
+
+   hits.makeEmpty();
+   for(size_t i = 0; i < numhits; i++)
+   {
+      spatialhit_t &hit = hits.addNew();
+
+      hit.mo    = results[i];
+      hit.dist  = P_AproxDistance(hit.mo->x - x, hit.mo->y - y);
+      hit.order = i;
+   }
+
+   qsort(&hits[0], numhits, sizeof(spatialhit_t), P_compareHits);
+
+   if(k && numhits > k)
+      numhits = k;
+
+   results.makeEmpty();
+   for(size_t i = 0; i < numhits; i++)
+      results.add(hits[i].mo);
+}
+
+// EOF
+
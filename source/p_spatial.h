@@ -0,0 +1,54 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    Spatial hash of Mobjs for radius and nearest-neighbour queries.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef P_SPATIAL_H__
+#define P_SPATIAL_H__
+
+#include "m_collection.h"
+#include "m_fixed.h"
+
+class Mobj;
+
+// Filter callback for queries; return true to accept a candidate.
+typedef bool (*spatialfilter_t)(Mobj *);
+
+void P_InitSpatialHash();
+void P_SpatialLink(Mobj *mo);
+void P_SpatialUnlink(Mobj *mo);
+
+bool P_SpatialHashActive();
+fixed_t P_SpatialMaxRadius();
+
+void P_SpatialBoxQuery(fixed_t x, fixed_t y, fixed_t halfwidth,
+                       spatialfilter_t filter, PODCollection<Mobj *> &results);
+void P_SpatialNearest(fixed_t x, fixed_t y, fixed_t halfwidth, size_t k,
+                      spatialfilter_t filter, PODCollection<Mobj *> &results);
+
+extern bool spatial_hash;
+
+#endif
+
+// EOF
+
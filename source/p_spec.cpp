@@ -93,6 +93,8 @@ typedef struct anim_s
   int         basepic;
   int         numpics;
   int         speed;
+  int         nexttic;   // gametic of next frame change
+  int         wheelnext; // next anim in same timer wheel slot, or -1
 } anim_t;
 
 //
@@ -118,6 +120,26 @@ struct animdef_t
 static anim_t *lastanim, *anims;      // new structure w/o limits -- killough
 static size_t maxanims;
 
+//
+// Animation timer wheel
+//
+// An animation only changes frame on tics that are a multiple of its speed,
+// so rather than recompute every frame of every animation each tic, each
+// one is hashed by the tic of its next change into a slot of a wheel, and
+// only the slot for the current tic is visited. texturetranslation is a
+// pure function of leveltime, so the whole table is swept again whenever
+// leveltime does not advance by exactly one (level start, savegame load),
+// when r_swirl changes, or when the translation table is reallocated.
+//
+#define ANIMWHEELSIZE 64 // must be a power of two
+
+static int   animwheel[ANIMWHEELSIZE];
+static bool  animresync = true; // wheel must be rebuilt by a full sweep
+static int   animlasttic;
+static int   animlastswirl;
+static int  *animlasttranslation;
+static bool  animoverlap; // two animations share a pic; order matters
+
 // killough 3/7/98: Initialize generalized scrolling
 static void P_SpawnFriction();    // phares 3/16/98
 
@@ -240,6 +262,27 @@ void P_InitPicAnims(void)
    }
 
    Z_ChangeTag(animdefs, PU_CACHE); //jff 3/23/98 allow table to be freed
+
+   // If any pic is animated by more than one animation, the last one in
+   // the table must win every tic, which only a full sweep guarantees.
+   byte *animated = ecalloc(byte *, texturecount + 1, sizeof(byte));
+
+   animoverlap = false;
+   for(anim_t *anim = anims; anim < lastanim && !animoverlap; anim++)
+   {
+      for(p = anim->basepic; p < anim->basepic + anim->numpics; p++)
+      {
+         if(animated[p])
+         {
+            animoverlap = true;
+            break;
+         }
+         animated[p] = 1;
+      }
+   }
+
+   efree(animated);
+   animresync = true;
 }
 
 //=============================================================================
@@ -773,6 +816,262 @@ sector_t *P_FindModelCeilingSector(fixed_t ceildestheight, int secnum)
    return NULL;
 }
 
+//
+// Tag Index
+//
+// Sector and linedef tags are indexed in CSR form instead of killough's
+// modulo-hashed firsttag/nexttag chains. The numbers of all sectors or
+// lines sharing a tag are stored contiguously in the order the chained
+// search used to return them, and each run is terminated by -1, so a run
+// can be walked directly without ever comparing tags:
+//
+//    P_FOR_SECTORS_WITH_TAG(tag, secnum)
+//
+// Sectors appear in ascending order. Lines appear most-recently-identified
+// first (P_SetLineID used to prepend to the chain), then in ascending order.
+//
+
+struct tagindex_t
+{
+   int *keys;     // distinct tags, ascending
+   int *offsets;  // offset of each tag's run within list
+   int *list;     // runs of object numbers, each terminated by -1
+   int *position; // offset of each object within list, or -1 if not indexed
+   int  numkeys;
+};
+
+struct tagentry_t
+{
+   int tag;
+   int stamp;
+   int num;
+};
+
+static tagindex_t sectortags;
+static tagindex_t linetags;
+
+static int  *linetagstamps; // P_SetLineID order; 0 == initial, -1 == unindexed
+static int   linetagstamp;
+static bool  linetagsdirty;
+
+static int   tagrunempty = -1;
+
+//
+// P_compareTagEntries
+//
+// qsort callback; orders by tag, then newest P_SetLineID stamp, then number.
+//
+static int P_compareTagEntries(const void *a, const void *b)
+{
+   const tagentry_t *ea = static_cast<const tagentry_t *>(a);
+   const tagentry_t *eb = static_cast<const tagentry_t *>(b);
+
+   if(ea->tag != eb->tag)
+      return ea->tag < eb->tag ? -1 : 1;
+   if(ea->stamp != eb->stamp)
+      return ea->stamp > eb->stamp ? -1 : 1;
+   return ea->num - eb->num;
+}
+
+//
+// P_allocTagIndex
+//
+// Allocate storage for an index over numobjs sectors or lines. Every object
+// can have its own tag, so the run list needs room for a terminator apiece.
+//
+static void P_allocTagIndex(tagindex_t &index, int numobjs)
+{
+   index.keys     = ecalloctag(int *, numobjs + 1,     sizeof(int), PU_LEVEL, NULL);
+   index.offsets  = ecalloctag(int *, numobjs + 1,     sizeof(int), PU_LEVEL, NULL);
+   index.list     = ecalloctag(int *, 2 * numobjs + 1, sizeof(int), PU_LEVEL, NULL);
+   index.position = ecalloctag(int *, numobjs + 1,     sizeof(int), PU_LEVEL, NULL);
+   index.numkeys  = 0;
+}
+
+//
+// P_buildTagIndex
+//
+// Sort the entries into runs and rebuild the index in place, so that any
+// pointer into a previous run stays safe to read.
+//
+static void P_buildTagIndex(tagindex_t &index, tagentry_t *entries, 
+                            int numentries, int numobjs)
+{
+   int i, pos = 0;
+
+   qsort(entries, numentries, sizeof(tagentry_t), P_compareTagEntries);
+
+   for(i = 0; i < numobjs; i++)
+      index.position[i] = -1;
+   for(i = 0; i < 2 * numobjs + 1; i++)
+      index.list[i] = -1;
+
+   index.numkeys = 0;
+
+   for(i = 0; i < numentries; i++)
+   {
+      if(!i || entries[i].tag != entries[i - 1].tag)
+      {
+         if(i)
+            ++pos; // leave the previous run's terminator in place
+         index.keys[index.numkeys]    = entries[i].tag;
+         index.offsets[index.numkeys] = pos;
+         ++index.numkeys;
+      }
+      index.position[entries[i].num] = pos;
+      index.list[pos++] = entries[i].num;
+   }
+}
+
+//
+// P_rebuildLineTags
+//
+// Index every line that is part of the search, honoring P_SetLineID order.
+//
+static void P_rebuildLineTags()
+{
+   tagentry_t *entries = ecalloc(tagentry_t *, numlines + 1, sizeof(tagentry_t));
+   int numentries = 0;
+
+   for(int i = 0; i < numlines; i++)
+   {
+      if(linetagstamps[i] < 0)
+         continue;
+      entries[numentries].tag   = lines[i].tag;
+      entries[numentries].stamp = linetagstamps[i];
+      entries[numentries].num   = i;
+      ++numentries;
+   }
+
+   P_buildTagIndex(linetags, entries, numentries, numlines);
+   efree(entries);
+
+   linetagsdirty = false;
+}
+
+//
+// P_checkLineTags
+//
+// P_SetLineID defers rebuilding the line index until the next search, so that
+// Line_SetIdentification across a whole map only costs a single sort.
+//
+inline static void P_checkLineTags()
+{
+   if(linetagsdirty)
+      P_rebuildLineTags();
+}
+
+//
+// P_tagRun
+//
+// Binary search for the run of objects with a given tag.
+//
+static int *P_tagRun(const tagindex_t &index, int tag)
+{
+   int lo = 0, hi = index.numkeys - 1;
+
+   while(lo <= hi)
+   {
+      int mid = (lo + hi) / 2;
+
+      if(index.keys[mid] < tag)
+         lo = mid + 1;
+      else if(index.keys[mid] > tag)
+         hi = mid - 1;
+      else
+         return &index.list[index.offsets[mid]];
+   }
+
+   return &tagrunempty;
+}
+
+//
+// P_nextInTagRun
+//
+// Return the object that followed start in the old chained search for tag.
+// When start carries a different tag, the old search kept walking whatever
+// hash chain start was on, so only objects sharing that chain and ordered
+// after start could be found. EV_BuildStairs relies on this under
+// comp_stairs, so it is reproduced exactly.
+//
+static int P_nextInTagRun(const tagindex_t &index, const int *stamps, 
+                          int numobjs, int tag, int start, int starttag)
+{
+   int pos = index.position[start];
+   int startstamp;
+   const int *run;
+
+   if(pos < 0)
+      return -1;
+   
+   if(starttag == tag)
+      return index.list[pos + 1];
+
+   if((unsigned int)starttag % (unsigned int)numobjs != 
+      (unsigned int)tag % (unsigned int)numobjs)
+      return -1;
+
+   startstamp = stamps ? stamps[start] : 0;
+
+   for(run = P_tagRun(index, tag); *run >= 0; run++)
+   {
+      int stamp = stamps ? stamps[*run] : 0;
+
+      if(stamp < startstamp || (stamp == startstamp && *run > start))
+         return *run;
+   }
+
+   return -1;
+}
+
+//
+// P_SectorsWithTag
+//
+// Returns the -1-terminated run of sector numbers carrying a tag.
+//
+const int *P_SectorsWithTag(int tag)
+{
+   return P_tagRun(sectortags, tag);
+}
+
+//
+// P_LinesWithTag
+//
+// Returns the -1-terminated run of line numbers carrying a tag.
+//
+const int *P_LinesWithTag(int tag)
+{
+   P_checkLineTags();
+   return P_tagRun(linetags, tag);
+}
+
+//
+// P_NextSectorWithTag
+//
+// Returns the sector following secnum in the run for its tag, or -1.
+//
+int P_NextSectorWithTag(int secnum)
+{
+   return sectortags.list[sectortags.position[secnum] + 1];
+}
+
+//
+// P_NextLineWithTag
+//
+// Returns the line following linenum in the run for its tag, or -1.
+//
+int P_NextLineWithTag(int linenum)
+{
+   int pos;
+
+   P_checkLineTags();
+
+   if((pos = linetags.position[linenum]) < 0)
+      return -1;
+
+   return linetags.list[pos + 1];
+}
+
 //
 // RETURN NEXT SECTOR # THAT LINE TAG REFERS TO
 //
@@ -782,81 +1081,75 @@ sector_t *P_FindModelCeilingSector(fixed_t ceildestheight, int secnum)
 
 int P_FindSectorFromLineTag(const line_t *line, int start)
 {
-   start = 
-      (start >= 0 ? sectors[start].nexttag :
-       sectors[(unsigned int)line->tag % (unsigned int)numsectors].firsttag);
-  
-   while(start >= 0 && sectors[start].tag != line->tag)
-      start = sectors[start].nexttag;
-   
-   return start;
+   return P_FindSectorFromTag(line->tag, start);
 }
 
 // killough 4/16/98: Same thing, only for linedefs
 
 int P_FindLineFromLineTag(const line_t *line, int start)
 {
-   start = 
-      (start >= 0 ? lines[start].nexttag :
-       lines[(unsigned int)line->tag % (unsigned int)numlines].firsttag);
-  
-   while(start >= 0 && lines[start].tag != line->tag)
-      start = lines[start].nexttag;
-   
-   return start;
+   P_checkLineTags();
+
+   if(start < 0)
+      return *P_tagRun(linetags, line->tag);
+
+   return P_nextInTagRun(linetags, linetagstamps, numlines, line->tag, 
+                         start, lines[start].tag);
 }
 
 // sf: same thing but from just a number
 
 int P_FindSectorFromTag(const int tag, int start)
 {
-   start = 
-      (start >= 0 ? sectors[start].nexttag :
-       sectors[(unsigned int)tag % (unsigned int)numsectors].firsttag);
-  
-   while(start >= 0 && sectors[start].tag != tag)
-      start = sectors[start].nexttag;
-  
-   return start;
+   if(start < 0)
+      return *P_tagRun(sectortags, tag);
+
+   return P_nextInTagRun(sectortags, NULL, numsectors, tag, 
+                         start, sectors[start].tag);
 }
 
 //
 // P_InitTagLists
 //
-// Hash the sector tags across the sectors and linedefs.
+// Build the tag indices for the sectors and linedefs.
 //
 static void P_InitTagLists()
 {
-   register int i;
-   
-   for(i = numsectors; --i >= 0; )   // Initially make all slots empty.
-      sectors[i].firsttag = -1;
-   
-   for(i = numsectors; --i >= 0; )   // Proceed from last to first sector
-   {                                 // so that lower sectors appear first
-      int j = (unsigned int)sectors[i].tag % (unsigned int)numsectors; // Hash func
-      sectors[i].nexttag = sectors[j].firsttag;   // Prepend sector to chain
-      sectors[j].firsttag = i;
+   tagentry_t *entries;
+   int i;
+
+   P_allocTagIndex(sectortags, numsectors);
+   P_allocTagIndex(linetags,   numlines);
+   linetagstamps = ecalloctag(int *, numlines + 1, sizeof(int), PU_LEVEL, NULL);
+   linetagstamp  = 0;
+
+   entries = ecalloc(tagentry_t *, numsectors + 1, sizeof(tagentry_t));
+
+   for(i = 0; i < numsectors; i++)
+   {
+      entries[i].tag   = sectors[i].tag;
+      entries[i].stamp = 0;
+      entries[i].num   = i;
    }
    
-   // killough 4/17/98: same thing, only for linedefs
+   P_buildTagIndex(sectortags, entries, numsectors, numsectors);
+   efree(entries);
    
-   for(i = numlines; --i >= 0; )   // Initially make all slots empty.
-      lines[i].firsttag = -1;
+   // killough 4/17/98: same thing, only for linedefs
    
-   for(i = numlines; --i >= 0; )   // Proceed from last to first linedef
-   {                               // so that lower linedefs appear first
+   for(i = 0; i < numlines; i++)
+   {
       // haleyjd 05/16/09: unified id into tag;
       // added mapformat parameter to test here:
       if(LevelInfo.mapFormat == LEVEL_FORMAT_DOOM || 
          LevelInfo.mapFormat == LEVEL_FORMAT_PSX  ||
          lines[i].tag != -1)
-      {
-         int j = (unsigned int)lines[i].tag % (unsigned int)numlines; // Hash func
-         lines[i].nexttag = lines[j].firsttag;   // Prepend linedef to chain
-         lines[j].firsttag = i;
-      }
+         linetagstamps[i] = 0;
+      else
+         linetagstamps[i] = -1;
    }
+
+   P_rebuildLineTags();
 }
 
 //
@@ -1100,6 +1393,126 @@ void P_PlayerOnSpecialFlat(player_t *player)
    }
 }
 
+//
+// P_animatePics
+//
+// Set the translation of every pic in an animation for the current tic.
+//
+static void P_animatePics(const anim_t *anim)
+{
+   for(int i = anim->basepic; i < anim->basepic + anim->numpics; ++i)
+   {
+      if((i >= flatstart && i < flatstop && r_swirl) || anim->speed > 65535 || anim->numpics == 1)
+         texturetranslation[i] = i;
+      else
+      {
+         int pic = anim->basepic + 
+                   ((leveltime/anim->speed + i) % anim->numpics);
+
+         texturetranslation[i] = pic;
+      }
+   }
+}
+
+//
+// P_animIsStatic
+//
+// Returns true if an animation's pics never change frame: swirling flats,
+// swirly water hacks, and single-frame animations.
+//
+static bool P_animIsStatic(const anim_t *anim)
+{
+   return 
+      (anim->basepic >= flatstart && anim->basepic + anim->numpics <= flatstop
+       && r_swirl) || anim->speed > 65535 || anim->numpics == 1;
+}
+
+//
+// P_scheduleAnim
+//
+// Link an animation into the wheel slot for the tic of its next frame change.
+//
+static void P_scheduleAnim(anim_t *anim)
+{
+   int slot;
+
+   anim->nexttic   = (leveltime / anim->speed + 1) * anim->speed;
+   slot            = anim->nexttic & (ANIMWHEELSIZE - 1);
+   anim->wheelnext = animwheel[slot];
+   animwheel[slot] = int(anim - anims);
+}
+
+//
+// P_sweepAnims
+//
+// Animate every pic of every animation, and reschedule them all.
+//
+static void P_sweepAnims()
+{
+   for(int slot = 0; slot < ANIMWHEELSIZE; slot++)
+      animwheel[slot] = -1;
+   animresync = false;
+
+   for(anim_t *anim = anims; anim < lastanim; ++anim)
+   {
+      P_animatePics(anim);
+      if(!P_animIsStatic(anim))
+         P_scheduleAnim(anim);
+   }
+}
+
+//
+// P_AnimateTextures
+//
+// Update texturetranslation for the current tic, visiting only the
+// animations which change frame on it.
+//
+void P_AnimateTextures()
+{
+   bool continuous = 
+      (!animresync && leveltime == animlasttic + 1 && 
+       r_swirl == animlastswirl && texturetranslation == animlasttranslation);
+
+   animlasttic         = leveltime;
+   animlastswirl       = r_swirl;
+   animlasttranslation = texturetranslation;
+
+   if(!continuous || animoverlap)
+   {
+      P_sweepAnims();
+      return;
+   }
+
+   int slot = leveltime & (ANIMWHEELSIZE - 1);
+   int due  = -1;
+   int *link = &animwheel[slot];
+
+   // unlink every animation due this tic, keeping the rest in place
+   while(*link >= 0)
+   {
+      anim_t *anim = &anims[*link];
+
+      if(anim->nexttic == leveltime)
+      {
+         int next = anim->wheelnext;
+         anim->wheelnext = due;
+         due   = *link;
+         *link = next;
+      }
+      else
+         link = &anim->wheelnext;
+   }
+
+   while(due >= 0)
+   {
+      anim_t *anim = &anims[due];
+
+      due = anim->wheelnext;
+      P_animatePics(anim);
+      P_scheduleAnim(anim);
+   }
+}
+
 //
 // P_UpdateSpecials
 //
@@ -1119,10 +1532,6 @@ int             levelFragLimit; // Ty 03/18/98 Added -frags support
 
 void P_UpdateSpecials(void)
 {
-   anim_t *anim;
-   int    pic;
-   int    i;
-
    // Downcount level timer, exit level if elapsed
    if(levelTimeLimit && leveltime >= levelTimeLimit*35*60 )
       G_ExitLevel();
@@ -1146,21 +1555,7 @@ void P_UpdateSpecials(void)
    }
 
    // Animate flats and textures globally
-   for(anim = anims; anim < lastanim; ++anim)
-   {
-      for(i = anim->basepic; i < anim->basepic + anim->numpics; ++i)
-      {
-         if((i >= flatstart && i < flatstop && r_swirl) || anim->speed > 65535 || anim->numpics == 1)
-            texturetranslation[i] = i;
-         else
-         {
-            pic = anim->basepic + 
-                  ((leveltime/anim->speed + i) % anim->numpics);
-
-            texturetranslation[i] = pic;
-         }
-      }
-   }
+   P_AnimateTextures();
    
    // update buttons (haleyjd 10/16/05: button stuff -> p_switch.c)
    P_RunButtons();
@@ -1186,7 +1581,7 @@ static void P_SetupHeightTransfer(int linenum, int secnum)
    int s;
    sector_t *heightsec = &sectors[secnum];
 
-   for(s = -1; (s = P_FindSectorFromLineTag(lines + linenum, s)) >= 0; )
+   P_FOR_SECTORS_WITH_TAG(lines[linenum].tag, s)
    {
       sectors[s].heightsec = secnum;
 
@@ -1375,7 +1770,7 @@ void P_SpawnSpecials()
          // floor lighting independently (e.g. lava)
       case EV_STATIC_LIGHT_TRANSFER_FLOOR:
          sec = sides[*lines[i].sidenum].sector-sectors;
-         for(s = -1; (s = P_FindSectorFromLineTag(lines+i,s)) >= 0;)
+         P_FOR_SECTORS_WITH_TAG(lines[i].tag, s)
             sectors[s].floorlightsec = sec;
          break;
 
@@ -1383,7 +1778,7 @@ void P_SpawnSpecials()
          // ceiling lighting independently
       case EV_STATIC_LIGHT_TRANSFER_CEILING:
          sec = sides[*lines[i].sidenum].sector-sectors;
-         for(s = -1; (s = P_FindSectorFromLineTag(lines+i,s)) >= 0;)
+         P_FOR_SECTORS_WITH_TAG(lines[i].tag, s)
             sectors[s].ceilinglightsec = sec;
          break;
 
@@ -1398,7 +1793,7 @@ void P_SpawnSpecials()
 
       case EV_STATIC_SKY_TRANSFER:         // Regular sky
       case EV_STATIC_SKY_TRANSFER_FLIPPED: // Same, only flipped
-         for(s = -1; (s = P_FindSectorFromLineTag(lines+i,s)) >= 0;)
+         P_FOR_SECTORS_WITH_TAG(lines[i].tag, s)
             sectors[s].sky = i | PL_SKYFLAT;
          break;
 
@@ -1705,7 +2100,7 @@ static void P_SpawnFriction()
                movefactor = 32;
          }
 
-         for(s = -1; (s = P_FindSectorFromLineTag(line, s)) >= 0 ;)
+         P_FOR_SECTORS_WITH_TAG(line->tag, s)
          {
             // killough 8/28/98:
             //
@@ -1747,17 +2142,20 @@ static void P_SpawnFriction()
 // A much nicer line finding function.
 // haleyjd 02/27/07: rewritten to get rid of Raven code and to speed up in the
 // same manner as P_FindLineFromLineTag by using in-table tag hash.
+// Now walks the line tag index.
 //
 line_t *P_FindLine(int tag, int *searchPosition)
 {
    line_t *line = NULL;
-   
-   int start = 
-      (*searchPosition >= 0 ? lines[*searchPosition].nexttag :
-       lines[(unsigned int)tag % (unsigned int)numlines].firsttag);
-  
-   while(start >= 0 && lines[start].tag != tag)
-      start = lines[start].nexttag;
+   int start;
+
+   P_checkLineTags();
+
+   start = 
+      (*searchPosition >= 0 ? 
+       P_nextInTagRun(linetags, linetagstamps, numlines, tag, 
+                      *searchPosition, lines[*searchPosition].tag) :
+       *P_LinesWithTag(tag));
 
    if(start >= 0)
       line = &lines[start];
@@ -1771,45 +2169,14 @@ line_t *P_FindLine(int tag, int *searchPosition)
 // P_SetLineID
 //
 // haleyjd 05/16/09: For Hexen
+// The line moves to the front of its new tag's run, as it did when it was
+// prepended to a hash chain. The index is rebuilt on the next search.
 //
 void P_SetLineID(line_t *line, int id)
 {
-   // remove from any chain it's already in
-   if(line->tag >= 0)
-   {
-      int chain = (unsigned int)line->tag % (unsigned int)numlines;
-      int i;
-      line_t *prevline = NULL;
-
-      // walk the chain
-      for(i = lines[chain].firsttag; i != -1; i = lines[i].nexttag)
-      {
-         if(line == &lines[i])
-         {
-            // remove this line
-            if(prevline)
-               prevline->nexttag = line->nexttag; // prev->next = this->next
-            else
-               lines[chain].firsttag = line->nexttag; // list = this->next
-         }
-
-         // not a match, keep looking
-         // record this line in case it's the one before the one we're looking for
-         prevline = &lines[i]; 
-      }
-   }
-
-   // set the new id
    line->tag = id;
-   line->nexttag = -1;
-
-   if(line->tag >= 0)
-   {
-      int chain = (unsigned int)line->tag % (unsigned int)numlines; // Hash func
-   
-      line->nexttag = lines[chain].firsttag;   // Prepend linedef to chain
-      lines[chain].firsttag = line - lines;
-   }
+   linetagstamps[line - lines] = (id >= 0 ? ++linetagstamp : -1);
+   linetagsdirty = true;
 }
 
 //=============================================================================
@@ -2048,7 +2415,7 @@ void P_AttachLines(line_t *cline, bool ceiling)
 
    // Search the lines list. Check for every tagged line that
    // has the 3dmidtex lineflag, then add the line to the attached list.
-   for(start = -1; (start = P_FindLineFromLineTag(cline,start)) >= 0; )
+   P_FOR_LINES_WITH_TAG(cline->tag, start)
    {
       if(start != cline-lines)
       {
@@ -2284,7 +2651,7 @@ void P_AttachSectors(line_t *line, int staticFn)
 
    // Search the lines list. Check for every tagged line that
    // has the appropriate special, then add the line's frontsector to the attached list.
-   for(start = -1; (start = P_FindLineFromLineTag(line,start)) >= 0; )
+   P_FOR_LINES_WITH_TAG(line->tag, start)
    {
       attachedtype_e type;
 
@@ -2726,7 +3093,7 @@ static void P_SpawnPortal(line_t *line, int staticFn)
       anchortype = EV_SpecialForStaticInit(anchorfunc);
 
       // find anchor line
-      for(s = -1; (s = P_FindLineFromLineTag(line, s)) >= 0; )
+      P_FOR_LINES_WITH_TAG(line->tag, s)
       {
          // SoM 3-10-04: Two different anchor linedef codes so I can tag 
          // two anchored portals to the same sector.
@@ -2755,7 +3122,7 @@ static void P_SpawnPortal(line_t *line, int staticFn)
       anchortype = EV_SpecialForStaticInit(anchorfunc);
 
       // find anchor line
-      for(s = -1; (s = P_FindLineFromLineTag(line, s)) >= 0; )
+      P_FOR_LINES_WITH_TAG(line->tag, s)
       {
          // SoM 3-10-04: Two different anchor linedef codes so I can tag 
          // two anchored portals to the same sector.
@@ -2798,7 +3165,7 @@ static void P_SpawnPortal(line_t *line, int staticFn)
       anchortype = EV_SpecialForStaticInit(anchorfunc);
 
       // find anchor line
-      for(s = -1; (s = P_FindLineFromLineTag(line, s)) >= 0; )
+      P_FOR_LINES_WITH_TAG(line->tag, s)
       {
          // SoM 3-10-04: Two different anchor linedef codes so I can tag 
          // two anchored portals to the same sector.
@@ -2845,13 +3212,13 @@ static void P_SpawnPortal(line_t *line, int staticFn)
 
    // attach portal to tagged sector floors/ceilings
    // SoM: TODO: Why am I not checking groupids?
-   for(s = -1; (s = P_FindSectorFromLineTag(line, s)) >= 0; )
+   P_FOR_SECTORS_WITH_TAG(line->tag, s)
    {
       P_SetPortal(sectors + s, NULL, portal, effects);
    }
 
    // attach portal to like-tagged 289 lines
-   for(s = -1; (s = P_FindLineFromLineTag(line, s)) >= 0; )
+   P_FOR_LINES_WITH_TAG(line->tag, s)
    {
       if(line == &lines[s] || !lines[s].frontsector)
          continue;
@@ -2886,7 +3253,7 @@ static cell AMX_NATIVE_CALL sm_sectorspecial(AMX *amx, cell *params)
       return -1;
    }
 
-   while((secnum = P_FindSectorFromTag(id, secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(id, secnum)
    {
       sectors[secnum].special = special;
    }
@@ -2921,7 +3288,7 @@ static cell AMX_NATIVE_CALL sm_sectorcolormap(AMX *amx, cell *params)
    if((lumpnum = R_ColormapNumForName(name)) < 0)
       lumpnum = 0;
 
-   while((secnum = P_FindSectorFromTag(id, secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(id, secnum)
    {
       sector_t *s = &sectors[secnum];
 
@@ -1218,6 +1218,21 @@ int P_FindLineFromLineTag(const line_t *line, int start);   // killough 4/17/98
 
 int P_FindSectorFromTag(const int tag, int start);        // sf
 
+const int *P_SectorsWithTag(int tag);
+const int *P_LinesWithTag(int tag);
+int P_NextSectorWithTag(int secnum);
+int P_NextLineWithTag(int linenum);
+
+// Loop over the number of every sector or line carrying a tag. No state is
+// kept besides num, so manual activations can jump into the loop body.
+#define P_FOR_SECTORS_WITH_TAG(tag, num) \
+   for((num) = *P_SectorsWithTag(tag); (num) >= 0; \
+       (num) = P_NextSectorWithTag(num))
+
+#define P_FOR_LINES_WITH_TAG(tag, num) \
+   for((num) = *P_LinesWithTag(tag); (num) >= 0; \
+       (num) = P_NextLineWithTag(num))
+
 int P_FindMinSurroundingLight(sector_t *sector, int max);
 
 sector_t *getNextSector(line_t *line, sector_t *sec);
@@ -1373,6 +1388,8 @@ void P_SpawnDeferredSpecials();
 // every tic
 void P_UpdateSpecials(void);
 
+void P_AnimateTextures();
+
 // when needed
 bool P_UseSpecialLine(Mobj *thing, line_t *line, int side);
 
@@ -1388,6 +1405,7 @@ void P_PlayerOnSpecialFlat(player_t *player);
 // haleyjd 10/16/05: moved all button code into p_switch.c
 void P_ClearButtons();
 void P_RunButtons();
+void P_CountActiveButtons();
 
 // p_lights
 
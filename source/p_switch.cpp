@@ -126,6 +126,10 @@ void P_InitSwitchList(void)
    Z_ChangeTag(alphSwitchList, PU_CACHE); //jff 3/23/98 allow table to be freed
 }
 
+// Number of buttons whose timers are running; per-tic upkeep in
+// P_RunButtons is skipped entirely while this is zero.
+static int numactivebuttons;
+
 //
 // P_FindFreeButton
 //
@@ -191,6 +195,9 @@ static void P_StartButton(int sidenum, line_t *line, sector_t *sector,
    button->btimer   = time;
    button->dopopout = dopopout;
 
+   if(time)
+      ++numactivebuttons;
+
    // 04/19/09: rewritten to use linedef sound origin
 
    // switch activation sound
@@ -209,6 +216,25 @@ void P_ClearButtons()
 {
    if(numbuttonsalloc)
       memset(buttonlist, 0, numbuttonsalloc * sizeof(button_t));
+
+   numactivebuttons = 0;
+}
+
+//
+// P_CountActiveButtons
+//
+// Recount running button timers after the button list has been replaced
+// wholesale, as when loading a savegame.
+//
+void P_CountActiveButtons()
+{
+   numactivebuttons = 0;
+
+   for(int i = 0; i < numbuttonsalloc; ++i)
+   {
+      if(buttonlist[i].btimer)
+         ++numactivebuttons;
+   }
 }
 
 //
@@ -217,18 +243,21 @@ void P_ClearButtons()
 // Check buttons and change texture on timeout.
 // haleyjd 10/16/05: moved here and turned into its own function.
 // haleyjd 04/16/08: rewritten to use indices instead of pointers
+// Stop as soon as every running timer has been seen.
 //
 void P_RunButtons()
 {
    int i;
+   int remaining = numactivebuttons;
    button_t *button;
 
-   for(i = 0; i < numbuttonsalloc; ++i)
+   for(i = 0; i < numbuttonsalloc && remaining; ++i)
    {
       button = &buttonlist[i];
 
       if(button->btimer)
       {
+         --remaining;
          button->btimer--;
          if(!button->btimer)
          {
@@ -260,6 +289,7 @@ void P_RunButtons()
             
             // clear out the button
             memset(button, 0, sizeof(button_t));
+            --numactivebuttons;
          }
       }
    }
@@ -60,7 +60,7 @@ int EV_Teleport(line_t *line, int side, Mobj *thing)
    // killough 1/31/98: improve performance by using
    // P_FindSectorFromLineTag instead of simple linear search.
 
-   for(i = -1; (i = P_FindSectorFromLineTag(line, i)) >= 0;)
+   P_FOR_SECTORS_WITH_TAG(line->tag, i)
    {
       for(thinker = thinkercap.next; thinker != &thinkercap; thinker = thinker->next)
       {
@@ -158,7 +158,7 @@ int EV_SilentTeleport(line_t *line, int side, Mobj *thing)
    if(side || thing->flags & MF_MISSILE)
       return 0;
 
-   for(i = -1; (i = P_FindSectorFromLineTag(line, i)) >= 0;)
+   P_FOR_SECTORS_WITH_TAG(line->tag, i)
    {
       for(th = thinkercap.next; th != &thinkercap; th = th->next)
       {
@@ -254,7 +254,7 @@ int EV_SilentLineTeleport(line_t *line, int side, Mobj *thing,
    if(side || thing->flags & MF_MISSILE)
       return 0;
 
-   for (i = -1; (i = P_FindLineFromLineTag(line, i)) >= 0;)
+   P_FOR_LINES_WITH_TAG(line->tag, i)
    {
       if ((l=lines+i) != line && l->backsector)
       {
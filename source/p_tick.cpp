@@ -27,13 +27,21 @@
 
 #include "c_io.h"
 #include "c_runcmd.h"
+#include "acs_intr.h"
 #include "d_dehtbl.h"
 #include "d_main.h"
 #include "doomstat.h"
+#include "hal/i_timer.h"
 #include "i_system.h"
+#include "m_profile.h"
 #include "p_anim.h"
 #include "p_chase.h"
+#include "p_enemy.h"
+#include "p_mobj.h"
+#include "p_pushers.h"
+#include "p_pvs.h"
 #include "p_saveg.h"
+#include "p_scroll.h"
 #include "p_sector.h"
 #include "p_spec.h"
 #include "p_tick.h"
@@ -61,6 +69,25 @@ Thinker thinkercap;
 
 Thinker thinkerclasscap[NUMTHCLASS];
 
+// Thinkers are also kept in contiguous per-class run queues. When the exact
+// thinker list order isn't needed for sync, RunThinkers runs each class
+// together, which keeps the same virtual Think method and the same pooled
+// allocations hot in cache instead of jumping between classes on every step.
+// Deleted thinkers leave NULL holes which are compacted away before the queues
+// are run.
+
+bool thinker_queues = true; // console toggle: p_thinkerqueues
+
+// Thinkers may go dormant for a number of tics during which their Think
+// would have had no effect beyond counting down. Skipped thinkers keep
+// their place in the list and wake on exactly the tic they would next have
+// done something, so this is safe for demos and netgames.
+
+bool thinker_dormancy = true; // console toggle: p_dormantthinkers
+
+static PODCollection<Thinker *> runqueues[NUMTHQUEUES];
+static size_t                   runqueueholes[NUMTHQUEUES];
+
 // 
 // Thinker::StaticType
 //
@@ -79,6 +106,138 @@ void Thinker::InitThinkers(void)
       thinkerclasscap[i].cprev = thinkerclasscap[i].cnext = &thinkerclasscap[i];
    
    thinkercap.prev = thinkercap.next  = &thinkercap;
+
+   // clear run queues
+   for(i = 0; i < NUMTHQUEUES; i++)
+   {
+      runqueues[i].makeEmpty();
+      runqueueholes[i] = 0;
+   }
+}
+
+//
+// P_thinkerQueueFor
+//
+// Decides which run queue a thinker belongs in.
+//
+static int P_thinkerQueueFor(const Thinker *th)
+{
+   if(th->isDescendantOf(RTTI(Mobj)))
+      return tq_mobjs;
+
+   if(th->isDescendantOf(RTTI(SectorThinker)))
+   {
+      if(th->isDescendantOf(RTTI(FireFlickerThinker)) ||
+         th->isDescendantOf(RTTI(LightFlashThinker))  ||
+         th->isDescendantOf(RTTI(StrobeThinker))      ||
+         th->isDescendantOf(RTTI(GlowThinker))        ||
+         th->isDescendantOf(RTTI(LightFadeThinker)))
+         return tq_lights;
+      return tq_movers;
+   }
+
+   if(th->isDescendantOf(RTTI(ScrollThinker)) || 
+      th->isDescendantOf(RTTI(PushThinker)))
+      return tq_scroll;
+
+   if(th->isDescendantOf(RTTI(ACSThinker)))
+      return tq_acs;
+
+   return tq_misc;
+}
+
+//
+// Thinker::addToRunQueue
+//
+// Appends the thinker to the end of its class's run queue.
+//
+void Thinker::addToRunQueue()
+{
+   removeFromRunQueue();
+
+   runqueue = P_thinkerQueueFor(this);
+   runslot  = (unsigned int)runqueues[runqueue].getLength();
+   runqueues[runqueue].add(this);
+}
+
+//
+// Thinker::removeFromRunQueue
+//
+// Leaves a hole where the thinker was in its run queue. The queue may
+// have been emptied by InitThinkers since the thinker was added, so the
+// slot is only cleared if it still refers to this thinker.
+//
+void Thinker::removeFromRunQueue()
+{
+   if(runqueue < 0)
+      return;
+
+   PODCollection<Thinker *> &queue = runqueues[runqueue];
+
+   if(runslot < queue.getLength() && queue[runslot] == this)
+   {
+      queue[runslot] = NULL;
+      ++runqueueholes[runqueue];
+   }
+
+   runqueue = -1;
+}
+
+//
+// Thinker::CompactRunQueues
+//
+// Squeezes the holes out of any run queue that has become at least half
+// empty, preserving the order of the remaining thinkers.
+//
+void Thinker::CompactRunQueues()
+{
+   for(int q = 0; q < NUMTHQUEUES; q++)
+   {
+      PODCollection<Thinker *> &queue = runqueues[q];
+      size_t len = queue.getLength();
+
+      if(runqueueholes[q] * 2 < len)
+         continue;
+
+      size_t out = 0;
+      for(size_t in = 0; in < len; in++)
+      {
+         Thinker *th = queue[in];
+         if(th)
+         {
+            th->runslot  = (unsigned int)out;
+            queue[out++] = th;
+         }
+      }
+
+      queue.resize(out);
+      runqueueholes[q] = 0;
+   }
+}
+
+//
+// Thinker::sleepFor
+//
+// Skip the next tics - 1 calls to Think, so that it runs again tics tics
+// from now. Returns false if the thinker stays awake.
+//
+bool Thinker::sleepFor(int tics)
+{
+   if(!thinker_dormancy || tics <= 1)
+      return false;
+
+   waketic = leveltime + tics;
+   return true;
+}
+
+//
+// Thinker::dormantTics
+//
+// Number of upcoming tics on which Think will be skipped.
+//
+int Thinker::dormantTics() const
+{
+   return waketic > leveltime ? waketic - leveltime : 0;
 }
 
 //
@@ -138,6 +297,9 @@ void Thinker::addThinker()
    // killough 8/29/98: set sentinel pointers, and then add to appropriate list
    cnext = cprev = this;
    updateThinker();
+
+   // add to class run queue
+   addToRunQueue();
 }
 
 //
@@ -227,15 +389,99 @@ void Thinker::removeThinker()
 //
 void Thinker::RunThinkers(void)
 {
+   ProfileScope profile(PROF_THINKERS);
+   bool timed = prof_thinkers;
+
+   CompactRunQueues();
+
+   // demos and netgames depend on the exact list order
+   if(thinker_queues && !demorecording && !demoplayback && !netgame)
+   {
+      RunQueues(timed);
+      return;
+   }
+
    for(currentthinker = thinkercap.next; 
        currentthinker != &thinkercap;
        currentthinker = currentthinker->next)
    {
       if(currentthinker->removed)
          currentthinker->removeDelayed();
-      else
-         currentthinker->Think();
+      else if(currentthinker->waketic <= leveltime)
+         currentthinker->runThink(timed);
+   }
+}
+
+//
+// Thinker::RunQueues
+//
+// Runs the thinkers one class at a time. A thinker added during the tic is
+// appended to its class's queue, which may already have been run, as when a
+// mobj starts a sector mover; the queues are passed over again until no new
+// thinkers remain, so that every one of them still runs on the same tic, as
+// it would at the end of the thinker list. Deferred removal works exactly as
+// it does in RunThinkers.
+//
+void Thinker::RunQueues(bool timed)
+{
+   size_t done[NUMTHQUEUES] = { 0 };
+   bool   grew;
+
+   do
+   {
+      grew = false;
+
+      for(int q = 0; q < NUMTHQUEUES; q++)
+      {
+         PODCollection<Thinker *> &queue = runqueues[q];
+         size_t i;
+
+         // length is re-read on each step to pick up new thinkers
+         for(i = done[q]; i < queue.getLength(); i++)
+         {
+            Thinker *th = queue[i];
+
+            if(!th)
+               continue;
+
+            currentthinker = th;
+            if(th->removed)
+               th->removeDelayed();
+            else if(th->waketic <= leveltime)
+               th->runThink(timed);
+         }
+
+         done[q] = i;
+      }
+
+      for(int q = 0; q < NUMTHQUEUES; q++)
+      {
+         if(done[q] < runqueues[q].getLength())
+            grew = true;
+      }
    }
+   while(grew);
+
+   currentthinker = &thinkercap;
+}
+
+//
+// Thinker::runThink
+//
+// Calls Think, timing it by class during playsim benchmarks.
+//
+void Thinker::runThink(bool timed)
+{
+   if(timed)
+   {
+      const Type *type  = getDynamicType();
+      uint64_t    start = i_haltimer.GetNanoseconds();
+
+      Think();
+      M_ProfileThinker(type, i_haltimer.GetNanoseconds() - start);
+   }
+   else
+      Think();
 }
 
 //
@@ -260,6 +506,8 @@ void Thinker::serialize(SaveArchive &arc)
 //
 void P_Ticker()
 {
+   ProfileScope profile(PROF_PLAYSIM);
+
    // pause if in menu and at least one tic has been run
    //
    // killough 9/29/98: note that this ties in with basetic,
@@ -274,6 +522,9 @@ void P_Ticker()
 
    // interpolation: save current sector heights
    P_SaveSectorPositions();
+
+   // pick up a finished background PVS build
+   P_UpdatePVS();
    
    P_ParticleThinker(); // haleyjd: think for particles
 
@@ -290,6 +541,9 @@ void P_Ticker()
       }
    }
 
+   // evaluate upcoming monster sight checks in parallel
+   P_RunAIQueries();
+
    Thinker::RunThinkers();
    P_UpdateSpecials();
    P_RespawnSpecials();
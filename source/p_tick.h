@@ -43,11 +43,25 @@ private:
    // killough 11/98: count of how many other objects reference
    // this one using pointers. Used for garbage collection.
    unsigned int references;
+
+   // position in the per-class run queues
+   int          runqueue; // queue index, or -1 if not queued
+   unsigned int runslot;  // index within that queue
+
+   // dormancy; Think is not called before this leveltime
+   int          waketic;
    
    // Statics
    // Current position in list during RunThinkers
    static Thinker *currentthinker;
 
+   // Run queue maintenance
+   void addToRunQueue();
+   void removeFromRunQueue();
+   void runThink(bool timed);
+   static void CompactRunQueues();
+   static void RunQueues(bool timed);
+
 protected:
    // Virtual methods (overridables)
    virtual void Think() {}
@@ -55,6 +69,12 @@ protected:
    // Methods
    void addToThreadedList(int tclass);
 
+   // Dormancy. A thinker whose next tics are known to be pure countdowns
+   // can skip them; it must be able to reconstruct its state as of any
+   // skipped tic (see dormantTics) for savegames.
+   bool sleepFor(int tics);
+   int  dormantTics() const;
+
    // Data Members
    bool removed;
 
@@ -64,11 +84,14 @@ protected:
 public:
    // Constructor
    Thinker() 
-      : Super(), references(0), removed(false), ordinal(0), prev(NULL),
-        next(NULL), cprev(NULL), cnext(NULL)
+      : Super(), references(0), runqueue(-1), runslot(0), waketic(0), 
+        removed(false),
+        ordinal(0), prev(NULL), next(NULL), cprev(NULL), cnext(NULL)
    {
    }
 
+   virtual ~Thinker() { removeFromRunQueue(); }
+
    // operator new, overriding ZoneObject::operator new (size_t)
    void *operator new (size_t size) { return ZoneObject::operator new(size, PU_LEVEL); }
 
@@ -188,6 +211,22 @@ typedef enum
 
 extern Thinker thinkerclasscap[];
 
+// Per-class run queues, in the order they are run when the thinker list
+// order is not required for demo or netgame sync.
+enum
+{
+   tq_mobjs,   // Mobj
+   tq_movers,  // sector movers: doors, floors, ceilings, plats...
+   tq_lights,  // sector lighting effects
+   tq_scroll,  // scrollers and pushers
+   tq_acs,     // ACS threads
+   tq_misc,    // everything else
+   NUMTHQUEUES
+};
+
+extern bool thinker_queues;
+extern bool thinker_dormancy;
+
 //
 // DECLARE_THINKER_TYPE
 //
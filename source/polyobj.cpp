@@ -828,6 +828,9 @@ static bool Polyobj_moveXY(polyobj_t *po, fixed_t x, fixed_t y)
    for(i = 0; i < po->numVertices; ++i)
       Polyobj_vecAdd(po->vertices[i], &vec);
 
+   // polyobject lines block sight
+   P_InvalidateSightCache();
+
    // translate each line
    for(i = 0; i < po->numLines; ++i)
       Polyobj_bboxAdd(po->lines[i]->bbox, &vec);
@@ -957,6 +960,9 @@ static bool Polyobj_rotate(polyobj_t *po, angle_t delta)
 
    angle = (po->angle + delta) >> ANGLETOFINESHIFT;
 
+   // polyobject lines block sight
+   P_InvalidateSightCache();
+
    // point about which to rotate is the spawn spot
    origin.x = po->spawnSpot.x;
    origin.y = po->spawnSpot.y;
@@ -1133,6 +1139,19 @@ void Polyobj_InitLevel(void)
       // setup polyobject clipping
       for(i = 0; i < numPolyObjects; ++i)
          Polyobj_linkToBlockmap(&PolyObjects[i]);
+
+      // polyobject lines move, so the compact blockmap must not reject
+      // them using their spawn-time bounding boxes
+      byte *linemask = ecalloc(byte *, numlines, sizeof(byte));
+
+      for(i = 0; i < numPolyObjects; ++i)
+      {
+         for(int j = 0; j < PolyObjects[i].numLines; ++j)
+            linemask[PolyObjects[i].lines[j] - lines] = 1;
+      }
+
+      P_UnboxBlockLines(linemask);
+      efree(linemask);
    }
 
    // done with mobj queues
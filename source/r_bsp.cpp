@@ -31,6 +31,7 @@
 #include "m_bbox.h"
 #include "p_chase.h"
 #include "p_portal.h"
+#include "p_pvs.h"
 #include "p_slopes.h"
 #include "r_data.h"
 #include "r_draw.h"
@@ -55,6 +56,8 @@ drawseg_t *drawsegs = NULL;
 unsigned int maxdrawsegs;
 // drawseg_t drawsegs[MAXDRAWSEGS];       // old code -- killough
 
+const byte *r_pvsrow;
+
 
 //
 // R_ClearDrawSegs
@@ -2059,6 +2062,16 @@ static void R_Subsector(int num)
    seg.frontsec = R_FakeFlat(seg.frontsec, &tempsec, &floorlightlevel,
                              &ceilinglightlevel, false);   // killough 4/11/98
 
+   // no line from the view sector can reach a subsector outside its PVS,
+   // so its planes and walls can neither show nor occlude anything. Its
+   // things are still added, since a large sprite can hang over into a
+   // visible sector.
+   if(r_pvsrow && !P_PVSVisible(r_pvsrow, sub->sector - sectors))
+   {
+      R_AddSprites(sub->sector, (floorlightlevel+ceilinglightlevel)/2);
+      return;
+   }
+
    // haleyjd 01/05/08: determine angles for floor and ceiling
    floorangle   = seg.frontsec->floorbaseangle   + seg.frontsec->floorangle;
    ceilingangle = seg.frontsec->ceilingbaseangle + seg.frontsec->ceilingangle;
@@ -26,6 +26,8 @@
 #ifndef R_BSP_H__
 #define R_BSP_H__
 
+#include "doomtype.h"
+
 struct drawseg_t;
 struct line_t;
 struct seg_t;
@@ -57,6 +59,10 @@ void R_ClearClipSegs();
 void R_ClearDrawSegs();
 
 void R_RenderBSPNode(int bspnum);
+
+// PVS row of the view sector, or NULL to draw everything
+extern const byte *r_pvsrow;
+
 int R_DoorClosed();   // killough 1/17/98
 
 // killough 4/13/98: fake floors/ceilings for deep water / fake ceilings:
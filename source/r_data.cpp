@@ -32,6 +32,7 @@
 #include "d_main.h"
 #include "doomstat.h"
 #include "e_hash.h"
+#include "m_collection.h"
 #include "m_compare.h"
 #include "m_misc.h"
 #include "m_swap.h"
@@ -511,12 +512,8 @@ void R_PrecacheLevel(void)
    register int i;
    register byte *hitlist;
    int numalloc;
-
-   if(demoplayback)
-      return;
-   
-   if(!r_precache)
-      return;
+   bool precache = (r_precache && !demoplayback);
+   PODCollection<int> prefetch;
 
    // SoM: Hey, you never know, it could happen....
    numalloc = (texturecount > numsprites ? texturecount : numsprites);
@@ -547,8 +544,25 @@ void R_PrecacheLevel(void)
    hitlist[skytexture] = 1;
    hitlist[sky2texture] = 1; // haleyjd
 
-   // Precache textures.
+   // prefetch the lumps the level's textures are built from, even if not
+   // precaching, so zip-based resources are inflated now.
    for(i = texturecount; --i >= 0; )
+   {
+      if(hitlist[i])
+      {
+         texture_t *tex = textures[i];
+
+         for(int c = 0; c < tex->ccount; c++)
+            prefetch.add(tex->components[c].lump);
+      }
+   }
+
+   wGlobalDir.prefetchLumps(prefetch.isEmpty() ? NULL : &prefetch[0], 
+                            static_cast<int>(prefetch.getLength()));
+   prefetch.clear();
+
+   // Precache textures.
+   for(i = texturecount; precache && --i >= 0; )
    {
       if(hitlist[i])
          R_CacheTexture(i);
@@ -579,11 +593,19 @@ void R_PrecacheLevel(void)
             int16_t *sflump = sprites[i].spriteframes[j].lump;
             int k = 7;
             do
-               wGlobalDir.cacheLumpNum(firstspritelump + sflump[k], PU_CACHE);
+               prefetch.add(firstspritelump + sflump[k]);
             while(--k >= 0);
          }
       }
    }
+
+   wGlobalDir.prefetchLumps(prefetch.isEmpty() ? NULL : &prefetch[0], 
+                            static_cast<int>(prefetch.getLength()));
+
+   // Cache the sprite lumps.
+   for(size_t s = 0; precache && s < prefetch.getLength(); s++)
+      wGlobalDir.cacheLumpNum(prefetch[s], PU_CACHE);
+
    efree(hitlist);
 }
 
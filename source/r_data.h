@@ -174,7 +174,8 @@ void R_InitColormaps(void);   // killough 8/9/98
 // haleyjd: new global colormap method
 void R_SetGlobalLevelColormap(void);
 
-extern byte *main_tranmap, *main_submap, *tranmap;
+extern byte *main_tranmap, *main_submap;
+extern EE_THREADLOCAL byte *tranmap;
 
 extern int r_precache;
 
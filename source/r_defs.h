@@ -203,7 +203,6 @@ struct sector_t
    int16_t lightlevel;
    int16_t special;
    int16_t tag;
-   int nexttag, firsttag;   // killough 1/30/98: improves searches for tags.
    int soundtraversed;      // 0 = untraversed, 1,2 = sndlines-1
    Mobj *soundtarget;       // thing that made a sound (or null)
    fixed_t blockbox[4];     // mapblock bounding box for height changes
@@ -382,7 +381,6 @@ struct line_t
    sector_t *backsector; 
    int validcount;         // if == validcount, already checked
    int tranlump;           // killough 4/11/98: translucency filter, -1 == none
-   int firsttag, nexttag;  // killough 4/17/98: improves searches for tags.
    PointThinker soundorg;  // haleyjd 04/19/09: line sound origin
    int intflags;           // haleyjd 01/22/11: internal flags
 
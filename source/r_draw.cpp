@@ -81,7 +81,7 @@ VALLOCATION(columnofs)
 //  (color ramps used for  suit colors).
 //
  
-byte *tranmap;          // translucency filter maps 256x256   // phares 
+EE_THREADLOCAL byte *tranmap; // translucency filter maps 256x256   // phares 
 byte *main_tranmap;     // killough 4/11/98
 byte *main_submap;      // haleyjd 11/30/13
 
@@ -103,7 +103,7 @@ const int fuzzoffset[FUZZTABLE] =
   1,1,0,1,1,0,1 
 }; 
 
-int fuzzpos = 0; 
+EE_THREADLOCAL int fuzzpos = 0; 
 
 //
 // A column is a vertical slice/span from a wall texture that,
@@ -145,7 +145,7 @@ void R_FillBackScreen(const rrect_t &window);
 // If the view size is not full screen, draws a border around it.
 void R_DrawViewBorder();
 
-extern byte  *tranmap;       // translucency filter maps 256x256  // phares 
+extern EE_THREADLOCAL byte *tranmap; // translucency filter maps 256x256  // phares 
 extern byte  *main_tranmap;  // killough 4/11/98
 extern byte  *main_submap;   // haleyjd 11/30/13
 extern byte **ylookup;       // killough 11/98
@@ -154,7 +154,7 @@ extern byte **ylookup;       // killough 11/98
 #define FUZZOFF (SCREENWIDTH)
 
 extern const int fuzzoffset[];
-extern int fuzzpos;
+extern EE_THREADLOCAL int fuzzpos;
 
 // Cardboard
 typedef struct cb_column_s
@@ -175,7 +175,7 @@ typedef struct cb_column_s
 } cb_column_t;
 
 
-extern cb_column_t column;
+extern EE_THREADLOCAL cb_column_t column;
 
 #endif
 
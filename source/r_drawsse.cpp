@@ -0,0 +1,340 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    SSE2 column and span drawing engines.
+//
+//    Every texel of the 8-bit renderer goes through one or two dependent
+//    table lookups, which SSE2 cannot do without gathers. These drawers
+//    therefore vectorize what is left around the lookups: texture 
+//    coordinate stepping and index math, translucency blending, and for
+//    spans, writing 16 pixels with one store. Lookups stay scalar.
+//
+//    Drawers with nothing left to vectorize are shared with the normal
+//    engine. Without SSE2 the vector paths are compiled out and the scalar
+//    loops handle everything.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+
+#include "r_draw.h"
+#include "r_drawsse.h"
+#include "r_main.h"
+#include "r_plane.h"
+#include "v_video.h"
+
+extern int *columnofs;
+
+// Normal engine drawers (r_draw.cpp, r_span.cpp)
+extern void CB_DrawColumn_8(void);
+extern void CB_DrawTLColumn_8(void);
+extern void CB_DrawTRColumn_8(void);
+extern void CB_DrawTLTRColumn_8(void);
+extern void CB_DrawFuzzColumn_8(void);
+extern void CB_DrawFlexColumn_8(void);
+extern void CB_DrawFlexTRColumn_8(void);
+extern void CB_DrawAddColumn_8(void);
+extern void CB_DrawAddTRColumn_8(void);
+
+extern void R_DrawSlope_8_64(void);
+extern void R_DrawSlope_8_128(void);
+extern void R_DrawSlope_8_256(void);
+extern void R_DrawSlope_8_512(void);
+extern void R_DrawSlope_8_GEN(void);
+
+//=============================================================================
+//
+// Span Drawers
+//
+// One drawer per style serves all flat sizes, taking its shifts and mask
+// from the span rather than from constants.
+//
+
+enum
+{
+   SSE_SPAN_NORMAL,
+   SSE_SPAN_TL,
+   SSE_SPAN_ADD
+};
+
+#define SSE_SPANBLOCK 16
+
+template<int style> static void R_DrawSpan_SSE2(void)
+{
+   unsigned int xf = span.xfrac, xs = span.xstep;
+   unsigned int yf = span.yfrac, ys = span.ystep;
+   unsigned int xshift = span.xshift, yshift = span.yshift, xmask = span.xmask;
+   byte *source = (byte *)span.source;
+   lighttable_t *colormap = span.colormap;
+   unsigned int *fg2rgb = span.fg2rgb, *bg2rgb = span.bg2rgb;
+   int count = span.x2 - span.x1 + 1;
+   byte *dest = ylookup[span.y] + columnofs[span.x1];
+
+#ifdef R_HAVE_SSE2
+   if(count >= SSE_SPANBLOCK)
+   {
+      __m128i vxf = _mm_setr_epi32(int(xf), int(xf + xs), 
+                                   int(xf + 2*xs), int(xf + 3*xs));
+      __m128i vyf = _mm_setr_epi32(int(yf), int(yf + ys), 
+                                   int(yf + 2*ys), int(yf + 3*ys));
+      __m128i vxs = _mm_set1_epi32(int(xs * 4));
+      __m128i vys = _mm_set1_epi32(int(ys * 4));
+      __m128i vxshift = _mm_cvtsi32_si128(int(xshift));
+      __m128i vyshift = _mm_cvtsi32_si128(int(yshift));
+      __m128i vxmask  = _mm_set1_epi32(int(xmask));
+      __m128i idxv[SSE_SPANBLOCK / 4];
+      __m128i pixv;
+      const unsigned int *idx = reinterpret_cast<const unsigned int *>(idxv);
+      byte *pix = reinterpret_cast<byte *>(&pixv);
+
+      do
+      {
+         int i;
+
+         // texel indices for the whole block
+         for(i = 0; i < SSE_SPANBLOCK / 4; i++)
+         {
+            idxv[i] = _mm_or_si128(
+               _mm_and_si128(_mm_srl_epi32(vxf, vxshift), vxmask),
+               _mm_srl_epi32(vyf, vyshift));
+            vxf = _mm_add_epi32(vxf, vxs);
+            vyf = _mm_add_epi32(vyf, vys);
+         }
+
+         if(style == SSE_SPAN_NORMAL)
+         {
+            for(i = 0; i < SSE_SPANBLOCK; i++)
+               pix[i] = colormap[source[idx[i]]];
+         }
+         else
+         {
+            __m128i fgv[SSE_SPANBLOCK / 4], bgv[SSE_SPANBLOCK / 4];
+            unsigned int *fg = reinterpret_cast<unsigned int *>(fgv);
+            unsigned int *bg = reinterpret_cast<unsigned int *>(bgv);
+
+            for(i = 0; i < SSE_SPANBLOCK; i++)
+            {
+               fg[i] = fg2rgb[colormap[source[idx[i]]]];
+               bg[i] = bg2rgb[dest[i]];
+            }
+            for(i = 0; i < SSE_SPANBLOCK / 4; i++)
+            {
+               __m128i t = _mm_add_epi32(fgv[i], bgv[i]);
+               idxv[i] = (style == SSE_SPAN_TL) ? R_SSEFlexBlend(t) 
+                                                : R_SSEAddBlend(t);
+            }
+            for(i = 0; i < SSE_SPANBLOCK; i++)
+               pix[i] = RGB32k[0][0][idx[i]];
+         }
+
+         _mm_storeu_si128(reinterpret_cast<__m128i *>(dest), pixv);
+
+         dest  += SSE_SPANBLOCK;
+         count -= SSE_SPANBLOCK;
+      }
+      while(count >= SSE_SPANBLOCK);
+
+      xf = unsigned(_mm_cvtsi128_si32(vxf));
+      yf = unsigned(_mm_cvtsi128_si32(vyf));
+   }
+#endif
+
+   while(count-- > 0)
+   {
+      unsigned int texel = colormap[source[((xf >> xshift) & xmask) | (yf >> yshift)]];
+
+      if(style == SSE_SPAN_NORMAL)
+         *dest = texel;
+      else if(style == SSE_SPAN_TL)
+         *dest = RGB32k[0][0][R_FlexBlend(fg2rgb[texel] + bg2rgb[*dest])];
+      else
+         *dest = RGB32k[0][0][R_AddBlend(fg2rgb[texel] + bg2rgb[*dest])];
+
+      ++dest;
+      xf += xs;
+      yf += ys;
+   }
+}
+
+#define SSE_SPANS(style) \
+   { R_DrawSpan_SSE2<style>, R_DrawSpan_SSE2<style>, R_DrawSpan_SSE2<style>, \
+     R_DrawSpan_SSE2<style>, R_DrawSpan_SSE2<style> }
+
+#define SSE_SLOPES \
+   { R_DrawSlope_8_64, R_DrawSlope_8_128, R_DrawSlope_8_256, \
+     R_DrawSlope_8_512, R_DrawSlope_8_GEN }
+
+spandrawer_t r_sse2_spandrawer =
+{
+   {
+      SSE_SPANS(SSE_SPAN_NORMAL),
+      SSE_SPANS(SSE_SPAN_TL),
+      SSE_SPANS(SSE_SPAN_ADD),
+   },
+
+   // Sloped spans divide per pixel group and are left to the normal drawers.
+   {
+      SSE_SLOPES,
+      SSE_SLOPES,
+      SSE_SLOPES,
+   }
+};
+
+//=============================================================================
+//
+// Column Drawers
+//
+// Only the flex and additive translucent drawers have enough arithmetic 
+// per pixel to be worth vectorizing. Textures whose height is not a power
+// of two take the normal drawers.
+//
+
+#define SSE_COLBLOCK 8
+
+template<bool translated, bool additive> static void R_DrawBlendColumn_SSE2(void)
+{
+   int count, heightmask;
+   byte *dest, *source;
+   fixed_t frac, fracstep;
+   unsigned int *fg2rgb, *bg2rgb;
+   lighttable_t *colormap;
+   byte *translation;
+
+   heightmask = column.texheight - 1;
+   if(column.texheight & heightmask)
+   {
+      if(additive)
+         translated ? CB_DrawAddTRColumn_8() : CB_DrawAddColumn_8();
+      else
+         translated ? CB_DrawFlexTRColumn_8() : CB_DrawFlexColumn_8();
+      return;
+   }
+
+   count = column.y2 - column.y1 + 1;
+   if(count <= 0) 
+      return;
+
+   {
+      unsigned int fglevel = column.translevel & ~0x3ff;
+
+      if(additive)
+      {
+         fg2rgb = Col2RGB8_LessPrecision[fglevel >> 10];
+         bg2rgb = Col2RGB8_LessPrecision[FRACUNIT >> 10];
+      }
+      else
+      {
+         fg2rgb = Col2RGB8[fglevel >> 10];
+         bg2rgb = Col2RGB8[(FRACUNIT - fglevel) >> 10];
+      }
+   }
+
+   dest        = ylookup[column.y1] + columnofs[column.x];
+   fracstep    = column.step;
+   frac        = column.texmid + (int)((column.y1 - view.ycenter + 1) * fracstep);
+   source      = (byte *)(column.source);
+   colormap    = column.colormap;
+   translation = column.translation;
+
+#ifdef R_HAVE_SSE2
+   if(count >= SSE_COLBLOCK)
+   {
+      __m128i fgv[SSE_COLBLOCK / 4], bgv[SSE_COLBLOCK / 4];
+      unsigned int *fg = reinterpret_cast<unsigned int *>(fgv);
+      unsigned int *bg = reinterpret_cast<unsigned int *>(bgv);
+
+      do
+      {
+         int i;
+         byte *d = dest;
+
+         for(i = 0; i < SSE_COLBLOCK; i++)
+         {
+            byte texel = source[(frac >> FRACBITS) & heightmask];
+
+            if(translated)
+               texel = translation[texel];
+
+            fg[i] = fg2rgb[colormap[texel]];
+            bg[i] = bg2rgb[*d];
+            d    += linesize;
+            frac += fracstep;
+         }
+         for(i = 0; i < SSE_COLBLOCK / 4; i++)
+         {
+            __m128i t = _mm_add_epi32(fgv[i], bgv[i]);
+            fgv[i] = additive ? R_SSEAddBlend(t) : R_SSEFlexBlend(t);
+         }
+         for(i = 0; i < SSE_COLBLOCK; i++)
+         {
+            *dest = RGB32k[0][0][fg[i]];
+            dest += linesize;
+         }
+
+         count -= SSE_COLBLOCK;
+      }
+      while(count >= SSE_COLBLOCK);
+   }
+#endif
+
+   while(count-- > 0)
+   {
+      byte texel = source[(frac >> FRACBITS) & heightmask];
+      unsigned int t;
+
+      if(translated)
+         texel = translation[texel];
+
+      t = fg2rgb[colormap[texel]] + bg2rgb[*dest];
+      *dest = RGB32k[0][0][additive ? R_AddBlend(t) : R_FlexBlend(t)];
+
+      dest += linesize;
+      frac += fracstep;
+   }
+}
+
+columndrawer_t r_sse2_drawer =
+{
+   CB_DrawColumn_8,
+   CB_DrawTLColumn_8,
+   CB_DrawTRColumn_8,
+   CB_DrawTLTRColumn_8,
+   CB_DrawFuzzColumn_8,
+   R_DrawBlendColumn_SSE2<false, false>,
+   R_DrawBlendColumn_SSE2<true,  false>,
+   R_DrawBlendColumn_SSE2<false, true>,
+   R_DrawBlendColumn_SSE2<true,  true>,
+
+   NULL,
+
+   {
+      // Normal                               Translated
+      { CB_DrawColumn_8,                      CB_DrawTRColumn_8                   }, // NORMAL
+      { CB_DrawFuzzColumn_8,                  CB_DrawFuzzColumn_8                 }, // SHADOW
+      { R_DrawBlendColumn_SSE2<false, false>, R_DrawBlendColumn_SSE2<true, false> }, // ALPHA
+      { R_DrawBlendColumn_SSE2<false, true>,  R_DrawBlendColumn_SSE2<true, true>  }, // ADD
+      { CB_DrawTLColumn_8,                    CB_DrawTLTRColumn_8                 }, // SUB
+      { CB_DrawTLColumn_8,                    CB_DrawTLTRColumn_8                 }, // TRANMAP
+   },
+};
+
+// EOF
+
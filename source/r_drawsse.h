@@ -0,0 +1,83 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    SSE2 column and span drawing engines.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef R_DRAWSSE_H__
+#define R_DRAWSSE_H__
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define R_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+extern columndrawer_t r_sse2_drawer;
+extern spandrawer_t   r_sse2_spandrawer;
+
+//
+// Blending
+//
+// Both blends take the sum of the foreground and background RGB table 
+// entries and return an index into RGB32k.
+//
+
+inline unsigned int R_FlexBlend(unsigned int t)
+{
+   t |= 0x01f07c1f;
+   return t & (t >> 15);
+}
+
+inline unsigned int R_AddBlend(unsigned int a)
+{
+   // mask out LSBs in green and red to allow overflow
+   unsigned int b = a & 0x40100400;
+   a = (a | 0x01f07c1f) & 0x3fffffff;
+   b = b - (b >> 5);
+   a |= b;
+   return a & (a >> 15);
+}
+
+#ifdef R_HAVE_SSE2
+
+inline __m128i R_SSEFlexBlend(__m128i t)
+{
+   t = _mm_or_si128(t, _mm_set1_epi32(0x01f07c1f));
+   return _mm_and_si128(t, _mm_srli_epi32(t, 15));
+}
+
+inline __m128i R_SSEAddBlend(__m128i a)
+{
+   __m128i b = _mm_and_si128(a, _mm_set1_epi32(0x40100400));
+   a = _mm_and_si128(_mm_or_si128(a, _mm_set1_epi32(0x01f07c1f)), 
+                     _mm_set1_epi32(0x3fffffff));
+   b = _mm_sub_epi32(b, _mm_srli_epi32(b, 5));
+   a = _mm_or_si128(a, b);
+   return _mm_and_si128(a, _mm_srli_epi32(a, 15));
+}
+
+#endif
+
+#endif
+
+// EOF
+
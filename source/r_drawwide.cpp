@@ -0,0 +1,531 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    Wide column buffer engine.
+//
+//    Works like the quad column buffer, but batches up to sixteen adjacent
+//    columns. The rows every buffered column covers are flushed a whole
+//    row at a time, which for opaque columns is a single 16-byte store,
+//    while column heads and tails are flushed one column at a time.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+#include "i_system.h"
+
+#include "doomstat.h"
+#include "r_draw.h"
+#include "r_drawsse.h"
+#include "r_drawwide.h"
+#include "r_main.h"
+#include "v_alloc.h"
+#include "v_misc.h"
+#include "v_video.h"
+
+extern int *columnofs;
+
+// Number of columns in the buffer; this is also its row stride.
+#define WIDECOLS 16
+
+enum
+{
+   WCOL_NONE,
+   WCOL_OPAQUE,
+   WCOL_TRANS,
+   WCOL_FLEXTRANS,
+   WCOL_FUZZ,
+   WCOL_FLEXADD
+};
+
+//
+// A flusher copies count rows of width buffered columns to the screen.
+//
+typedef void (*wideflush_t)(const byte *source, byte *dest, int width, int count);
+
+static int          temp_x = 0;
+static int          tempyl[WIDECOLS], tempyh[WIDECOLS];
+static int          startx = 0;
+static int          temptype = WCOL_NONE;
+static int          commontop, commonbot;
+static byte        *temptranmap;
+static fixed_t      temptranslevel;
+static unsigned int *temp_fg2rgb;
+static unsigned int *temp_bg2rgb;
+static byte        *tempfuzzmap;
+static byte        *widebuf;
+static wideflush_t  R_FlushRun;
+
+VALLOCATION(widebuf)
+{
+   widebuf = ecalloctag(byte *, h*WIDECOLS, sizeof(byte), PU_VALLOC, NULL);
+}
+
+//=============================================================================
+//
+// Flushers
+//
+
+static void R_WFlushNil(const byte *source, byte *dest, int width, int count)
+{
+}
+
+static void R_WFlushOpaque(const byte *source, byte *dest, int width, int count)
+{
+#ifdef R_HAVE_SSE2
+   if(width == WIDECOLS)
+   {
+      while(--count >= 0)
+      {
+         _mm_storeu_si128((__m128i *)dest, 
+                          _mm_loadu_si128((const __m128i *)source));
+         source += WIDECOLS;
+         dest += linesize;
+      }
+      return;
+   }
+   
+   if(width >= 8)
+   {
+      // two overlapping 8-byte stores cover any width from 8 to 15
+      int tail = width - 8;
+
+      while(--count >= 0)
+      {
+         _mm_storel_epi64((__m128i *)dest, 
+                          _mm_loadl_epi64((const __m128i *)source));
+         _mm_storel_epi64((__m128i *)(dest + tail), 
+                          _mm_loadl_epi64((const __m128i *)(source + tail)));
+         source += WIDECOLS;
+         dest += linesize;
+      }
+      return;
+   }
+#endif
+
+   if(width == 1)
+   {
+      while(--count >= 0)
+      {
+         *dest = *source;
+         source += WIDECOLS;
+         dest += linesize;
+      }
+      return;
+   }
+
+   while(--count >= 0)
+   {
+      memcpy(dest, source, width);
+      source += WIDECOLS;
+      dest += linesize;
+   }
+}
+
+static void R_WFlushTL(const byte *source, byte *dest, int width, int count)
+{
+   while(--count >= 0)
+   {
+      for(int x = 0; x < width; x++)
+         dest[x] = temptranmap[(dest[x] << 8) + source[x]];
+      source += WIDECOLS;
+      dest += linesize;
+   }
+}
+
+//
+// R_WFlushFuzz
+//
+// Fuzz columns are always flushed one whole column at a time, so that
+// fuzzpos advances the same way as in the quad engine.
+//
+static void R_WFlushFuzz(const byte *source, byte *dest, int width, int count)
+{
+   while(--count >= 0)
+   {
+      *dest = tempfuzzmap[6*256+dest[fuzzoffset[fuzzpos] ? video.pitch: -video.pitch]];
+      
+      // Clamp table lookup index.
+      if(++fuzzpos == FUZZTABLE) 
+         fuzzpos = 0;
+
+      dest += linesize;
+   }
+}
+
+//
+// R_WFlushBlend
+//
+// Flex and additive translucency. The blend arithmetic is done four pixels
+// at a time; the RGB table lookups on either side of it stay scalar.
+//
+template<bool additive> 
+static void R_WFlushBlend(const byte *source, byte *dest, int width, int count)
+{
+   const unsigned int *fg2rgb = temp_fg2rgb, *bg2rgb = temp_bg2rgb;
+
+   while(--count >= 0)
+   {
+      int x = 0;
+
+#ifdef R_HAVE_SSE2
+      for(; x + 4 <= width; x += 4)
+      {
+         unsigned int idx[4];
+         __m128i t = _mm_add_epi32(
+            _mm_setr_epi32(fg2rgb[source[x  ]], fg2rgb[source[x+1]], 
+                           fg2rgb[source[x+2]], fg2rgb[source[x+3]]),
+            _mm_setr_epi32(bg2rgb[dest[x  ]], bg2rgb[dest[x+1]],
+                           bg2rgb[dest[x+2]], bg2rgb[dest[x+3]]));
+
+         t = additive ? R_SSEAddBlend(t) : R_SSEFlexBlend(t);
+         _mm_storeu_si128((__m128i *)idx, t);
+
+         dest[x  ] = RGB32k[0][0][idx[0]];
+         dest[x+1] = RGB32k[0][0][idx[1]];
+         dest[x+2] = RGB32k[0][0][idx[2]];
+         dest[x+3] = RGB32k[0][0][idx[3]];
+      }
+#endif
+
+      for(; x < width; x++)
+      {
+         unsigned int t = fg2rgb[source[x]] + bg2rgb[dest[x]];
+         dest[x] = RGB32k[0][0][additive ? R_AddBlend(t) : R_FlexBlend(t)];
+      }
+
+      source += WIDECOLS;
+      dest += linesize;
+   }
+}
+
+//
+// R_flushRun
+//
+// Flush count rows starting at row y of width columns starting at buffer
+// column x.
+//
+static void R_flushRun(int x, int y, int count, int width)
+{
+   R_FlushRun(widebuf + y * WIDECOLS + x, ylookup[y] + columnofs[startx + x], 
+              width, count);
+}
+
+//
+// R_FlushColumns
+//
+// If more than one column is buffered, the heads and tails outside the rows
+// they all share are flushed per column and the shared block is flushed
+// whole rows at a time. Otherwise each column is flushed on its own.
+//
+static void R_FlushColumns(void)
+{
+   if(temp_x > 1 && commontop <= commonbot && temptype != WCOL_FUZZ)
+   {
+      for(int x = 0; x < temp_x; x++)
+      {
+         if(tempyl[x] < commontop)
+            R_flushRun(x, tempyl[x], commontop - tempyl[x], 1);
+         if(tempyh[x] > commonbot)
+            R_flushRun(x, commonbot + 1, tempyh[x] - commonbot, 1);
+      }
+      R_flushRun(0, commontop, commonbot - commontop + 1, temp_x);
+   }
+   else
+   {
+      while(--temp_x >= 0)
+         R_flushRun(temp_x, tempyl[temp_x], tempyh[temp_x] - tempyl[temp_x] + 1, 1);
+   }
+   temp_x = 0;
+}
+
+//
+// R_WResetColumnBuffer
+//
+static void R_WResetColumnBuffer(void)
+{
+   if(temp_x)
+      R_FlushColumns();
+   temptype   = WCOL_NONE;
+   R_FlushRun = R_WFlushNil;
+}
+
+//=============================================================================
+//
+// Buffer Management
+//
+
+//
+// R_wideContinues
+//
+// True if the current column can be appended to the buffer.
+//
+static bool R_wideContinues(int type)
+{
+   return temp_x && temp_x < WIDECOLS && temptype == type && 
+          startx + temp_x == column.x;
+}
+
+//
+// R_wideStart
+//
+// Flush whatever is buffered and start a new run with the current column.
+//
+static byte *R_wideStart(int type, wideflush_t flush)
+{
+   if(temp_x)
+      R_FlushColumns();
+
+   temp_x     = 1;
+   startx     = column.x;
+   temptype   = type;
+   R_FlushRun = flush;
+   *tempyl = commontop = column.y1;
+   *tempyh = commonbot = column.y2;
+
+   return widebuf + column.y1 * WIDECOLS;
+}
+
+//
+// R_wideAppend
+//
+static byte *R_wideAppend(void)
+{
+   tempyl[temp_x] = column.y1;
+   tempyh[temp_x] = column.y2;
+
+   if(column.y1 > commontop)
+      commontop = column.y1;
+   if(column.y2 < commonbot)
+      commonbot = column.y2;
+
+   return widebuf + column.y1 * WIDECOLS + temp_x++;
+}
+
+static byte *R_GetBufferOpaque(void)
+{
+   if(R_wideContinues(WCOL_OPAQUE))
+      return R_wideAppend();
+
+   return R_wideStart(WCOL_OPAQUE, R_WFlushOpaque);
+}
+
+static byte *R_GetBufferTrans(void)
+{
+   byte *ret;
+
+   if(R_wideContinues(WCOL_TRANS) && tranmap == temptranmap)
+      return R_wideAppend();
+
+   ret = R_wideStart(WCOL_TRANS, R_WFlushTL);
+   temptranmap = tranmap;
+   return ret;
+}
+
+static byte *R_GetBufferFlexTrans(void)
+{
+   byte *ret;
+   unsigned int fglevel;
+
+   if(R_wideContinues(WCOL_FLEXTRANS) && temptranslevel == column.translevel)
+      return R_wideAppend();
+
+   ret = R_wideStart(WCOL_FLEXTRANS, R_WFlushBlend<false>);
+   temptranslevel = column.translevel;
+   fglevel        = temptranslevel & ~0x3ff;
+   temp_fg2rgb    = Col2RGB8[fglevel >> 10];
+   temp_bg2rgb    = Col2RGB8[(FRACUNIT - fglevel) >> 10];
+   return ret;
+}
+
+static byte *R_GetBufferFlexAdd(void)
+{
+   byte *ret;
+   unsigned int fglevel;
+
+   if(R_wideContinues(WCOL_FLEXADD) && temptranslevel == column.translevel)
+      return R_wideAppend();
+
+   ret = R_wideStart(WCOL_FLEXADD, R_WFlushBlend<true>);
+   temptranslevel = column.translevel;
+   fglevel        = temptranslevel & ~0x3ff;
+   temp_fg2rgb    = Col2RGB8_LessPrecision[fglevel >> 10];
+   temp_bg2rgb    = Col2RGB8_LessPrecision[FRACUNIT >> 10];
+   return ret;
+}
+
+static byte *R_GetBufferFuzz(void)
+{
+   byte *ret;
+
+   if(R_wideContinues(WCOL_FUZZ))
+      return R_wideAppend();
+
+   ret = R_wideStart(WCOL_FUZZ, R_WFlushFuzz);
+   tempfuzzmap = column.colormap;
+   return ret;
+}
+
+//=============================================================================
+//
+// Column Drawers
+//
+// These only map texels into the buffer; all screen access happens when
+// the buffer is flushed.
+//
+
+template<byte *(*getbuffer)(void), bool translated>
+static void R_WDrawColumn(void)
+{
+   int      count;
+   byte    *dest;
+   fixed_t  frac;
+   fixed_t  fracstep;
+
+   count = column.y2 - column.y1 + 1;
+
+   // Zero length, column does not exceed a pixel.
+   if(count <= 0)
+      return;
+
+#ifdef RANGECHECK 
+   if(column.x  < 0 || column.x  >= video.width || 
+      column.y1 < 0 || column.y2 >= video.height) 
+      I_Error("R_WDrawColumn: %i to %i at %i\n", column.y1, column.y2, column.x);
+#endif 
+
+   dest = getbuffer();
+
+   fracstep = column.step;
+   frac = column.texmid + (int)((column.y1 - view.ycenter + 1) * fracstep);
+
+   {
+      const byte         *source      = (const byte *)(column.source);
+      const lighttable_t *colormap    = column.colormap;
+      const byte         *translation = column.translation;
+      int heightmask = column.texheight - 1;
+
+#define SRCPIXEL(t) colormap[translated ? translation[t] : (t)]
+
+      if(column.texheight & heightmask)   // not a power of 2 -- killough
+      {
+         heightmask++;
+         heightmask <<= FRACBITS;
+
+         if(frac < 0)
+            while((frac += heightmask) < 0);
+         else
+            while(frac >= heightmask)
+               frac -= heightmask;
+
+         do
+         {
+            *dest = SRCPIXEL(source[frac >> FRACBITS]);
+            dest += WIDECOLS;
+            if((frac += fracstep) >= heightmask)
+               frac -= heightmask;
+         }
+         while(--count);
+      }
+      else
+      {
+         while((count -= 2) >= 0)   // texture height is a power of 2 -- killough
+         {
+            *dest = SRCPIXEL(source[(frac >> FRACBITS) & heightmask]);
+            dest += WIDECOLS;
+            frac += fracstep;
+            *dest = SRCPIXEL(source[(frac >> FRACBITS) & heightmask]);
+            dest += WIDECOLS;
+            frac += fracstep;
+         }
+         if(count & 1)
+            *dest = SRCPIXEL(source[(frac >> FRACBITS) & heightmask]);
+      }
+
+#undef SRCPIXEL
+   }
+}
+
+//
+// Spectre/Invisibility.
+//
+static void R_WDrawFuzzColumn(void)
+{
+   // Adjust borders. Low...
+   if(!column.y1) 
+      column.y1 = 1;
+   
+   // .. and high.
+   if(column.y2 == viewwindow.height - 1) 
+      column.y2 = viewwindow.height - 2; 
+   
+   // Zero length?
+   if((column.y2 - column.y1) < 0) 
+      return; 
+
+#ifdef RANGECHECK 
+   if(column.x  < 0 || column.x  >= video.width || 
+      column.y1 < 0 || column.y2 >= video.height)
+      I_Error("R_WDrawFuzzColumn: %i to %i at %i\n", column.y1, column.y2, column.x);
+#endif
+
+   // Fuzz only needs the column's extent, which the buffer remembers.
+   R_GetBufferFuzz();
+}
+
+#define R_WDrawOpaqueColumn  R_WDrawColumn<R_GetBufferOpaque,    false>
+#define R_WDrawTRColumn      R_WDrawColumn<R_GetBufferOpaque,    true >
+#define R_WDrawTLColumn      R_WDrawColumn<R_GetBufferTrans,     false>
+#define R_WDrawTLTRColumn    R_WDrawColumn<R_GetBufferTrans,     true >
+#define R_WDrawFlexColumn    R_WDrawColumn<R_GetBufferFlexTrans, false>
+#define R_WDrawFlexTRColumn  R_WDrawColumn<R_GetBufferFlexTrans, true >
+#define R_WDrawAddColumn     R_WDrawColumn<R_GetBufferFlexAdd,   false>
+#define R_WDrawAddTRColumn   R_WDrawColumn<R_GetBufferFlexAdd,   true >
+
+//
+// Wide Column Drawer Object
+//
+columndrawer_t r_wide_drawer =
+{
+   R_WDrawOpaqueColumn,
+   R_WDrawTLColumn,
+   R_WDrawTRColumn,
+   R_WDrawTLTRColumn,
+   R_WDrawFuzzColumn,
+   R_WDrawFlexColumn,
+   R_WDrawFlexTRColumn,
+   R_WDrawAddColumn,
+   R_WDrawAddTRColumn,
+
+   R_WResetColumnBuffer,
+
+   {
+      // Normal               Translated
+      { R_WDrawOpaqueColumn, R_WDrawTRColumn     }, // NORMAL
+      { R_WDrawFuzzColumn,   R_WDrawFuzzColumn   }, // SHADOW
+      { R_WDrawFlexColumn,   R_WDrawFlexTRColumn }, // ALPHA
+      { R_WDrawAddColumn,    R_WDrawAddTRColumn  }, // ADD
+      { R_WDrawTLColumn,     R_WDrawTLTRColumn   }, // SUB
+      { R_WDrawTLColumn,     R_WDrawTLTRColumn   }, // TRANMAP
+   },
+};
+
+// EOF
+
@@ -40,17 +40,22 @@
 #include "hu_over.h"
 #include "i_video.h"
 #include "m_bbox.h"
+#include "m_profile.h"
 #include "m_random.h"
 #include "mn_engin.h"
 #include "p_chase.h"
 #include "p_partcl.h"
+#include "p_pvs.h"
 #include "p_xenemy.h"
 #include "r_bsp.h"
 #include "r_draw.h"
 #include "r_drawq.h"
+#include "r_drawsse.h"
+#include "r_drawwide.h"
 #include "r_dynseg.h"
 #include "r_interpolate.h"
 #include "r_main.h"
+#include "r_parallel.h"
 #include "r_plane.h"
 #include "r_portal.h"
 #include "r_ripple.h"
@@ -152,6 +157,8 @@ static columndrawer_t *r_column_engines[NUMCOLUMNENGINES] =
 {
    &r_normal_drawer, // normal engine
    &r_quad_drawer,   // quad cache engine
+   &r_sse2_drawer,   // SSE2 engine
+   &r_wide_drawer,   // wide cache engine
 };
 
 //
@@ -161,7 +168,11 @@ static columndrawer_t *r_column_engines[NUMCOLUMNENGINES] =
 //
 void R_SetColumnEngine()
 {
-   r_column_engine = r_column_engines[r_column_engine_num];
+   // threaded drawing records columns to be drawn at the end of the frame
+   if(R_DeferredDrawing())
+      r_column_engine = R_DeferredColumnEngine(r_column_engines[r_column_engine_num]);
+   else
+      r_column_engine = r_column_engines[r_column_engine_num];
 }
 
 // haleyjd 09/10/06: span drawing engines
@@ -170,7 +181,8 @@ int r_span_engine_num;
 
 static spandrawer_t *r_span_engines[NUMSPANENGINES] =
 {
-   &r_spandrawer,    // normal engine
+   &r_spandrawer,      // normal engine
+   &r_sse2_spandrawer, // SSE2 engine
 };
 
 //
@@ -181,6 +193,10 @@ static spandrawer_t *r_span_engines[NUMSPANENGINES] =
 void R_SetSpanEngine(void)
 {
    r_span_engine = r_span_engines[r_span_engine_num];
+
+   // threaded drawing records spans to be drawn at the end of the frame
+   if(R_DeferredDrawing())
+      r_span_engine = R_DeferredSpanEngine(r_span_engine);
 }
 
 //
@@ -874,6 +890,7 @@ static void R_SetupFrame(player_t *player, camera_t *camera)
    
    // haleyjd 09/04/06: set or change column drawing engine
    // haleyjd 09/10/06: set or change span drawing engine
+   R_SetupDeferred();
    R_SetColumnEngine();
    R_SetSpanEngine();
    R_IncrementFrameid(); // Cardboard
@@ -1054,6 +1071,7 @@ void R_RenderPlayerView(player_t* player, camera_t *camerapoint)
 {
    bool quake = false;
    unsigned int savedflags = 0;
+   ProfileScope profile(PROF_RENDER);
 
    R_SetupFrame(player, camerapoint);
    
@@ -1081,8 +1099,20 @@ void R_RenderPlayerView(player_t* player, camera_t *camerapoint)
       player->mo->flags2 |= MF2_DONTDRAW;
    }
 
+   // cull with the PVS, unless the view may be somewhere its sector
+   // doesn't enclose
+   if(!camerapoint && !(player->cheats & CF_NOCLIP) && 
+      !(player->mo->flags & MF_NOCLIP))
+      r_pvsrow = P_PVSRow(R_PointInSubsector(viewx, viewy)->sector - sectors);
+
    // The head node is the last node output.
-   R_RenderBSPNode(numnodes - 1);
+   {
+      ProfileScope profbsp(PROF_BSP);
+      R_RenderBSPNode(numnodes - 1);
+   }
+
+   // portal views are not culled
+   r_pvsrow = NULL;
 
    if(quake)
       player->mo->flags2 = savedflags;
@@ -1096,20 +1126,35 @@ void R_RenderPlayerView(player_t* player, camera_t *camerapoint)
    R_PushPost(true, NULL);
    
    // SoM 12/9/03: render the portals.
-   R_RenderPortals();
+   {
+      ProfileScope profportals(PROF_PORTALS);
+      R_RenderPortals();
+   }
 
-   R_DrawPlanes(NULL);
+   {
+      ProfileScope profplanes(PROF_PLANES);
+      R_DrawPlanes(NULL);
+   }
    
    // Check for new console commands.
    NetUpdate();
 
    // Draw Post-BSP elements such as sprites, masked textures, and portal 
    // overlays
-   R_DrawPostBSP();
+   {
+      ProfileScope profmasked(PROF_MASKED);
+      R_DrawPostBSP();
    
-   // haleyjd 09/04/06: handle through column engine
-   if(r_column_engine->ResetBuffer)
-      r_column_engine->ResetBuffer();
+      // haleyjd 09/04/06: handle through column engine
+      if(r_column_engine->ResetBuffer)
+         r_column_engine->ResetBuffer();
+   }
+
+   // draw everything recorded for threaded drawing
+   {
+      ProfileScope profdeferred(PROF_DEFERRED);
+      R_FlushDeferred();
+   }
 
    // haleyjd: remove sector interpolations
    if(view.lerp != FRACUNIT)
@@ -1290,8 +1335,8 @@ void R_DoomTLStyle()
 
 static const char *handedstr[]  = { "right", "left" };
 static const char *ptranstr[]   = { "none", "smooth", "general" };
-static const char *coleng[]     = { "normal", "quad" };
-static const char *spaneng[]    = { "highprecision" };
+static const char *coleng[]     = { "normal", "quad", "sse2", "wide" };
+static const char *spaneng[]    = { "highprecision", "sse2" };
 static const char *tlstylestr[] = { "none", "boom", "new" };
 
 VARIABLE_BOOLEAN(lefthanded, NULL,                  handedstr);
@@ -0,0 +1,552 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    Threaded drawing. While enabled, the column and span drawers record
+//    their work into a command queue during the serial BSP and clipping
+//    passes; the queue is then replayed in parallel at the end of the frame,
+//    with the view split into vertical strips, one per job.
+//
+//    Every command is replayed by each strip it touches, clipped to that
+//    strip, and strips never overlap, so the drawing order within any one
+//    pixel is exactly the order in which the commands were recorded.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+
+#include "c_runcmd.h"
+#include "m_workers.h"
+#include "r_draw.h"
+#include "r_main.h"
+#include "r_parallel.h"
+#include "r_plane.h"
+
+// Number of threads to draw with; 0 or 1 disables threaded drawing.
+int r_numthreads;
+
+//=============================================================================
+//
+// Command Queue
+//
+
+enum
+{
+   DCMD_COLUMN,   // column drawer call
+   DCMD_SPAN,     // flat span drawer call
+   DCMD_SLOPE,    // sloped span drawer call
+   DCMD_CALLBACK, // arbitrary deferred draw
+};
+
+struct rdcmd_t
+{
+   int type;   // DCMD_* type
+   int size;   // size of the whole command, in bytes
+   int x1, x2; // range of screen columns touched
+};
+
+struct rdcolumncmd_t
+{
+   rdcmd_t     hdr;
+   void      (*func)(void);
+   byte       *tranmap;
+   int         fuzzpos;
+   cb_column_t column;
+};
+
+struct rdspancmd_t
+{
+   rdcmd_t   hdr;
+   void    (*func)(void);
+   cb_span_t span;
+};
+
+// Followed by (x2 - x1 + 1) colormap pointers.
+struct rdslopecmd_t
+{
+   rdcmd_t   hdr;
+   void    (*func)(void);
+   cb_span_t span;
+   int       y, x1, x2;
+   double    iufrac, ivfrac, idfrac;
+   double    iustep, ivstep, idstep;
+   void     *source;
+};
+
+// Followed by the callback's data.
+struct rdcallbackcmd_t
+{
+   rdcmd_t      hdr;
+   rdeferfunc_t func;
+};
+
+static byte  *cmdbuffer;
+static size_t cmdbuffersize;
+static size_t cmdbufferused;
+
+static bool deferring;     // true if this frame's drawing is being recorded
+static int  stripwidth;    // width of each strip during a flush
+
+static columndrawer_t *columnTarget; // column engine that will replay columns
+static spandrawer_t   *spanTarget;   // span engine that will replay spans
+
+//
+// R_allocCommand
+//
+// Reserve space for a command at the end of the queue. The queue only ever
+// grows, so after the first few frames this does not allocate.
+//
+static void *R_allocCommand(int type, size_t size, int x1, int x2)
+{
+   rdcmd_t *hdr;
+
+   size = (size + 7) & ~7; // keep doubles aligned
+
+   if(cmdbufferused + size > cmdbuffersize)
+   {
+      size_t newsize = cmdbuffersize ? cmdbuffersize * 2 : 256 * 1024;
+
+      while(newsize < cmdbufferused + size)
+         newsize *= 2;
+
+      cmdbuffer     = erealloc(byte *, cmdbuffer, newsize);
+      cmdbuffersize = newsize;
+   }
+
+   hdr = reinterpret_cast<rdcmd_t *>(cmdbuffer + cmdbufferused);
+   cmdbufferused += size;
+
+   hdr->type = type;
+   hdr->size = static_cast<int>(size);
+   hdr->x1   = x1;
+   hdr->x2   = x2;
+
+   return hdr;
+}
+
+//=============================================================================
+//
+// Column Recording
+//
+
+//
+// R_deferColumn
+//
+// Record a column to be drawn by one of the target engine's drawers.
+//
+static void R_deferColumn(void (*func)(void))
+{
+   rdcolumncmd_t *cmd;
+
+   if(column.y2 < column.y1)
+      return;
+
+   cmd = static_cast<rdcolumncmd_t *>(
+      R_allocCommand(DCMD_COLUMN, sizeof(rdcolumncmd_t), column.x, column.x));
+
+   cmd->func    = func;
+   cmd->tranmap = tranmap;
+   cmd->fuzzpos = fuzzpos;
+   cmd->column  = column;
+}
+
+#define DEFERRED_COLUMN(slot) \
+   static void R_Defer ## slot(void) { R_deferColumn(columnTarget->slot); }
+
+DEFERRED_COLUMN(DrawColumn)
+DEFERRED_COLUMN(DrawTLColumn)
+DEFERRED_COLUMN(DrawTRColumn)
+DEFERRED_COLUMN(DrawTLTRColumn)
+DEFERRED_COLUMN(DrawFlexColumn)
+DEFERRED_COLUMN(DrawFlexTRColumn)
+DEFERRED_COLUMN(DrawAddColumn)
+DEFERRED_COLUMN(DrawAddTRColumn)
+
+//
+// R_DeferDrawFuzzColumn
+//
+// The fuzz drawer advances fuzzpos once per pixel drawn, so the recorder
+// must do the same for the next fuzz column to start at the right place.
+// This mirrors the border adjustment in CB_DrawFuzzColumn_8, which every
+// unbuffered engine uses.
+//
+static void R_DeferDrawFuzzColumn(void)
+{
+   int y1 = column.y1, y2 = column.y2, count;
+
+   if(!y1)
+      y1 = 1;
+   if(y2 == viewwindow.height - 1)
+      y2 = viewwindow.height - 2;
+
+   if((count = y2 - y1 + 1) <= 0)
+      return;
+
+   R_deferColumn(columnTarget->DrawFuzzColumn);
+
+   fuzzpos = (fuzzpos + count) % FUZZTABLE;
+}
+
+static columndrawer_t r_deferred_drawer =
+{
+   R_DeferDrawColumn,
+   R_DeferDrawTLColumn,
+   R_DeferDrawTRColumn,
+   R_DeferDrawTLTRColumn,
+   R_DeferDrawFuzzColumn,
+   R_DeferDrawFlexColumn,
+   R_DeferDrawFlexTRColumn,
+   R_DeferDrawAddColumn,
+   R_DeferDrawAddTRColumn,
+
+   NULL,
+
+   {
+      // Normal                Translated
+      { R_DeferDrawColumn,     R_DeferDrawTRColumn     }, // NORMAL
+      { R_DeferDrawFuzzColumn, R_DeferDrawFuzzColumn   }, // SHADOW
+      { R_DeferDrawFlexColumn, R_DeferDrawFlexTRColumn }, // ALPHA
+      { R_DeferDrawAddColumn,  R_DeferDrawAddTRColumn  }, // ADD
+      { R_DeferDrawTLColumn,   R_DeferDrawTLTRColumn   }, // SUB
+      { R_DeferDrawTLColumn,   R_DeferDrawTLTRColumn   }, // TRANMAP
+   },
+};
+
+//=============================================================================
+//
+// Span Recording
+//
+
+template<int style, int size> static void R_deferSpan(void)
+{
+   rdspancmd_t *cmd;
+
+   if(span.x2 < span.x1)
+      return;
+
+   cmd = static_cast<rdspancmd_t *>(
+      R_allocCommand(DCMD_SPAN, sizeof(rdspancmd_t), span.x1, span.x2));
+
+   cmd->func = spanTarget->DrawSpan[style][size];
+   cmd->span = span;
+}
+
+template<int style, int size> static void R_deferSlope(void)
+{
+   rdslopecmd_t *cmd;
+   int count = slopespan.x2 - slopespan.x1 + 1;
+
+   if(count <= 0)
+      return;
+
+   cmd = static_cast<rdslopecmd_t *>(
+      R_allocCommand(DCMD_SLOPE, 
+                     sizeof(rdslopecmd_t) + count * sizeof(lighttable_t *),
+                     slopespan.x1, slopespan.x2));
+
+   cmd->func   = spanTarget->DrawSlope[style][size];
+   cmd->span   = span;
+   cmd->y      = slopespan.y;
+   cmd->x1     = slopespan.x1;
+   cmd->x2     = slopespan.x2;
+   cmd->iufrac = slopespan.iufrac;
+   cmd->ivfrac = slopespan.ivfrac;
+   cmd->idfrac = slopespan.idfrac;
+   cmd->iustep = slopespan.iustep;
+   cmd->ivstep = slopespan.ivstep;
+   cmd->idstep = slopespan.idstep;
+   cmd->source = slopespan.source;
+
+   memcpy(cmd + 1, slopespan.colormap, count * sizeof(lighttable_t *));
+}
+
+#define DEFERRED_SPANS(func, style) \
+   { func<style, FLAT_64>,  func<style, FLAT_128>, func<style, FLAT_256>, \
+     func<style, FLAT_512>, func<style, FLAT_GENERALIZED> }
+
+static spandrawer_t r_deferred_spandrawer =
+{
+   {
+      DEFERRED_SPANS(R_deferSpan, SPAN_STYLE_NORMAL),
+      DEFERRED_SPANS(R_deferSpan, SPAN_STYLE_TL),
+      DEFERRED_SPANS(R_deferSpan, SPAN_STYLE_ADD),
+   },
+   {
+      DEFERRED_SPANS(R_deferSlope, SPAN_STYLE_NORMAL),
+      DEFERRED_SPANS(R_deferSlope, SPAN_STYLE_TL),
+      DEFERRED_SPANS(R_deferSlope, SPAN_STYLE_ADD),
+   }
+};
+
+//=============================================================================
+//
+// Replay
+//
+
+//
+// R_replayColumn
+//
+static void R_replayColumn(const rdcolumncmd_t *cmd)
+{
+   column  = cmd->column;
+   tranmap = cmd->tranmap;
+   fuzzpos = cmd->fuzzpos;
+   cmd->func();
+}
+
+//
+// R_replaySpan
+//
+// Spans step their texture coordinates with plain modular arithmetic, so 
+// clipping off the left end is exact.
+//
+static void R_replaySpan(const rdspancmd_t *cmd, int x1, int x2)
+{
+   unsigned int dx = static_cast<unsigned int>(x1 - cmd->span.x1);
+
+   span = cmd->span;
+   span.xfrac += span.xstep * dx;
+   span.yfrac += span.ystep * dx;
+   span.x1 = x1;
+   span.x2 = x2;
+   cmd->func();
+}
+
+//
+// R_replaySlope
+//
+// Sloped spans are interpolated in runs from their start, so a span split 
+// between strips may differ from the serial result by a fraction of a texel
+// at the seam.
+//
+static void R_replaySlope(const rdslopecmd_t *cmd, int x1, int x2)
+{
+   const lighttable_t *const *colormaps = 
+      reinterpret_cast<const lighttable_t *const *>(cmd + 1);
+   int dx = x1 - cmd->x1;
+
+   span = cmd->span;
+
+   slopespan.y      = cmd->y;
+   slopespan.x1     = x1;
+   slopespan.x2     = x2;
+   slopespan.iufrac = cmd->iufrac + cmd->iustep * dx;
+   slopespan.ivfrac = cmd->ivfrac + cmd->ivstep * dx;
+   slopespan.idfrac = cmd->idfrac + cmd->idstep * dx;
+   slopespan.iustep = cmd->iustep;
+   slopespan.ivstep = cmd->ivstep;
+   slopespan.idstep = cmd->idstep;
+   slopespan.source = cmd->source;
+
+   memcpy(slopespan.colormap, colormaps + dx, 
+          (x2 - x1 + 1) * sizeof(lighttable_t *));
+
+   cmd->func();
+}
+
+//
+// R_replayStrip
+//
+// Worker job: replay every command touching one strip of the view.
+//
+static void R_replayStrip(int jobnum, int threadnum, void *data)
+{
+   int sx1 = jobnum * stripwidth;
+   int sx2 = sx1 + stripwidth - 1;
+   byte *cur = cmdbuffer, *end = cmdbuffer + cmdbufferused;
+
+   if(sx2 >= viewwindow.width)
+      sx2 = viewwindow.width - 1;
+   if(sx1 > sx2)
+      return;
+
+   while(cur < end)
+   {
+      const rdcmd_t *hdr = reinterpret_cast<const rdcmd_t *>(cur);
+      int x1, x2;
+
+      cur += hdr->size;
+
+      if(hdr->x2 < sx1 || hdr->x1 > sx2)
+         continue;
+
+      x1 = hdr->x1 < sx1 ? sx1 : hdr->x1;
+      x2 = hdr->x2 > sx2 ? sx2 : hdr->x2;
+
+      switch(hdr->type)
+      {
+      case DCMD_COLUMN:
+         R_replayColumn(reinterpret_cast<const rdcolumncmd_t *>(hdr));
+         break;
+      case DCMD_SPAN:
+         R_replaySpan(reinterpret_cast<const rdspancmd_t *>(hdr), x1, x2);
+         break;
+      case DCMD_SLOPE:
+         R_replaySlope(reinterpret_cast<const rdslopecmd_t *>(hdr), x1, x2);
+         break;
+      case DCMD_CALLBACK:
+         {
+            const rdcallbackcmd_t *cmd = 
+               reinterpret_cast<const rdcallbackcmd_t *>(hdr);
+            cmd->func(cmd + 1, x1, x2);
+         }
+         break;
+      default:
+         break;
+      }
+   }
+}
+
+//=============================================================================
+//
+// Global Interface
+//
+
+//
+// R_SetupDeferred
+//
+// Called at the start of each frame to decide whether its drawing will be
+// deferred and run on the worker threads.
+//
+bool R_SetupDeferred()
+{
+   deferring = (r_numthreads > 1 && M_NumWorkerThreads() > 1);
+   cmdbufferused = 0;
+
+   return deferring;
+}
+
+//
+// R_DeferredDrawing
+//
+// Returns true if the current frame's drawing is being recorded.
+//
+bool R_DeferredDrawing()
+{
+   return deferring;
+}
+
+//
+// R_DeferredColumnEngine
+//
+// Returns the recording column engine; recorded columns will be drawn by the
+// target engine. Engines with a ResetBuffer keep state between columns, as
+// the quad cache does, and cannot be replayed out of order on several
+// threads, so the normal engine stands in for them.
+//
+columndrawer_t *R_DeferredColumnEngine(columndrawer_t *target)
+{
+   columnTarget = target->ResetBuffer ? &r_normal_drawer : target;
+   return &r_deferred_drawer;
+}
+
+//
+// R_DeferredSpanEngine
+//
+// Returns the recording span engine; recorded spans will be drawn by the
+// target engine.
+//
+spandrawer_t *R_DeferredSpanEngine(spandrawer_t *target)
+{
+   spanTarget = target;
+   return &r_deferred_spandrawer;
+}
+
+//
+// R_ThreadedSpanEngine
+//
+// Returns the span engine that worker threads draw with directly.
+//
+spandrawer_t *R_ThreadedSpanEngine()
+{
+   return spanTarget;
+}
+
+//
+// R_DeferDraw
+//
+// Queue an arbitrary drawing operation touching columns x1 through x2. The
+// data is copied into the queue. Returns false if drawing is not currently
+// deferred, in which case the caller should draw immediately.
+//
+bool R_DeferDraw(rdeferfunc_t func, const void *data, size_t size, 
+                 int x1, int x2)
+{
+   rdcallbackcmd_t *cmd;
+
+   if(!deferring)
+      return false;
+
+   if(x2 < x1)
+      return true;
+
+   cmd = static_cast<rdcallbackcmd_t *>(
+      R_allocCommand(DCMD_CALLBACK, sizeof(rdcallbackcmd_t) + size, x1, x2));
+
+   cmd->func = func;
+   memcpy(cmd + 1, data, size);
+
+   return true;
+}
+
+//
+// R_FlushDeferred
+//
+// Draw everything recorded so far. Must be called before anything reads
+// from or writes to the screen directly, and at the end of the frame.
+//
+void R_FlushDeferred()
+{
+   int numstrips;
+
+   if(!deferring || !cmdbufferused)
+      return;
+
+   // The main thread takes part in the replay, which clobbers its drawing
+   // state; keep it intact for anything recorded after a mid-frame flush.
+   cb_column_t savedcolumn  = column;
+   cb_span_t   savedspan    = span;
+   byte       *savedtranmap = tranmap;
+   int         savedfuzzpos = fuzzpos;
+
+   numstrips  = r_numthreads;
+   stripwidth = (viewwindow.width + numstrips - 1) / numstrips;
+   stripwidth = (stripwidth + 15) & ~15; // keep strips apart in cache
+
+   M_RunJobs(R_replayStrip, NULL, numstrips);
+
+   column  = savedcolumn;
+   span    = savedspan;
+   tranmap = savedtranmap;
+   fuzzpos = savedfuzzpos;
+
+   cmdbufferused = 0;
+}
+
+//=============================================================================
+//
+// Console Variables
+//
+
+VARIABLE_INT(r_numthreads, NULL, 0, MAXWORKERTHREADS, NULL);
+CONSOLE_VARIABLE(r_threads, r_numthreads, 0) {}
+
+// EOF
+
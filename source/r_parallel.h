@@ -0,0 +1,55 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    Threaded drawing. While enabled, the column and span drawers record
+//    their work into a command queue during the serial BSP and clipping
+//    passes; the queue is then replayed in parallel at the end of the frame,
+//    with the view split into vertical strips, one per job.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef R_PARALLEL_H__
+#define R_PARALLEL_H__
+
+struct columndrawer_t;
+struct spandrawer_t;
+
+extern int r_numthreads;
+
+// Deferred drawing callback: draw the recorded data, touching only screen
+// columns x1 through x2 inclusive.
+typedef void (*rdeferfunc_t)(const void *data, int x1, int x2);
+
+bool R_SetupDeferred();
+bool R_DeferredDrawing();
+
+columndrawer_t *R_DeferredColumnEngine(columndrawer_t *target);
+spandrawer_t   *R_DeferredSpanEngine(spandrawer_t *target);
+spandrawer_t   *R_ThreadedSpanEngine();
+
+bool R_DeferDraw(rdeferfunc_t func, const void *data, size_t size, 
+                 int x1, int x2);
+void R_FlushDeferred();
+
+#endif
+
+// EOF
+
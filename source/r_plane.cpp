@@ -48,7 +48,9 @@
 #include "p_slopes.h"
 #include "p_user.h"
 #include "r_draw.h"
+#include "m_workers.h"
 #include "r_main.h"
+#include "r_parallel.h"
 #include "r_plane.h"
 #include "r_portal.h"
 #include "r_ripple.h"
@@ -145,9 +147,9 @@ VALLOCATION(spanstart)
 // texture mapping
 //
 
-cb_span_t      span;
-cb_plane_t     plane;
-cb_slopespan_t slopespan;
+EE_THREADLOCAL cb_span_t      span;
+EE_THREADLOCAL cb_plane_t     plane;
+EE_THREADLOCAL cb_slopespan_t slopespan;
 
 float slopevis; // SoM: used in slope lighting
 
@@ -157,8 +159,8 @@ void R_Throw(void)
    I_Error("R_Throw called.\n");
 }
 
-void (*flatfunc)(void)  = R_Throw;
-void (*slopefunc)(void) = R_Throw;
+EE_THREADLOCAL void (*flatfunc)(void)  = R_Throw;
+EE_THREADLOCAL void (*slopefunc)(void) = R_Throw;
 
 //
 // R_SpanLight
@@ -1030,6 +1032,156 @@ static const int MultiplyDeBruijnBitPosition2[32] =
   31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
 };
 
+//
+// R_setupFlat
+//
+// Sets up the plane and span drawing state for a regular flat, using the
+// drawers of the given span engine.
+//
+static void R_setupFlat(visplane_t *pl, spandrawer_t *engine)
+{
+   texture_t *tex;
+   int        light;
+   int        stylenum;
+
+   int picnum = texturetranslation[pl->picnum];
+
+   // haleyjd 05/19/06: rewritten to avoid crashes
+   if(((r_swirl && textures[pl->picnum]->flags & TF_ANIMATED)
+      || textures[pl->picnum]->flags & TF_SWIRLY)
+      && textures[pl->picnum]->flatsize == FLAT_64)
+   {
+      plane.source = R_DistortedFlat(pl->picnum);
+      tex = plane.tex = textures[pl->picnum];
+   }
+   else
+   {
+      // SoM: Handled outside
+      tex = plane.tex = R_CacheTexture(picnum);
+      plane.source = tex->buffer;
+   }
+
+   // haleyjd: TODO: feed pl->drawstyle to the first dimension to enable
+   // span drawstyles (ie. translucency)
+
+   stylenum = (pl->bflags & PS_ADDITIVE) ? SPAN_STYLE_ADD : 
+              (pl->bflags & PS_OVERLAY)  ? SPAN_STYLE_TL :
+              SPAN_STYLE_NORMAL;
+             
+   flatfunc  = engine->DrawSpan[stylenum][tex->flatsize];
+   slopefunc = engine->DrawSlope[stylenum][tex->flatsize];
+   
+   if(stylenum == SPAN_STYLE_TL)
+   {
+      int level = (pl->opacity + 1) >> 2;
+      
+      span.fg2rgb = Col2RGB8[level];
+      span.bg2rgb = Col2RGB8[64 - level];
+   }
+   else if(stylenum == SPAN_STYLE_ADD)
+   {
+      int level = (pl->opacity + 1) >> 2;
+      
+      span.fg2rgb = Col2RGB8_LessPrecision[level];
+      span.bg2rgb = Col2RGB8_LessPrecision[64];
+   }
+   else
+      span.fg2rgb = span.bg2rgb = NULL;
+
+   if(pl->pslope)
+      plane.slope = &pl->rslope;
+   else
+      plane.slope = NULL;
+      
+   {
+      int rw, rh;
+      
+      rh = MultiplyDeBruijnBitPosition2[(uint32_t)(tex->height * 0x077CB531U) >> 27];
+      rw = MultiplyDeBruijnBitPosition2[(uint32_t)(tex->width * 0x077CB531U) >> 27];
+
+      if(plane.slope)
+      {
+         span.ymask = tex->height - 1;
+         
+         span.xshift = 16 - rh;
+         span.xmask = (tex->width - 1) << (16 - span.xshift);
+      }
+      else
+      {
+         span.yshift = 32 - rh;
+         
+         span.xshift = span.yshift - rw;
+         span.xmask = (tex->width - 1) << (32 - rw - span.xshift);
+         
+         plane.fixedunitx = (float)(1 << (32 - rw));
+         plane.fixedunity = (float)(1 << span.yshift);
+      }
+   }
+    
+     
+   plane.xoffset = pl->xoffsf;  // killough 2/28/98: Add offsets
+   plane.yoffset = pl->yoffsf;
+
+   plane.pviewx   = pl->viewxf;
+   plane.pviewy   = pl->viewyf;
+   plane.pviewz   = pl->viewzf;
+   plane.pviewsin = pl->viewsin; // haleyjd 01/05/08: Add angle
+   plane.pviewcos = pl->viewcos;
+   plane.height   = pl->heightf - pl->viewzf;
+   
+   //light = (pl->lightlevel >> LIGHTSEGSHIFT) + (extralight * LIGHTBRIGHT);
+
+   // SoM 10/19/02: deep water colormap fix
+   if(fixedcolormap)
+      light = (255  >> LIGHTSEGSHIFT);
+   else
+      light = (pl->lightlevel >> LIGHTSEGSHIFT) + (extralight * LIGHTBRIGHT);
+
+   if(light >= LIGHTLEVELS)
+      light = LIGHTLEVELS-1;
+
+   if(light < 0)
+      light = 0;
+
+   pl->top[pl->minx-1] = pl->top[pl->maxx+1] = 0x7FFFFFFF;
+
+   plane.planezlight   = pl->colormap[light]; //zlight[light];
+   plane.colormap      = pl->fullcolormap;
+   plane.fixedcolormap = pl->fixedcolormap; // haleyjd 10/16/06
+   plane.lightlevel    = pl->lightlevel;
+
+   R_PlaneLight();
+
+   plane.MapFunc = (plane.slope == NULL ? R_MapPlane : R_MapSlope);
+}
+
+//
+// R_drawFlatRows
+//
+// Draws rows y1 through y2 of a regular flat set up by R_setupFlat. Spans
+// lie along a single row, so clipping each column to the band of rows gives
+// exactly the same spans in those rows as drawing the whole plane.
+//
+static void R_drawFlatRows(const visplane_t *pl, int y1, int y2)
+{
+   int stop = pl->maxx + 1;
+   int t1, b1, t2, b2;
+
+   t2 = pl->top[pl->minx - 1];
+   b2 = pl->bottom[pl->minx - 1];
+
+   for(int x = pl->minx; x <= stop; x++)
+   {
+      t1 = t2;
+      b1 = b2;
+      t2 = pl->top[x];
+      b2 = pl->bottom[x];
+
+      R_MakeSpans(x, t1 < y1 ? y1 : t1, b1 > y2 ? y2 : b1, 
+                     t2 < y1 ? y1 : t2, b2 > y2 ? y2 : b2);
+   }
+}
+
 //
 // do_draw_plane
 //
@@ -1146,124 +1298,118 @@ static void do_draw_plane(visplane_t *pl)
    }
    else      // regular flat
    {  
-      texture_t *tex;
-      int        stop, light;
-      int        stylenum;
+      R_setupFlat(pl, r_span_engine);
+      R_drawFlatRows(pl, 0, viewwindow.height - 1);
+   }
+}
 
-      int picnum = texturetranslation[pl->picnum];
+//=============================================================================
+//
+// Threaded Plane Drawing
+//
+// When drawing is threaded, regular flats are set up serially, then drawn
+// by the worker threads in horizontal bands of rows. Each band walks every
+// flat in the original order, so the result is identical to serial drawing.
+// Skies are drawn with the column drawers, which are already deferred.
+//
 
-      // haleyjd 05/19/06: rewritten to avoid crashes
-      if(((r_swirl && textures[pl->picnum]->flags & TF_ANIMATED)
-         || textures[pl->picnum]->flags & TF_SWIRLY)
-         && textures[pl->picnum]->flatsize == FLAT_64)
-      {
-         plane.source = R_DistortedFlat(pl->picnum);
-         tex = plane.tex = textures[pl->picnum];
-      }
-      else
-      {
-         // SoM: Handled outside
-         tex = plane.tex = R_CacheTexture(picnum);
-         plane.source = tex->buffer;
-      }
+struct flatjob_t
+{
+   visplane_t *pl;
+   cb_plane_t  plane;
+   cb_span_t   span;
+   void      (*flatfunc)(void);
+   void      (*slopefunc)(void);
+};
 
-      // haleyjd: TODO: feed pl->drawstyle to the first dimension to enable
-      // span drawstyles (ie. translucency)
+static flatjob_t *flatjobs;
+static int        numflatjobs;
+static int        numflatjobsalloc;
+static int        flatbandheight;
 
-      stylenum = (pl->bflags & PS_ADDITIVE) ? SPAN_STYLE_ADD : 
-                 (pl->bflags & PS_OVERLAY)  ? SPAN_STYLE_TL :
-                 SPAN_STYLE_NORMAL;
-                
-      flatfunc  = r_span_engine->DrawSpan[stylenum][tex->flatsize];
-      slopefunc = r_span_engine->DrawSlope[stylenum][tex->flatsize];
-      
-      if(stylenum == SPAN_STYLE_TL)
-      {
-         int level = (pl->opacity + 1) >> 2;
-         
-         span.fg2rgb = Col2RGB8[level];
-         span.bg2rgb = Col2RGB8[64 - level];
-      }
-      else if(stylenum == SPAN_STYLE_ADD)
-      {
-         int level = (pl->opacity + 1) >> 2;
-         
-         span.fg2rgb = Col2RGB8_LessPrecision[level];
-         span.bg2rgb = Col2RGB8_LessPrecision[64];
-      }
-      else
-         span.fg2rgb = span.bg2rgb = NULL;
+//
+// R_drawFlatBand
+//
+// Worker job: draw one band of rows of every queued flat.
+//
+static void R_drawFlatBand(int jobnum, int threadnum, void *data)
+{
+   int y1 = jobnum * flatbandheight;
+   int y2 = y1 + flatbandheight - 1;
 
-      if(pl->pslope)
-         plane.slope = &pl->rslope;
-      else
-         plane.slope = NULL;
-         
+   if(y2 >= viewwindow.height)
+      y2 = viewwindow.height - 1;
+   if(y1 > y2)
+      return;
+
+   for(int i = 0; i < numflatjobs; i++)
+   {
+      const flatjob_t &job = flatjobs[i];
+
+      plane     = job.plane;
+      span      = job.span;
+      flatfunc  = job.flatfunc;
+      slopefunc = job.slopefunc;
+
+      R_drawFlatRows(job.pl, y1, y2);
+   }
+}
+
+//
+// R_drawPlanesThreaded
+//
+static void R_drawPlanesThreaded(planehash_t *table)
+{
+   spandrawer_t *engine = R_ThreadedSpanEngine();
+   visplane_t   *pl;
+   int           numbands;
+
+   numflatjobs = 0;
+
+   for(int i = 0; i < table->chaincount; ++i)
+   {
+      for(pl = table->chains[i]; pl; pl = pl->next)
       {
-         int rw, rh;
-         
-         rh = MultiplyDeBruijnBitPosition2[(uint32_t)(tex->height * 0x077CB531U) >> 27];
-         rw = MultiplyDeBruijnBitPosition2[(uint32_t)(tex->width * 0x077CB531U) >> 27];
+         if(!(pl->minx <= pl->maxx))
+            continue;
 
-         if(plane.slope)
+         if(pl->picnum == skyflatnum || pl->picnum == sky2flatnum ||
+            pl->picnum & PL_SKYFLAT)
          {
-            span.ymask = tex->height - 1;
-            
-            span.xshift = 16 - rh;
-            span.xmask = (tex->width - 1) << (16 - span.xshift);
+            do_draw_plane(pl);
+            continue;
          }
-         else
+
+         if(numflatjobs >= numflatjobsalloc)
          {
-            span.yshift = 32 - rh;
-            
-            span.xshift = span.yshift - rw;
-            span.xmask = (tex->width - 1) << (32 - rw - span.xshift);
-            
-            plane.fixedunitx = (float)(1 << (32 - rw));
-            plane.fixedunity = (float)(1 << span.yshift);
+            numflatjobsalloc = numflatjobsalloc ? numflatjobsalloc * 2 : 128;
+            flatjobs = erealloc(flatjob_t *, flatjobs, 
+                                numflatjobsalloc * sizeof(flatjob_t));
          }
-      }
-       
-        
-      plane.xoffset = pl->xoffsf;  // killough 2/28/98: Add offsets
-      plane.yoffset = pl->yoffsf;
-
-      plane.pviewx   = pl->viewxf;
-      plane.pviewy   = pl->viewyf;
-      plane.pviewz   = pl->viewzf;
-      plane.pviewsin = pl->viewsin; // haleyjd 01/05/08: Add angle
-      plane.pviewcos = pl->viewcos;
-      plane.height   = pl->heightf - pl->viewzf;
-      
-      //light = (pl->lightlevel >> LIGHTSEGSHIFT) + (extralight * LIGHTBRIGHT);
 
-      // SoM 10/19/02: deep water colormap fix
-      if(fixedcolormap)
-         light = (255  >> LIGHTSEGSHIFT);
-      else
-         light = (pl->lightlevel >> LIGHTSEGSHIFT) + (extralight * LIGHTBRIGHT);
+         // texture caching and swirling happen here, on the main thread
+         R_setupFlat(pl, engine);
 
-      if(light >= LIGHTLEVELS)
-         light = LIGHTLEVELS-1;
-
-      if(light < 0)
-         light = 0;
-
-      stop = pl->maxx + 1;
-      pl->top[pl->minx-1] = pl->top[stop] = 0x7FFFFFFF;
+         flatjob_t &job = flatjobs[numflatjobs++];
+         job.pl        = pl;
+         job.plane     = plane;
+         job.span      = span;
+         job.flatfunc  = flatfunc;
+         job.slopefunc = slopefunc;
+      }
+   }
 
-      plane.planezlight   = pl->colormap[light]; //zlight[light];
-      plane.colormap      = pl->fullcolormap;
-      plane.fixedcolormap = pl->fixedcolormap; // haleyjd 10/16/06
-      plane.lightlevel    = pl->lightlevel;
+   if(!numflatjobs)
+      return;
 
-      R_PlaneLight();
+   // Anything recorded so far must be on the screen first; translucent
+   // overlay planes blend with it.
+   R_FlushDeferred();
 
-      plane.MapFunc = (plane.slope == NULL ? R_MapPlane : R_MapSlope);
+   numbands       = r_numthreads;
+   flatbandheight = (viewwindow.height + numbands - 1) / numbands;
 
-      for(x = pl->minx ; x <= stop ; x++)
-         R_MakeSpans(x, pl->top[x-1], pl->bottom[x-1], pl->top[x], pl->bottom[x]);
-   }
+   M_RunJobs(R_drawFlatBand, NULL, numbands);
 }
 
 //
@@ -1279,6 +1425,12 @@ void R_DrawPlanes(planehash_t *table)
    
    if(!table)
       table = &mainhash;
+
+   if(R_DeferredDrawing())
+   {
+      R_drawPlanesThreaded(table);
+      return;
+   }
    
    for(i = 0; i < table->chaincount; ++i)
    {
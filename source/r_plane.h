@@ -119,10 +119,10 @@ typedef struct cb_slopespan_s
 } cb_slopespan_t;
 
 
-extern cb_span_t  span;
-extern cb_plane_t plane;
+extern EE_THREADLOCAL cb_span_t  span;
+extern EE_THREADLOCAL cb_plane_t plane;
 
-extern cb_slopespan_t slopespan;
+extern EE_THREADLOCAL cb_slopespan_t slopespan;
 
 #endif
 
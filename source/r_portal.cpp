@@ -34,6 +34,7 @@
 #include "r_bsp.h"
 #include "r_draw.h"
 #include "r_main.h"
+#include "r_parallel.h"
 #include "r_plane.h"
 #include "r_portal.h"
 #include "r_state.h"
@@ -784,6 +785,9 @@ static void R_ShowTainted(pwindow_t *window)
    static byte taintcolor = 0;
    int y1, y2, count;
 
+   // draws directly to the screen, so anything deferred must be drawn first
+   R_FlushDeferred();
+
    for(int i = window->minx; i <= window->maxx; i++)
    {
       byte *dest;
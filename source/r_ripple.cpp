@@ -47,8 +47,21 @@
 // 1 cycle per 32 units (2 in 64)
 #define SWIRLFACTOR2 (8192/32)
 
+// Swirled flats are kept per texture for the current tic, so that drawing
+// which is deferred until the end of the frame (see r_parallel.cpp) still
+// sees the right image however many different flats swirl in one view.
+// Buffers are allocated on demand, one per texture number.
+struct distortedflat_t
+{
+   const byte *source; // texture buffer it was swirled from
+   int         tic;    // gametic it was swirled on
+   byte       *data;
+};
+
 static byte *normalflat;
-static byte distortedflat[4096];
+static distortedflat_t *distortedflats;
+static int numdistortedflats;
+
 int r_swirl;       // hack
 
 #if 0
@@ -77,22 +90,33 @@ static void R_DrawLines(void)
 //
 byte *R_DistortedFlat(int texnum)
 {
-   static int lasttex = -1;
    static int swirltic = -1;
    static int offset[4096];
    int i;
    int leveltic = gametic;
    texture_t *tex = R_CacheTexture(texnum);
+   distortedflat_t *flat;
    
    // SoM: different flat sizes?
    if(tex->flatsize != FLAT_64)
       return tex->buffer;
       
+   if(texnum >= numdistortedflats)
+   {
+      int newnum = texturecount > texnum ? texturecount : texnum + 1;
+
+      distortedflats = erealloc(distortedflat_t *, distortedflats, 
+                                newnum * sizeof(distortedflat_t));
+      memset(distortedflats + numdistortedflats, 0, 
+             (newnum - numdistortedflats) * sizeof(distortedflat_t));
+      numdistortedflats = newnum;
+   }
+
+   flat = &distortedflats[texnum];
+
    // Already swirled this one?
-   if(gametic == swirltic && lasttex == texnum)
-      return distortedflat;
-      
-   lasttex = texnum;
+   if(flat->data && flat->tic == gametic && flat->source == tex->buffer)
+      return flat->data;
 
    // built this tic?
    if(gametic != swirltic)
@@ -128,12 +152,18 @@ byte *R_DistortedFlat(int texnum)
       swirltic = gametic;
    }
    
+   if(!flat->data)
+      flat->data = emalloc(byte *, 4096);
+
+   flat->source = tex->buffer;
+   flat->tic    = gametic;
+
    normalflat = tex->buffer;
    
    for(i = 0; i < 4096; ++i)
-      distortedflat[i] = normalflat[offset[i]];
+      flat->data[i] = normalflat[offset[i]];
    
-   return distortedflat;
+   return flat->data;
 }
 
 // EOF
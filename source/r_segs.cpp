@@ -32,6 +32,7 @@
 #include "e_exdata.h"
 #include "p_info.h"
 #include "p_user.h"
+#include "m_profile.h"
 #include "r_draw.h"
 #include "r_bsp.h"
 #include "r_data.h"
@@ -46,7 +47,7 @@
 // OPTIMIZE: closed two sided lines as single sided
 // SoM: Done.
 // SoM: Cardboard globals
-cb_column_t column;
+EE_THREADLOCAL cb_column_t column;
 cb_seg_t    seg;
 cb_seg_t    segclip;
 
@@ -656,6 +657,8 @@ void R_StoreWallRange(const int start, const int stop)
    float pstep;
 
    bool usesegloop;
+
+   ProfileScope profile(PROF_SEGS);
    
    // haleyjd 09/22/07: must be before use of segclip below
    memcpy(&segclip, &seg, sizeof(seg));
@@ -36,6 +36,7 @@
 #include "g_game.h"
 #include "m_argv.h"
 #include "m_swap.h"
+#include "m_workers.h"
 #include "p_chase.h"
 #include "p_info.h"
 #include "p_partcl.h"
@@ -46,6 +47,7 @@
 #include "r_draw.h"
 #include "r_interpolate.h"
 #include "r_main.h"
+#include "r_parallel.h"
 #include "r_patch.h"
 #include "r_plane.h"
 #include "r_portal.h"
@@ -231,7 +233,8 @@ VALLOCATION(clipbot)
 
 // Forward declarations:
 static void R_DrawParticle(vissprite_t *vis);
-static void R_ProjectParticle(particle_t *particle);
+static void R_addParticles(sector_t *sec);
+static void R_flushParticles();
 
 //
 // R_SetMaskedSilhouette
@@ -494,6 +497,9 @@ void R_ClearSprites()
 void R_PushPost(bool pushmasked, planehash_t *overlay)
 {
    poststack_t *post;
+
+   // the BSP pass has ended; add its queued particles
+   R_flushParticles();
    
    if(stacksize == stackmax)
    {
@@ -1038,13 +1044,8 @@ void R_AddSprites(sector_t* sec, int lightlevel)
 
    // haleyjd 02/20/04: Handle all particles in sector.
 
-   if(drawparticles)
-   {
-      DLListItem<particle_t> *link;
-
-      for(link = sec->ptcllist; link; link = link->dllNext)
-         R_ProjectParticle(*link);
-   }
+   if(drawparticles && sec->ptcllist)
+      R_addParticles(sec);
 }
 
 //
@@ -1748,7 +1749,7 @@ void R_InitParticles(void)
       numParticles = atoi(myargv[i+1]);
    
    if(numParticles == 0) // assume default
-      numParticles = 4000;
+      numParticles = 16000; // was 4000
    else if(numParticles < 100)
       numParticles = 100;
    
@@ -1774,13 +1775,92 @@ void R_ClearParticles(void)
 }
 
 //
-// R_ProjectParticle
+// Particle projection
+//
+// Projecting a particle only reads the view and the level, so when the frame
+// is being drawn by the worker threads, the particles of each sector reached
+// during a BSP pass are queued instead, and projected in bulk on the workers
+// when the pass ends at R_PushPost. Every queued particle has its own output
+// slot, so the merge appends vissprites in the same order the serial
+// projection would have.
+//
+
+// Lighting for the particles of one sector, captured when the sector is
+// reached during BSP traversal, while its colormaps are current.
+struct ptclbatch_t
+{
+   lighttable_t  *fixedmap; // inverse colormap, if in use
+   lighttable_t  *fullmap;  // sector's full-bright colormap
+   lighttable_t **ltable;   // sector's scaled light table
+};
+
+struct ptclpending_t
+{
+   const particle_t *particle;
+   int               batch;
+};
+
+#define PTCLMINJOBS 512 // fewer queued particles than this are done serially
+#define PTCLPERJOB  256
+
+static ptclbatch_t   *ptclbatches;
+static int            numptclbatches, numptclbatchesalloc;
+static ptclpending_t *ptclpending;
+static vissprite_t   *ptclvis;
+static byte          *ptclvalid;
+static int            numptclpending, numptclpendingalloc;
+
+//
+// R_particleBatch
+//
+// Capture the lighting R_projectParticle needs for particles in a sector.
+//
+static void R_particleBatch(sector_t *sector, ptclbatch_t *batch)
+{
+   batch->fixedmap = NULL;
+   batch->fullmap  = NULL;
+   batch->ltable   = NULL;
+
+   if(fixedcolormap ==
+      fullcolormap + INVERSECOLORMAP*256*sizeof(lighttable_t))
+   {
+      batch->fixedmap = fixedcolormap;
+   } 
+   else
+   {
+      sector_t tmpsec;
+      int floorlightlevel, ceilinglightlevel, lightnum;
+
+      R_SectorColormap(sector);
+
+      batch->fullmap = fullcolormap;
+
+      R_FakeFlat(sector, &tmpsec, &floorlightlevel, 
+                 &ceilinglightlevel, false);
+
+      lightnum = (floorlightlevel + ceilinglightlevel) / 2;
+      lightnum = (lightnum >> LIGHTSEGSHIFT) + (extralight * LIGHTBRIGHT);
+         
+      if(lightnum >= LIGHTLEVELS || fixedcolormap)
+         batch->ltable = scalelight[LIGHTLEVELS - 1];      
+      else if(lightnum < 0)
+         batch->ltable = scalelight[0];
+      else
+         batch->ltable = scalelight[lightnum];
+   }
+}
+
+//
+// R_projectParticle
+//
+// Fills in vis for a particle, returning false if it cannot be seen. Safe
+// to call from the worker threads.
 //
-static void R_ProjectParticle(particle_t *particle)
+static bool R_projectParticle(const particle_t *particle, 
+                              const ptclbatch_t *batch, vissprite_t *vis)
 {
    fixed_t gzt;
    int x1, x2;
-   vissprite_t *vis;
    sector_t    *sector = NULL;
    int heightsec = -1;
    
@@ -1795,11 +1875,11 @@ static void R_ProjectParticle(particle_t *particle)
 
    // lies in front of the front view plane
    if(ty1 < 1.0f)
-      return;
+      return false;
 
    // invisible?
    if(!particle->trans)
-      return;
+      return false;
 
    tx1 = (tempx * view.cos) - (tempy * view.sin);
 
@@ -1817,7 +1897,7 @@ static void R_ProjectParticle(particle_t *particle)
    
    // off either side?
    if(x1 >= viewwindow.width || x2 < 0)
-      return;
+      return false;
 
    tz = M_FixedToFloat(particle->z) - view.z;
 
@@ -1825,7 +1905,7 @@ static void R_ProjectParticle(particle_t *particle)
    y2 = (view.ycenter - ((tz - 1.0f) * yscale));
    
    if(y2 < 0.0f || y1 >= view.height)
-      return;
+      return false;
    
    gzt = particle->z + 1;
    
@@ -1841,7 +1921,7 @@ static void R_ProjectParticle(particle_t *particle)
 
       if(particle->z < sector->floorheight || 
 	 particle->z > sector->ceilingheight)
-	 return;
+	 return false;
    }
    
    // only clip particles which are in special sectors
@@ -1853,18 +1933,17 @@ static void R_ProjectParticle(particle_t *particle)
 	 viewz < sectors[phs].floorheight ?
 	 particle->z >= sectors[heightsec].floorheight :
          gzt < sectors[heightsec].floorheight)
-         return;
+         return false;
 
       if(phs != -1 && 
 	 viewz > sectors[phs].ceilingheight ?
 	 gzt < sectors[heightsec].ceilingheight &&
 	 viewz >= sectors[heightsec].ceilingheight :
          particle->z >= sectors[heightsec].ceilingheight)
-         return;
+         return false;
    }
    
    // store information in a vissprite
-   vis = R_NewVisSprite();
    vis->heightsec = heightsec;
    vis->gx = particle->x;
    vis->gy = particle->y;
@@ -1884,45 +1963,209 @@ static void R_ProjectParticle(particle_t *particle)
    vis->scale = yscale;
    vis->sector = sector - sectors;  
    
-   if(fixedcolormap ==
-      fullcolormap + INVERSECOLORMAP*256*sizeof(lighttable_t))
-   {
-      vis->colormap = fixedcolormap;
-   } 
+   if(batch->fixedmap)
+      vis->colormap = batch->fixedmap;
+   else if(LevelInfo.useFullBright && (particle->styleflags & PS_FULLBRIGHT))
+      vis->colormap = batch->fullmap;
    else
    {
-      R_SectorColormap(sector);
+      int index = (int)(idist * 2560.0f);
+      if(index >= MAXLIGHTSCALE)
+         index = MAXLIGHTSCALE - 1;
+         
+      vis->colormap = batch->ltable[index];
+   }
+
+   return true;
+}
+
+//
+// R_projectParticleRange
+//
+// Projects queued particles first through last - 1.
+//
+static void R_projectParticleRange(int first, int last)
+{
+   for(int i = first; i < last; i++)
+   {
+      const ptclpending_t &pending = ptclpending[i];
+
+      ptclvalid[i] = R_projectParticle(pending.particle, 
+                                       &ptclbatches[pending.batch], 
+                                       &ptclvis[i]);
+   }
+}
+
+//
+// R_projectParticleJob
+//
+// Worker callback projecting one run of queued particles.
+//
+static void R_projectParticleJob(int jobnum, int threadnum, void *data)
+{
+   int first = jobnum * PTCLPERJOB;
+   int last  = first + PTCLPERJOB;
+
+   if(last > numptclpending)
+      last = numptclpending;
+
+   R_projectParticleRange(first, last);
+}
+
+//
+// R_addParticles
+//
+// Project, or queue for projection, all particles in a sector.
+//
+static void R_addParticles(sector_t *sec)
+{
+   DLListItem<particle_t> *link;
+   ptclbatch_t batch;
+
+   R_particleBatch(sec, &batch);
 
-      if(LevelInfo.useFullBright && (particle->styleflags & PS_FULLBRIGHT))
+   if(!R_DeferredDrawing())
+   {
+      for(link = sec->ptcllist; link; link = link->dllNext)
       {
-         vis->colormap = fullcolormap;
+         vissprite_t vis;
+
+         if(R_projectParticle(*link, &batch, &vis))
+            *R_NewVisSprite() = vis;
       }
-      else
-      {
-         lighttable_t **ltable;
-         sector_t tmpsec;
-         int floorlightlevel, ceilinglightlevel, lightnum, index;
+      return;
+   }
 
-         R_FakeFlat(sector, &tmpsec, &floorlightlevel, 
-                    &ceilinglightlevel, false);
+   if(numptclbatches >= numptclbatchesalloc)
+   {
+      numptclbatchesalloc = numptclbatchesalloc ? numptclbatchesalloc * 2 : 64;
+      ptclbatches = erealloc(ptclbatch_t *, ptclbatches, 
+                             numptclbatchesalloc * sizeof(ptclbatch_t));
+   }
+   ptclbatches[numptclbatches] = batch;
 
-         lightnum = (floorlightlevel + ceilinglightlevel) / 2;
-         lightnum = (lightnum >> LIGHTSEGSHIFT) + (extralight * LIGHTBRIGHT);
-         
-         if(lightnum >= LIGHTLEVELS || fixedcolormap)
-            ltable = scalelight[LIGHTLEVELS - 1];      
-         else if(lightnum < 0)
-            ltable = scalelight[0];
-         else
-            ltable = scalelight[lightnum];
-         
-         index = (int)(idist * 2560.0f);
-         if(index >= MAXLIGHTSCALE)
-            index = MAXLIGHTSCALE - 1;
-         
-         vis->colormap = ltable[index];
+   for(link = sec->ptcllist; link; link = link->dllNext)
+   {
+      if(numptclpending >= numptclpendingalloc)
+      {
+         numptclpendingalloc = numptclpendingalloc ? numptclpendingalloc * 2 : 1024;
+         ptclpending = erealloc(ptclpending_t *, ptclpending, 
+                                numptclpendingalloc * sizeof(ptclpending_t));
+         ptclvis     = erealloc(vissprite_t *, ptclvis,
+                                numptclpendingalloc * sizeof(vissprite_t));
+         ptclvalid   = erealloc(byte *, ptclvalid, numptclpendingalloc);
       }
+      ptclpending[numptclpending].particle = *link;
+      ptclpending[numptclpending].batch    = numptclbatches;
+      ++numptclpending;
    }
+
+   ++numptclbatches;
+}
+
+//
+// R_flushParticles
+//
+// Project all queued particles and append their vissprites.
+//
+static void R_flushParticles()
+{
+   if(!numptclpending)
+      return;
+
+   if(numptclpending < PTCLMINJOBS)
+      R_projectParticleRange(0, numptclpending);
+   else
+   {
+      M_RunJobs(R_projectParticleJob, NULL, 
+                (numptclpending + PTCLPERJOB - 1) / PTCLPERJOB);
+   }
+
+   for(int i = 0; i < numptclpending; i++)
+   {
+      if(ptclvalid[i])
+         *R_NewVisSprite() = ptclvis[i];
+   }
+
+   numptclpending = 0;
+   numptclbatches = 0;
+}
+
+//
+// particlerect_t
+//
+// Particle rectangle, as drawn by R_drawParticleRect. Kept separate from the
+// vissprite so that it can be queued for threaded drawing.
+//
+struct particlerect_t
+{
+   int  yl, yh;
+   byte color;
+   bool translucent;
+   unsigned int fglevel;
+};
+
+//
+// R_drawParticleRect
+//
+// Fills a particle's rectangle between columns x1 and x2.
+//
+static void R_drawParticleRect(const void *data, int x1, int x2)
+{
+   const particlerect_t *rect = static_cast<const particlerect_t *>(data);
+   int xcount, ycount, spacing;
+   byte *dest;
+
+   xcount = x2 - x1 + 1;
+   ycount = rect->yh - rect->yl + 1;
+
+   spacing = video.pitch - xcount;
+   dest = ylookup[rect->yl] + columnofs[x1];
+
+   // haleyjd 02/08/05: rewritten to remove inner loop invariants
+   if(rect->translucent)
+   {
+      unsigned int bg, fg;
+      unsigned int *fg2rgb, *bg2rgb;
+      unsigned int fglevel, bglevel;
+
+      // look up translucency information
+      fglevel = rect->fglevel;
+      bglevel = FRACUNIT - fglevel;
+      fg2rgb  = Col2RGB8[fglevel >> 10];
+      bg2rgb  = Col2RGB8[bglevel >> 10];
+      fg      = fg2rgb[rect->color]; // foreground color is invariant
+
+      do // step in y
+      {
+         int count = xcount;
+
+         do // step in x
+         {
+            bg = bg2rgb[*dest];
+            bg = (fg + bg) | 0x1f07c1f;
+            *dest++ = RGB32k[0][0][bg & (bg >> 15)];
+         } 
+         while(--count);
+         dest += spacing;  // go to next row
+      } 
+      while(--ycount);
+   }
+   else // opaque (fast, and looks terrible)
+   {
+      byte color = rect->color;
+
+      do // step in y
+      {
+         int count = xcount;
+         
+         do // step in x
+            *dest++ = color;
+         while(--count);
+         dest += spacing;  // go to next row
+      } 
+      while(--ycount);
+   } // end else [!general_translucency]
 }
 
 //
@@ -1933,8 +2176,7 @@ static void R_ProjectParticle(particle_t *particle)
 static void R_DrawParticle(vissprite_t *vis)
 {
    int x1, x2, ox1, ox2;
-   int yl, yh;
-   byte color;
+   particlerect_t rect;
 
    ox1 = x1 = vis->x1;
    ox2 = x2 = vis->x2;
@@ -1957,68 +2199,19 @@ static void R_DrawParticle(vissprite_t *vis)
    if(vis->ytop < mceilingclip[ox2])
       vis->ytop = mceilingclip[ox2];
 
-   yl = (int)vis->ytop;
-   yh = (int)vis->ybottom;
-
-   color = vis->colormap[vis->colour];
-
-   {
-      int xcount, ycount, spacing;
-      byte *dest;
+   rect.yl = (int)vis->ytop;
+   rect.yh = (int)vis->ybottom;
 
-      xcount = x2 - x1 + 1;
-      
-      ycount = yh - yl;      
-      if(ycount < 0)
-         return;
-      ++ycount;
+   if(rect.yh < rect.yl)
+      return;
 
-      spacing = video.pitch - xcount;
-      dest = ylookup[yl] + columnofs[x1];
+   rect.color       = vis->colormap[vis->colour];
+   rect.translucent = (general_translucency && particle_trans);
+   rect.fglevel     = ((unsigned int)(vis->translucency) + 1) & ~0x3ff;
 
-      // haleyjd 02/08/05: rewritten to remove inner loop invariants
-      if(general_translucency && particle_trans)
-      {
-         unsigned int bg, fg;
-         unsigned int *fg2rgb, *bg2rgb;
-         unsigned int fglevel, bglevel;
-
-         // look up translucency information
-         fglevel = ((unsigned int)(vis->translucency) + 1) & ~0x3ff;
-         bglevel = FRACUNIT - fglevel;
-         fg2rgb  = Col2RGB8[fglevel >> 10];
-         bg2rgb  = Col2RGB8[bglevel >> 10];
-         fg      = fg2rgb[color]; // foreground color is invariant
-
-         do // step in y
-         {
-            int count = xcount;
-
-            do // step in x
-            {
-               bg = bg2rgb[*dest];
-               bg = (fg + bg) | 0x1f07c1f;
-               *dest++ = RGB32k[0][0][bg & (bg >> 15)];
-            } 
-            while(--count);
-            dest += spacing;  // go to next row
-         } 
-         while(--ycount);
-      }
-      else // opaque (fast, and looks terrible)
-      {
-         do // step in y
-         {
-            int count = xcount;
-            
-            do // step in x
-               *dest++ = color;
-            while(--count);
-            dest += spacing;  // go to next row
-         } 
-         while(--ycount);
-      } // end else [!general_translucency]
-   } // end local block
+   // queue it if drawing is threaded
+   if(!R_DeferDraw(R_drawParticleRect, &rect, sizeof(rect), x1, x2))
+      R_drawParticleRect(&rect, x1, x2);
 }
 
 //----------------------------------------------------------------------------
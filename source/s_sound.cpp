@@ -1670,7 +1670,7 @@ static cell AMX_NATIVE_CALL sm_sectorsound(AMX *amx, cell *params)
 
    tag = params[2];
 
-   while((secnum = P_FindSectorFromTag(tag, secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(tag, secnum)
    {
       sector_t *sector = &sectors[secnum];
       
@@ -1696,7 +1696,7 @@ static cell AMX_NATIVE_CALL sm_sectorsoundnum(AMX *amx, cell *params)
       return -1;
    }
    
-   while((secnum = P_FindSectorFromTag(tag, secnum)) >= 0)
+   P_FOR_SECTORS_WITH_TAG(tag, secnum)
    {
       sector_t *sector = &sectors[secnum];
       
@@ -72,6 +72,7 @@ int main(int argc, char **argv)
 {
    static char env_vidwinpos[] = "SDL_VIDEO_WINDOW_POS=center";
    static char env_vidcenter[] = "SDL_VIDEO_CENTERED=1";
+   static char env_viddummy[]  = "SDL_VIDEODRIVER=dummy";
 
    myargc = argc;
    myargv = argv;
@@ -79,6 +80,11 @@ int main(int argc, char **argv)
    // Set SDL video centering
    putenv(env_vidwinpos);
    putenv(env_vidcenter);
+
+   // Benchmarks run without a display; SDL's dummy video driver needs no
+   // window system, and the game renders into its own offscreen buffer.
+   if(M_CheckParm("-benchmark") || M_CheckParm("-simbench"))
+      putenv(env_viddummy);
    
    // SoM: From CHOCODOOM Thank you fraggle!!
 #if EE_CURRENT_PLATFORM == EE_PLATFORM_WINDOWS
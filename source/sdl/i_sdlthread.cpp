@@ -0,0 +1,118 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//    SDL Thread Implementation
+//
+//-----------------------------------------------------------------------------
+
+#include "SDL.h"
+#include "SDL_thread.h"
+
+#include "../z_zone.h"
+
+// Need thread HAL
+#include "../hal/i_thread.h"
+
+#include "i_sdlthread.h"
+
+// The HAL's opaque handle types are just the SDL objects themselves.
+
+static HALThreadHandle *I_SDLCreateThread(HAL_ThreadFunc fn, void *data)
+{
+   return reinterpret_cast<HALThreadHandle *>(SDL_CreateThread(fn, data));
+}
+
+static void I_SDLWaitThread(HALThreadHandle *thread)
+{
+   SDL_WaitThread(reinterpret_cast<SDL_Thread *>(thread), NULL);
+}
+
+static HALMutex *I_SDLCreateMutex()
+{
+   return reinterpret_cast<HALMutex *>(SDL_CreateMutex());
+}
+
+static void I_SDLDestroyMutex(HALMutex *mutex)
+{
+   SDL_DestroyMutex(reinterpret_cast<SDL_mutex *>(mutex));
+}
+
+static void I_SDLLockMutex(HALMutex *mutex)
+{
+   SDL_mutexP(reinterpret_cast<SDL_mutex *>(mutex));
+}
+
+static void I_SDLUnlockMutex(HALMutex *mutex)
+{
+   SDL_mutexV(reinterpret_cast<SDL_mutex *>(mutex));
+}
+
+static HALCondition *I_SDLCreateCond()
+{
+   return reinterpret_cast<HALCondition *>(SDL_CreateCond());
+}
+
+static void I_SDLDestroyCond(HALCondition *cond)
+{
+   SDL_DestroyCond(reinterpret_cast<SDL_cond *>(cond));
+}
+
+static void I_SDLCondWait(HALCondition *cond, HALMutex *mutex)
+{
+   SDL_CondWait(reinterpret_cast<SDL_cond *>(cond), 
+                reinterpret_cast<SDL_mutex *>(mutex));
+}
+
+static void I_SDLCondSignal(HALCondition *cond)
+{
+   SDL_CondSignal(reinterpret_cast<SDL_cond *>(cond));
+}
+
+static void I_SDLCondBroadcast(HALCondition *cond)
+{
+   SDL_CondBroadcast(reinterpret_cast<SDL_cond *>(cond));
+}
+
+//
+// I_SDLInitThreads
+//
+// Install the SDL thread driver into the HAL. SDL's thread subsystem needs
+// no explicit initialization.
+//
+bool I_SDLInitThreads()
+{
+   i_halthreads.CreateThread  = I_SDLCreateThread;
+   i_halthreads.WaitThread    = I_SDLWaitThread;
+   i_halthreads.CreateMutex   = I_SDLCreateMutex;
+   i_halthreads.DestroyMutex  = I_SDLDestroyMutex;
+   i_halthreads.LockMutex     = I_SDLLockMutex;
+   i_halthreads.UnlockMutex   = I_SDLUnlockMutex;
+   i_halthreads.CreateCond    = I_SDLCreateCond;
+   i_halthreads.DestroyCond   = I_SDLDestroyCond;
+   i_halthreads.CondWait      = I_SDLCondWait;
+   i_halthreads.CondSignal    = I_SDLCondSignal;
+   i_halthreads.CondBroadcast = I_SDLCondBroadcast;
+
+   return true;
+}
+
+// EOF
+
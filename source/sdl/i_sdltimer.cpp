@@ -28,8 +28,17 @@
 #include "../z_zone.h"
 
 // Need timer HAL
+#include "../hal/i_platform.h"
 #include "../hal/i_timer.h"
 
+#if EE_CURRENT_PLATFORM == EE_PLATFORM_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <time.h>
+#endif
+
 #include "../doomdef.h"
 #include "../doomstat.h"
 #include "../m_compare.h"
@@ -84,6 +93,38 @@ static unsigned int I_SDLGetTicks()
    return SDL_GetTicks();
 }
 
+//
+// I_SDLGetNanoseconds
+//
+// Return time in nanoseconds from the highest resolution clock available;
+// SDL 1.2 only offers milliseconds, which is too coarse for profiling. The
+// actual resolution depends on the platform.
+//
+static uint64_t I_SDLGetNanoseconds()
+{
+#if EE_CURRENT_PLATFORM == EE_PLATFORM_WINDOWS
+   static LARGE_INTEGER freq;
+   LARGE_INTEGER now;
+
+   if(!freq.QuadPart)
+      QueryPerformanceFrequency(&freq);
+   QueryPerformanceCounter(&now);
+
+   return (uint64_t)(now.QuadPart / freq.QuadPart) * 1000000000 +
+          (uint64_t)(now.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+   struct timeval tv;
+
+   gettimeofday(&tv, NULL);
+   return ((uint64_t)tv.tv_sec * 1000000 + tv.tv_usec) * 1000;
+#endif
+}
+
 //
 // I_SDLSleep
 //
@@ -196,13 +237,14 @@ void I_SDLInitTimer()
    I_SDLSetMSec();
 
    // initialize constant methods
-   i_haltimer.GetRealTime  = I_SDLGetTime_RealTime;
-   i_haltimer.GetTicks     = I_SDLGetTicks;
-   i_haltimer.Sleep        = I_SDLSleep;
-   i_haltimer.StartDisplay = I_SDLStartDisplay;
-   i_haltimer.EndDisplay   = I_SDLEndDisplay;
-   i_haltimer.GetFrac      = I_SDLGetTimeFrac;
-   i_haltimer.SaveMS       = I_SDLSaveMS;
+   i_haltimer.GetRealTime     = I_SDLGetTime_RealTime;
+   i_haltimer.GetTicks        = I_SDLGetTicks;
+   i_haltimer.GetNanoseconds  = I_SDLGetNanoseconds;
+   i_haltimer.Sleep           = I_SDLSleep;
+   i_haltimer.StartDisplay    = I_SDLStartDisplay;
+   i_haltimer.EndDisplay      = I_SDLEndDisplay;
+   i_haltimer.GetFrac         = I_SDLGetTimeFrac;
+   i_haltimer.SaveMS          = I_SDLSaveMS;
 }
 
 //
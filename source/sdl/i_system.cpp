@@ -33,6 +33,7 @@
 
 // HAL modules
 #include "../hal/i_gamepads.h"
+#include "../hal/i_thread.h"
 #include "../hal/i_timer.h"
 
 #include "../z_zone.h"
@@ -110,6 +111,9 @@ void I_Init()
    // haleyjd 01/10/14: initialize timer
    I_InitHALTimer();
 
+   // initialize threads
+   I_InitHALThreads();
+
    // haleyjd 04/15/02: initialize joystick
    I_InitGamePads();
  
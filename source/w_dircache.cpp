@@ -0,0 +1,326 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Persistent cache of archive directories.
+//
+//      Parsing the central directory of a large zip file means thousands of
+//      small reads, and it is done again on every launch for every
+//      autoloaded file. The parsed form of each directory is kept in
+//      dircache.bin in the user directory as an opaque record, keyed on the
+//      file's path, size and modification time, and the whole cache is
+//      loaded with a single read. A record is only trusted if all three
+//      still match.
+//
+//-----------------------------------------------------------------------------
+
+#include "z_zone.h"
+
+#include "doomstat.h"
+#include "m_argv.h"
+#include "m_buffer.h"
+#include "m_collection.h"
+#include "m_misc.h"
+#include "w_dircache.h"
+
+#define DIRCACHE_FILENAME "dircache.bin"
+#define DIRCACHE_MAGIC    "EEDC"
+#define DIRCACHE_VERSION  1
+
+struct dircacheentry_t
+{
+   char     *path;    // file path as given to the wad directory
+   uint32_t  sizelo;  // file size
+   uint32_t  sizehi;
+   uint32_t  timelo;  // file modification time
+   uint32_t  timehi;
+   byte     *data;    // cached directory record
+   uint32_t  datalen;
+   bool      live;    // file still exists; set when saving
+};
+
+static PODCollection<dircacheentry_t> dircache;
+static bool dircacheloaded;
+static bool dircachedirty;
+
+//
+// W_dirCacheDisabled
+//
+// -nodircache ignores and doesn't write the cache.
+//
+static bool W_dirCacheDisabled()
+{
+   return !userpath || M_CheckParm("-nodircache");
+}
+
+//
+// W_dirCacheKey
+//
+// Get the size and modification time that identify a file's contents.
+//
+static bool W_dirCacheKey(const char *filename, dircacheentry_t &key)
+{
+   struct stat sbuf;
+
+   if(stat(filename, &sbuf))
+      return false;
+
+   uint64_t size  = static_cast<uint64_t>(sbuf.st_size);
+   uint64_t mtime = static_cast<uint64_t>(sbuf.st_mtime);
+
+   key.sizelo = static_cast<uint32_t>(size);
+   key.sizehi = static_cast<uint32_t>(size >> 32);
+   key.timelo = static_cast<uint32_t>(mtime);
+   key.timehi = static_cast<uint32_t>(mtime >> 32);
+
+   return true;
+}
+
+//
+// W_dirCacheRead32
+//
+static bool W_dirCacheRead32(const byte *&rover, const byte *end, uint32_t &val)
+{
+   if(end - rover < 4)
+      return false;
+
+   val = rover[0] | (rover[1] << 8) | (rover[2] << 16) | 
+         (static_cast<uint32_t>(rover[3]) << 24);
+   rover += 4;
+
+   return true;
+}
+
+//
+// W_dirCacheLoad
+//
+// Load the cache file, if there is a valid one. Any malformed content 
+// discards the remainder of the file.
+//
+static void W_dirCacheLoad()
+{
+   byte *buffer = NULL;
+   int   len;
+   char *filename;
+
+   dircacheloaded = true;
+
+   if(W_dirCacheDisabled())
+      return;
+
+   filename = M_SafeFilePath(userpath, DIRCACHE_FILENAME);
+   len      = M_ReadFile(filename, &buffer);
+
+   if(len < 12 || memcmp(buffer, DIRCACHE_MAGIC, 4))
+   {
+      efree(buffer);
+      return;
+   }
+
+   const byte *rover = buffer + 4;
+   const byte *end   = buffer + len;
+   uint32_t version, numentries;
+
+   W_dirCacheRead32(rover, end, version);
+   W_dirCacheRead32(rover, end, numentries);
+
+   if(version != DIRCACHE_VERSION)
+   {
+      efree(buffer);
+      return;
+   }
+
+   for(uint32_t i = 0; i < numentries; i++)
+   {
+      dircacheentry_t entry;
+      uint32_t pathlen;
+
+      if(!W_dirCacheRead32(rover, end, pathlen) ||
+         static_cast<uint32_t>(end - rover) < pathlen)
+         break;
+
+      entry.path = ecalloc(char *, 1, pathlen + 1);
+      memcpy(entry.path, rover, pathlen);
+      rover += pathlen;
+
+      if(!W_dirCacheRead32(rover, end, entry.sizelo) ||
+         !W_dirCacheRead32(rover, end, entry.sizehi) ||
+         !W_dirCacheRead32(rover, end, entry.timelo) ||
+         !W_dirCacheRead32(rover, end, entry.timehi) ||
+         !W_dirCacheRead32(rover, end, entry.datalen) ||
+         static_cast<uint32_t>(end - rover) < entry.datalen)
+      {
+         efree(entry.path);
+         break;
+      }
+
+      entry.data = emalloc(byte *, entry.datalen ? entry.datalen : 1);
+      memcpy(entry.data, rover, entry.datalen);
+      rover += entry.datalen;
+
+      dircache.add(entry);
+   }
+
+   efree(buffer);
+}
+
+//
+// W_dirCacheFindEntry
+//
+static dircacheentry_t *W_dirCacheFindEntry(const char *filename)
+{
+   if(!dircacheloaded)
+      W_dirCacheLoad();
+
+   for(size_t i = 0; i < dircache.getLength(); i++)
+   {
+      if(!strcmp(dircache[i].path, filename))
+         return &dircache[i];
+   }
+
+   return NULL;
+}
+
+//
+// W_DirCacheFind
+//
+// Returns the directory record stored for a file, if the file has not
+// changed since. The data remains valid until the next store.
+//
+const byte *W_DirCacheFind(const char *filename, size_t &size)
+{
+   dircacheentry_t *entry;
+   dircacheentry_t  key;
+
+   if(!filename || W_dirCacheDisabled())
+      return NULL;
+
+   if(!(entry = W_dirCacheFindEntry(filename)) || 
+      !W_dirCacheKey(filename, key))
+      return NULL;
+
+   if(entry->sizelo != key.sizelo || entry->sizehi != key.sizehi ||
+      entry->timelo != key.timelo || entry->timehi != key.timehi)
+      return NULL;
+
+   size = entry->datalen;
+   return entry->data;
+}
+
+//
+// W_DirCacheStore
+//
+// Remember a file's directory record. It is written out by W_DirCacheSave.
+//
+void W_DirCacheStore(const char *filename, const void *data, size_t size)
+{
+   dircacheentry_t *entry;
+   dircacheentry_t  key;
+
+   if(!filename || W_dirCacheDisabled() || !W_dirCacheKey(filename, key))
+      return;
+
+   if(!(entry = W_dirCacheFindEntry(filename)))
+   {
+      key.path = estrdup(filename);
+      key.data = NULL;
+      dircache.add(key);
+      entry = &dircache[dircache.getLength() - 1];
+   }
+   else
+   {
+      entry->sizelo = key.sizelo;
+      entry->sizehi = key.sizehi;
+      entry->timelo = key.timelo;
+      entry->timehi = key.timehi;
+   }
+
+   efree(entry->data);
+   entry->data    = emalloc(byte *, size ? size : 1);
+   entry->datalen = static_cast<uint32_t>(size);
+   memcpy(entry->data, data, size);
+
+   dircachedirty = true;
+}
+
+//
+// W_DirCacheSave
+//
+// Write the cache out if anything was stored since it was last saved. 
+// Records for files that no longer exist are dropped.
+//
+void W_DirCacheSave()
+{
+   OutBuffer outfile;
+   char     *filename;
+   uint32_t  numlive = 0;
+
+   if(!dircachedirty || W_dirCacheDisabled())
+      return;
+
+   dircachedirty = false;
+
+   for(size_t i = 0; i < dircache.getLength(); i++)
+   {
+      struct stat sbuf;
+
+      dircache[i].live = !stat(dircache[i].path, &sbuf);
+      if(dircache[i].live)
+         ++numlive;
+   }
+
+   filename = M_SafeFilePath(userpath, DIRCACHE_FILENAME);
+
+   if(outfile.CreateFile(filename, 64*1024, BufferedFileBase::LENDIAN))
+   {
+      bool ok = outfile.Write(DIRCACHE_MAGIC, 4) &&
+                outfile.WriteUint32(DIRCACHE_VERSION) &&
+                outfile.WriteUint32(numlive);
+
+      for(size_t i = 0; ok && i < dircache.getLength(); i++)
+      {
+         dircacheentry_t &entry = dircache[i];
+         uint32_t pathlen = static_cast<uint32_t>(strlen(entry.path));
+
+         if(!entry.live)
+            continue;
+
+         ok = outfile.WriteUint32(pathlen) &&
+              outfile.Write(entry.path, pathlen) &&
+              outfile.WriteUint32(entry.sizelo) &&
+              outfile.WriteUint32(entry.sizehi) &&
+              outfile.WriteUint32(entry.timelo) &&
+              outfile.WriteUint32(entry.timehi) &&
+              outfile.WriteUint32(entry.datalen) &&
+              outfile.Write(entry.data, entry.datalen);
+      }
+
+      if(ok)
+         ok = outfile.Flush();
+      outfile.Close();
+
+      // don't leave a partial cache behind
+      if(!ok)
+         remove(filename);
+   }
+}
+
+// EOF
+
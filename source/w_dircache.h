@@ -0,0 +1,40 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 2014 James Haley et al.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//      Persistent cache of archive directories, so that unchanged resource
+//      files need not have their directories parsed again at startup.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef W_DIRCACHE_H__
+#define W_DIRCACHE_H__
+
+// Required for: byte
+#include "doomtype.h"
+
+const byte *W_DirCacheFind(const char *filename, size_t &size);
+void        W_DirCacheStore(const char *filename, const void *data, size_t size);
+void        W_DirCacheSave();
+
+#endif
+
+// EOF
+
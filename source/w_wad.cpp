@@ -34,11 +34,14 @@
 #include <memory>
 
 #include "z_zone.h"
+#include "hal/i_mmap.h"
 #include "i_system.h"
 #include "doomstat.h"
 #include "d_io.h"  // SoM 3/12/2002: moved unistd stuff into d_io.h
+#include "hal/i_timer.h"
 
 #include "c_io.h"
+#include "c_runcmd.h"
 #include "d_dehtbl.h"
 #include "d_files.h"
 #include "m_argv.h"
@@ -48,9 +51,11 @@
 #include "m_misc.h"
 #include "m_qstr.h"
 #include "m_swap.h"
+#include "p_setup.h"
 #include "p_skin.h"
 #include "s_sound.h"
 #include "v_misc.h"
+#include "w_dircache.h"
 #include "w_formats.h"
 #include "w_hacks.h"
 #include "w_wad.h"
@@ -73,36 +78,56 @@ int WadDirectory::ResWADSource = -1; // haleyjd: track handle of first wad added
 // different types
 //
 
+// readHeader reads just the first size bytes of a lump; it is NULL for
+// types that must load the whole lump to get at any of it.
+
 struct lumptype_t
 {
    size_t (*readLump)(lumpinfo_t *, void *);
+   size_t (*readHeader)(lumpinfo_t *, void *, size_t);
 };
 
 static size_t W_DirectReadLump(lumpinfo_t *, void *);
 static size_t W_MemoryReadLump(lumpinfo_t *, void *);
 static size_t W_FileReadLump  (lumpinfo_t *, void *);
 static size_t W_ZipReadLump   (lumpinfo_t *, void *);
+static size_t W_MmapReadLump  (lumpinfo_t *, void *);
+
+static size_t W_DirectReadHeader(lumpinfo_t *, void *, size_t);
+static size_t W_MemoryReadHeader(lumpinfo_t *, void *, size_t);
+static size_t W_FileReadHeader  (lumpinfo_t *, void *, size_t);
+static size_t W_MmapReadHeader  (lumpinfo_t *, void *, size_t);
 
 static lumptype_t LumpHandlers[lumpinfo_t::lump_numtypes] =
 {
    // direct lump
    {
       W_DirectReadLump,
+      W_DirectReadHeader,
    },
 
    // memory lump
    {
       W_MemoryReadLump,
+      W_MemoryReadHeader,
    },
 
    // directory file lump
    {
       W_FileReadLump,
+      W_FileReadHeader,
    },
 
    // zip file lump
    {
       W_ZipReadLump,
+      NULL,
+   },
+
+   // memory-mapped wad lump
+   {
+      W_MmapReadLump,
+      W_MmapReadHeader,
    },
 };
 
@@ -142,11 +167,29 @@ public:
    }
 
    PODCollection<lumpinfo_t *>  infoptrs; // lumpinfo_t allocations
+   PODCollection<filemapping_t> mappings; // memory-mapped wad files
    DLListItem<ZipFile>         *zipFiles; // zip files attached to this waddir
 
+   // open-addressed short name lookup table
+   struct nameslot_t
+   {
+      uint64_t name;  // packed uppercase name; 0 if slot is empty
+      int      ns;    // namespace
+      int      lump;  // last lump with this name in this namespace
+   };
+   nameslot_t  *nameTable;
+   unsigned int nameTableMask;
+
    WadDirectoryPimpl()
-      : ZoneObject(), infoptrs(), zipFiles(NULL)
+      : ZoneObject(), infoptrs(), mappings(), zipFiles(NULL), nameTable(NULL),
+        nameTableMask(0)
+   {
+   }
+
+   ~WadDirectoryPimpl()
    {
+      if(nameTable)
+         efree(nameTable);
    }
 };
 
@@ -421,6 +464,7 @@ bool WadDirectory::addWadFile(openwad_t &openData, wfileadd_t &addInfo,
    size_t       length;
    long         info_offset;
    lumpinfo_t  *lump_p;
+   filemapping_t mapping;
 
    // check for in-memory wads
    if(addInfo.flags & WFA_INMEMORY)
@@ -522,6 +566,18 @@ bool WadDirectory::addWadFile(openwad_t &openData, wfileadd_t &addInfo,
          IWADSource = source;
    }
 
+   // map the whole wad file into memory if possible, so that its lumps can
+   // be read without going through stdio. -nommap turns this off. Subfiles
+   // share their container's handle and aren't mapped.
+   if((addInfo.flags & WFA_SUBFILE) || M_CheckParm("-nommap") ||
+      !I_MapFile(openData.handle, 
+                 static_cast<size_t>(M_FileLength(openData.handle)), mapping))
+   {
+      mapping.data = NULL;
+   }
+   else
+      pImpl->mappings.add(mapping);
+
    // Add lumpinfo_t's for all lumps in the wad file
    lump_p = reAllocLumpInfo(header.numlumps, startlump);
 
@@ -539,6 +595,19 @@ bool WadDirectory::addWadFile(openwad_t &openData, wfileadd_t &addInfo,
       // for subfiles, add baseoffset to the lump offset
       if(addInfo.flags & WFA_SUBFILE)
          lump_p->direct.position += static_cast<size_t>(baseoffset);
+
+      // lumps that lie entirely within the mapping are read from it; any 
+      // others stay direct, so a truncated wad still fails the same way
+      if(mapping.data && lump_p->direct.position <= mapping.length &&
+         lump_p->size <= mapping.length - lump_p->direct.position)
+      {
+         size_t position = lump_p->direct.position;
+
+         lump_p->type          = lumpinfo_t::lump_mmap;
+         lump_p->mmap.file     = openData.handle;
+         lump_p->mmap.position = position;
+         lump_p->mmap.data     = static_cast<const byte *>(mapping.data);
+      }
       
       lump_p->li_namespace = addInfo.li_namespace;     // killough 4/17/98
 
@@ -566,7 +635,7 @@ bool WadDirectory::addZipFile(openwad_t &openData, wfileadd_t &addInfo,
    lumpinfo_t *lump_p;
 
    // Read in the ZIP file's header and directory information
-   if(!zip->readFromFile(openData.handle))
+   if(!zip->readFromFile(openData.handle, openData.filename))
    {
       handleOpenError(openData, addInfo, openData.filename);
       return false;
@@ -1034,6 +1103,44 @@ unsigned int WadDirectory::LumpNameHash(const char *s)
   return hash;
 }
 
+//
+// W_packLumpName
+//
+// Pack up to 8 characters of a lump name, uppercased, into a 64-bit integer,
+// stopping at the first NUL. Two names compare equal under
+// strncasecmp(a, b, 8) exactly when their packed forms are equal.
+//
+static uint64_t W_packLumpName(const char *s)
+{
+   uint64_t packed = 0;
+
+   for(int i = 0; i < 8 && s[i]; i++)
+   {
+      uint64_t c = ectype::toUpper(static_cast<unsigned char>(s[i]));
+      packed |= c << (i * 8);
+   }
+
+   return packed;
+}
+
+//
+// W_nameSlotHash
+//
+// Mix a packed name and namespace into a lookup table index.
+//
+static inline unsigned int W_nameSlotHash(uint64_t name, int ns)
+{
+   uint64_t h = (name ^ (static_cast<uint64_t>(ns) << 59)) * 
+                UINT64_C(0x9E3779B97F4A7C15);
+   
+   return static_cast<unsigned int>(h >> 32);
+}
+
+// Lump name lookup statistics, for w_lookupstats
+static uint64_t lumplookups, lumpprobes;
+static uint64_t levellookups, levelprobes;
+static unsigned int levellookupstart, levellookuptime;
+
 //
 // W_CheckNumForName
 // Returns -1 if name not found.
@@ -1054,26 +1161,33 @@ unsigned int WadDirectory::LumpNameHash(const char *s)
 //
 // haleyjd 03/01/09: added InDir version.
 //
+// Now looks names up in an open-addressed table keyed on the packed name
+// and namespace, so that each probe is one 64-bit compare and the table
+// holds only the last lump of each name. The name hash chains are still
+// kept for code that walks all lumps of a given name.
+//
 int WadDirectory::checkNumForName(const char *name, int li_namespace)
 {
-   // Hash function maps the name to one of possibly numlump chains.
-   // It has been tuned so that the average chain length never exceeds 2.
-   
-   unsigned int hashkey = LumpNameHash(name) % (unsigned int)numlumps;
-   register int i = lumpinfo[hashkey]->namehash.index;
+   const WadDirectoryPimpl::nameslot_t *table = pImpl->nameTable;
+   const unsigned int mask = pImpl->nameTableMask;
+   uint64_t packed;
 
-   // We search along the chain until end, looking for case-insensitive
-   // matches which also match a namespace tag. Separate hash tables are
-   // not used for each namespace, because the performance benefit is not
-   // worth the overhead, considering namespace collisions are rare in
-   // Doom wads.
+   ++lumplookups;
 
-   while(i >= 0 && (strncasecmp(lumpinfo[i]->name, name, 8) ||
-         lumpinfo[i]->li_namespace != li_namespace))
-      i = lumpinfo[i]->namehash.next;
+   if(!table || !(packed = W_packLumpName(name)))
+      return -1;
 
-   // Return the matching lump, or -1 if none found.   
-   return i;
+   for(unsigned int i = W_nameSlotHash(packed, li_namespace); ; i++)
+   {
+      const WadDirectoryPimpl::nameslot_t &slot = table[i & mask];
+
+      ++lumpprobes;
+
+      if(slot.name == packed && slot.ns == li_namespace)
+         return slot.lump;
+      if(!slot.name)
+         return -1;
+   }
 }
 
 //
@@ -1257,6 +1371,96 @@ void WadDirectory::initLumpHash()
       lumpinfo[i]->lfnhash.next = lumpinfo[j]->lfnhash.index;
       lumpinfo[j]->lfnhash.index = i;
    }
+
+   initNameTable();
+}
+
+//
+// WadDirectory::initNameTable
+//
+// Build the open-addressed table used by checkNumForName. It is sized to a
+// power of two at least twice the number of lumps, and inserting in lump
+// order lets later lumps replace earlier ones of the same name and
+// namespace, observing pwad ordering rules.
+//
+void WadDirectory::initNameTable()
+{
+   WadDirectoryPimpl::nameslot_t *table;
+   unsigned int size = 16;
+
+   while(size < 2u * static_cast<unsigned int>(numlumps))
+      size <<= 1;
+
+   if(pImpl->nameTable)
+      efree(pImpl->nameTable);
+
+   table = ecalloc(WadDirectoryPimpl::nameslot_t *, size, 
+                   sizeof(WadDirectoryPimpl::nameslot_t));
+
+   pImpl->nameTable     = table;
+   pImpl->nameTableMask = size - 1;
+
+   for(int i = 0; i < numlumps; i++)
+   {
+      uint64_t packed;
+      int      ns = lumpinfo[i]->li_namespace;
+
+      if(!(packed = W_packLumpName(lumpinfo[i]->name)))
+         continue;
+
+      for(unsigned int j = W_nameSlotHash(packed, ns); ; j++)
+      {
+         WadDirectoryPimpl::nameslot_t &slot = table[j & pImpl->nameTableMask];
+
+         if(!slot.name || (slot.name == packed && slot.ns == ns))
+         {
+            slot.name = packed;
+            slot.ns   = ns;
+            slot.lump = i;
+            break;
+         }
+      }
+   }
+}
+
+//
+// W_BeginLookupStats
+//
+// Start counting lump name lookups for a level load.
+//
+void W_BeginLookupStats()
+{
+   levellookups     = lumplookups;
+   levelprobes      = lumpprobes;
+   levellookupstart = i_haltimer.GetTicks();
+}
+
+//
+// W_EndLookupStats
+//
+// Finish counting lookups for a level load; see w_lookupstats.
+//
+void W_EndLookupStats()
+{
+   levellookups    = lumplookups - levellookups;
+   levelprobes     = lumpprobes  - levelprobes;
+   levellookuptime = i_haltimer.GetTicks() - levellookupstart;
+}
+
+//
+// w_lookupstats
+//
+// Print lump name lookup counts for the last level load and the session.
+//
+CONSOLE_COMMAND(w_lookupstats, 0)
+{
+   C_Printf("Last level load: %lu lookups, %.2f probes/lookup, %u ms\n",
+            static_cast<unsigned long>(levellookups),
+            levellookups ? double(levelprobes) / double(levellookups) : 0.0,
+            levellookuptime);
+   C_Printf("Session: %lu lookups, %.2f probes/lookup\n",
+            static_cast<unsigned long>(lumplookups),
+            lumplookups ? double(lumpprobes) / double(lumplookups) : 0.0);
 }
 
 // End of lump hashing -- killough 1/31/98
@@ -1323,6 +1527,9 @@ void WadDirectory::initMultipleFiles(wfileadd_t *files)
    
    if(!numlumps)
       I_Error("WadDirectory::InitMultipleFiles: no files found\n");
+
+   // save any newly parsed archive directories
+   W_DirCacheSave();
    
    initResources();
 }
@@ -1341,6 +1548,7 @@ bool WadDirectory::addNewFile(const char *filename)
    if(!addFile(newfile))
       return false;
 
+   W_DirCacheSave();
    initResources();         // reinit lump lookups etc
    return true;
 }
@@ -1359,6 +1567,8 @@ bool WadDirectory::addNewPrivateFile(const char *filename)
    if(!addFile(newfile))
       return false;
 
+   W_DirCacheSave();
+
    // there is no resource coalescence on this particular brand of private
    // wad file, so just call W_InitLumpHash.
    initLumpHash();
@@ -1447,6 +1657,18 @@ int WadDirectory::readLumpHeader(int lump, void *dest, size_t size)
    if(l->size < size || l->size == 0)
       return 0;
 
+   // only read the bytes asked for, unless the lump is already cached or
+   // its type can't be read partially
+   if(!l->cache[lumpinfo_t::fmt_default] && LumpHandlers[l->type].readHeader)
+   {
+      if(LumpHandlers[l->type].readHeader(l, dest, size) < size)
+      {
+         I_Error("WadDirectory::readLumpHeader: failed reading lump %d\n",
+                 lump);
+      }
+      return size;
+   }
+
    data = cacheLumpNum(lump, PU_CACHE);
 
    memcpy(dest, data, size);
@@ -1454,6 +1676,56 @@ int WadDirectory::readLumpHeader(int lump, void *dest, size_t size)
    return size;
 }
 
+//
+// WadDirectory::prefetchLumps
+//
+// Hint that the given lumps will be needed soon. Lumps in zip files that
+// are not already cached are inflated ahead of time, in parallel, so that
+// their first use doesn't stall. Other lump types are cheap enough to read
+// on demand and are ignored.
+//
+void WadDirectory::prefetchLumps(const int *lumpnums, int count)
+{
+   PODCollection<ZipLump *> zipLumps;
+
+   for(int i = 0; i < count; i++)
+   {
+      int lump = lumpnums[i];
+
+      if(lump < 0 || lump >= numlumps)
+         continue;
+
+      lumpinfo_t *l = lumpinfo[lump];
+
+      if(l->type == lumpinfo_t::lump_zip && !l->cache[lumpinfo_t::fmt_default])
+         zipLumps.add(l->zip.zipLump);
+   }
+
+   if(!zipLumps.isEmpty())
+      ZIP_PrefetchLumps(&zipLumps[0], static_cast<int>(zipLumps.getLength()));
+}
+
+//
+// WadDirectory::lumpView
+//
+// Returns a read-only pointer to the lump's raw data without reading or
+// caching it, if the lump lives in a memory-mapped wad file. Returns NULL
+// otherwise, in which case the caller should read or cache the lump as
+// usual. The view remains valid until the directory is closed.
+//
+const void *WadDirectory::lumpView(int lump)
+{
+   if(lump < 0 || lump >= numlumps)
+      I_Error("WadDirectory::lumpView: %d >= numlumps\n", lump);
+
+   lumpinfo_t *l = lumpinfo[lump];
+
+   if(l->type != lumpinfo_t::lump_mmap)
+      return NULL;
+
+   return l->mmap.data + l->mmap.position;
+}
+
 int W_ReadLumpHeader(int lump, void *dest, size_t size)
 {
    return wGlobalDir.readLumpHeader(lump, dest, size);
@@ -1546,6 +1818,11 @@ bool WadDirectory::writeLump(const char *lumpname, const char *destpath)
    if((lumpnum = checkNumForName(lumpname)) >= 0 && 
       (size    = lumpinfo[lumpnum]->size  ) >  0)
    {
+      const void *view;
+
+      if((view = lumpView(lumpnum)))
+         return M_WriteFile(destpath, const_cast<void *>(view), size);
+
       ZAutoBuffer lumpData(size, false);
       readLump(lumpnum, lumpData.get());
       return M_WriteFile(destpath, lumpData.get(), size);
@@ -1564,8 +1841,11 @@ bool WadDirectory::writeLump(const char *lumpname, const char *destpath)
 //
 uint32_t W_LumpCheckSum(int lumpnum)
 {
-   uint8_t  *lump    = (uint8_t *)(wGlobalDir.cacheLumpNum(lumpnum, PU_CACHE));
-   uint32_t  lumplen = (uint32_t )(wGlobalDir.lumpLength(lumpnum));
+   const uint8_t *lump;
+   uint32_t       lumplen = (uint32_t)(wGlobalDir.lumpLength(lumpnum));
+
+   if(!(lump = (const uint8_t *)(wGlobalDir.lumpView(lumpnum))))
+      lump = (const uint8_t *)(wGlobalDir.cacheLumpNum(lumpnum, PU_CACHE));
 
    return HashData(HashData::CRC32, lump, lumplen).getDigestPart(0);
 }
@@ -1632,12 +1912,23 @@ void WadDirectory::close()
    // close the wad file if it is open; public directories can't be closed
    if(lumpinfo && !ispublic)
    {
+      // a level prefetch may be reading from this directory
+      P_CancelLevelPrefetch();
+
       // free all resources loaded from the wad
       freeDirectoryLumps();
 
+      // unmap any memory-mapped wad files before closing them
+      for(size_t i = 0; i < pImpl->mappings.getLength(); i++)
+         I_UnmapFile(pImpl->mappings[i]);
+      pImpl->mappings.clear();
+
       if(lumpinfo[0]->type == lumpinfo_t::lump_direct &&
          lumpinfo[0]->direct.file)
          fclose(lumpinfo[0]->direct.file);
+      else if(lumpinfo[0]->type == lumpinfo_t::lump_mmap &&
+              lumpinfo[0]->mmap.file)
+         fclose(lumpinfo[0]->mmap.file);
 
       // free all lumpinfo_t's allocated for the wad
       freeDirectoryAllocs();
@@ -1646,6 +1937,11 @@ void WadDirectory::close()
       Z_Free(lumpinfo);
 
       lumpinfo = NULL;
+
+      // free the name lookup table
+      efree(pImpl->nameTable);
+      pImpl->nameTable     = NULL;
+      pImpl->nameTableMask = 0;
    }
 }
 
@@ -1675,6 +1971,19 @@ static size_t W_DirectReadLump(lumpinfo_t *l, void *dest)
    return ret;
 }
 
+static size_t W_DirectReadHeader(lumpinfo_t *l, void *dest, size_t size)
+{
+   size_t ret;
+   directlump_t &direct = l->direct;
+
+   I_BeginRead();
+   fseek(direct.file, direct.position, SEEK_SET);
+   ret = fread(dest, 1, size, direct.file);
+   I_EndRead();
+
+   return ret;
+}
+
 //
 // Memory lumps -- lumps that are held in a static memory buffer
 //
@@ -1690,6 +1999,15 @@ static size_t W_MemoryReadLump(lumpinfo_t *l, void *dest)
    return size;
 }
 
+static size_t W_MemoryReadHeader(lumpinfo_t *l, void *dest, size_t size)
+{
+   memorylump_t &memory = l->memory;
+
+   memcpy(dest, (byte *)(memory.data) + memory.position, size);
+
+   return size;
+}
+
 //
 // Directory file lumps -- lumps that are physical files on disk that are
 // not kept open except when being read.
@@ -1713,6 +2031,23 @@ static size_t W_FileReadLump(lumpinfo_t *l, void *dest)
    return sizeread;
 }
 
+static size_t W_FileReadHeader(lumpinfo_t *l, void *dest, size_t size)
+{
+   FILE *f;
+   size_t sizeread = 0;
+
+   if((f = fopen(l->lfn, "rb")))
+   {
+      I_BeginRead();
+      sizeread = fread(dest, 1, size, f);
+      I_EndRead();
+
+      fclose(f);
+   }
+   
+   return sizeread;
+}
+
 //
 // ZIP lumps -- files embedded inside a ZIP archive. The ZipFile
 // and ZipLump classes take care of all the specifics.
@@ -1727,6 +2062,33 @@ static size_t W_ZipReadLump(lumpinfo_t *l, void *dest)
    return l->size;
 }
 
+//
+// Mapped lumps -- wad lumps read through a read-only memory mapping of the
+// wad file, which saves the seek and read calls and stdio's intermediate 
+// buffer. Only lumps that lie entirely within the mapping get this type.
+//
+
+static size_t W_MmapReadLump(lumpinfo_t *l, void *dest)
+{
+   size_t size = l->size;
+   mmaplump_t &mmap = l->mmap;
+
+   I_BeginRead();
+   memcpy(dest, mmap.data + mmap.position, size);
+   I_EndRead();
+
+   return size;
+}
+
+static size_t W_MmapReadHeader(lumpinfo_t *l, void *dest, size_t size)
+{
+   mmaplump_t &mmap = l->mmap;
+
+   memcpy(dest, mmap.data + mmap.position, size);
+
+   return size;
+}
+
 //----------------------------------------------------------------------------
 //
 // $Log: w_wad.c,v $
@@ -26,6 +26,7 @@
 #ifndef W_WAD_H__
 #define W_WAD_H__
 
+#include "doomtype.h"
 #include "z_zone.h"
 
 class  ZAutoBuffer;
@@ -64,6 +65,14 @@ struct memorylump_t
    size_t position;  // for direct and memory lumps, offset into file/buffer
 };
 
+// A mapped lump is read straight out of a memory-mapped wad file.
+struct mmaplump_t
+{
+   FILE *file;       // file the mapping was made from
+   size_t position;  // offset into file/mapping
+   const byte *data; // start of the mapped file
+};
+
 // A ZIP lump is managed by a ZipFile instance.
 struct ziplump_t
 {
@@ -129,6 +138,7 @@ struct lumpinfo_t
       lump_memory,  // lump is a memory buffer
       lump_file,    // lump is a directory file; must be opened to use
       lump_zip,     // lump is inside a zip file
+      lump_mmap,    // lump is in a memory-mapped wad file
       lump_numtypes
    }; 
    int type;
@@ -140,6 +150,7 @@ struct lumpinfo_t
    {
       directlump_t direct;
       memorylump_t memory;
+      mmaplump_t   mmap;
       ziplump_t    zip;
    };
 
@@ -273,6 +284,7 @@ protected:
 
    // Protected methods
    void initLumpHash();
+   void initNameTable();
    void initLFNHash();
    void initResources();
    void addInfoPtr(lumpinfo_t *infoptr);
@@ -314,6 +326,8 @@ public:
    int   lumpLength(int lump);
    void  readLump(int lump, void *dest, WadLumpLoader *lfmt = NULL);
    int   readLumpHeader(int lump, void *dest, size_t size);
+   const void *lumpView(int lump);
+   void  prefetchLumps(const int *lumpnums, int count);
    void *cacheLumpNum(int lump, int tag, WadLumpLoader *lfmt = NULL);
    void *cacheLumpName(const char *name, int tag, WadLumpLoader *lfmt = NULL);
    void  cacheLumpAuto(int lumpnum, ZAutoBuffer &buffer);
@@ -349,6 +363,9 @@ int         W_LumpLength(int lump);
 uint32_t    W_LumpCheckSum(int lumpnum);
 int         W_ReadLumpHeader(int lump, void *dest, size_t size);
 
+void        W_BeginLookupStats();
+void        W_EndLookupStats();
+
 void I_BeginRead(void), I_EndRead(void); // killough 10/98
 
 #endif
@@ -29,11 +29,15 @@
 #include "z_auto.h"
 
 #include "i_system.h"
+#include "m_argv.h"
 #include "m_buffer.h"
+#include "m_collection.h"
 #include "m_compare.h"
 #include "m_qstr.h"
 #include "m_structio.h"
 #include "m_swap.h"
+#include "m_workers.h"
+#include "w_dircache.h"
 #include "w_wad.h"
 #include "w_zip.h"
 
@@ -258,11 +262,16 @@ static bool ZIP_FindEndOfCentralDir(InBuffer &fin, long &position)
 //
 // Destructor
 //
+static void ZIP_PurgeCache(ZipLump *lumps, int numlumps);
+
 ZipFile::~ZipFile()
 {
    // free the directory
    if(lumps && numLumps)
    {
+      // free any inflated data cached for the lumps
+      ZIP_PurgeCache(lumps, numLumps);
+
       // free lump names
       for(int i = 0; i < numLumps; i++)
       {
@@ -325,13 +334,28 @@ bool ZipFile::readEndOfCentralDir(InBuffer &fin, ZIPEndOfCentralDir &zcd)
       zcd.diskNum != 0 || zcd.centralDirDiskNo != 0)
       return false;
 
-   // Allocate directory
-   numLumps = zcd.numEntriesTotal;
-   lumps    = ecalloc(ZipLump *, numLumps + 1, sizeof(ZipLump));
-
    return true;
 }
 
+//
+// ZIP_EndOfCentralDirCRC
+//
+// Checksum of the end-of-central-directory fields. The directory cache keys
+// archives by size and modification time only; this catches an archive that
+// was rewritten within the same second without changing size.
+//
+static uint32_t ZIP_EndOfCentralDirCRC(const ZIPEndOfCentralDir &zcd)
+{
+   uLong crc = crc32(0L, Z_NULL, 0);
+
+   crc = crc32(crc, (const Bytef *)&zcd.numEntriesTotal,  2);
+   crc = crc32(crc, (const Bytef *)&zcd.centralDirSize,   4);
+   crc = crc32(crc, (const Bytef *)&zcd.centralDirOffset, 4);
+   crc = crc32(crc, (const Bytef *)&zcd.zipCommentLength, 2);
+
+   return static_cast<uint32_t>(crc);
+}
+
 //
 // ZipFile::readCentralDirEntry
 //
@@ -466,15 +490,154 @@ static int ZIP_LumpSortCB(const void *va, const void *vb)
    return strcmp(lumpA->name, lumpB->name);
 }
 
+//
+// Cached directories. A parsed and sorted directory is stored in the
+// persistent directory cache as a checksum of the end-of-central-directory
+// record and a lump count, then one zipcachedlump_t record per lump, each
+// followed by the lump's name.
+//
+
+struct zipcachedlump_t
+{
+   int32_t  gpFlags;
+   int32_t  flags;
+   int32_t  method;
+   uint32_t compressed;
+   uint32_t size;
+   uint32_t offset;
+   uint32_t nameLength;
+};
+
+//
+// ZipFile::readCachedDirectory
+//
+// Protected method.
+// Rebuild the directory from a cache record. Returns false, leaving the 
+// directory empty, if the record is malformed or was made from a different
+// end-of-central-directory record.
+//
+bool ZipFile::readCachedDirectory(const byte *data, size_t size, uint32_t crc)
+{
+   const byte *rover = data;
+   const byte *end   = data + size;
+   uint32_t    reccrc, count;
+
+   if(size < sizeof(reccrc) + sizeof(count))
+      return false;
+
+   memcpy(&reccrc, rover, sizeof(reccrc));
+   rover += sizeof(reccrc);
+   if(reccrc != crc)
+      return false;
+
+   memcpy(&count, rover, sizeof(count));
+   rover += sizeof(count);
+
+   if(count > size / sizeof(zipcachedlump_t))
+      return false;
+
+   numLumps = static_cast<int>(count);
+   lumps    = ecalloc(ZipLump *, numLumps + 1, sizeof(ZipLump));
+
+   if(!numLumps)
+      return true;
+
+   for(int i = 0; i < numLumps; i++)
+   {
+      ZipLump &lump = lumps[i];
+      zipcachedlump_t rec;
+
+      if(static_cast<size_t>(end - rover) < sizeof(rec))
+         break;
+      memcpy(&rec, rover, sizeof(rec));
+      rover += sizeof(rec);
+
+      if(static_cast<size_t>(end - rover) < rec.nameLength)
+         break;
+
+      lump.name = ecalloc(char *, 1, rec.nameLength + 1);
+      memcpy(lump.name, rover, rec.nameLength);
+      rover += rec.nameLength;
+
+      lump.gpFlags    = rec.gpFlags;
+      lump.flags      = rec.flags;
+      lump.method     = rec.method;
+      lump.compressed = rec.compressed;
+      lump.size       = rec.size;
+      lump.offset     = rec.offset;
+      lump.file       = this;
+
+      if(i == numLumps - 1)
+         return true;
+   }
+
+   // truncated record; throw away what was built
+   for(int i = 0; i < numLumps; i++)
+      efree(lumps[i].name);
+   efree(lumps);
+   lumps    = NULL;
+   numLumps = 0;
+
+   return false;
+}
+
+//
+// ZipFile::storeCachedDirectory
+//
+// Protected method.
+// Save the freshly parsed directory to the persistent cache.
+//
+void ZipFile::storeCachedDirectory(const char *filename, uint32_t crc)
+{
+   size_t size = 2 * sizeof(uint32_t);
+
+   for(int i = 0; i < numLumps; i++)
+      size += sizeof(zipcachedlump_t) + strlen(lumps[i].name);
+
+   ZAutoBuffer buffer(size, false);
+   byte    *rover = buffer.getAs<byte *>();
+   uint32_t count = static_cast<uint32_t>(numLumps);
+
+   memcpy(rover, &crc, sizeof(crc));
+   rover += sizeof(crc);
+   memcpy(rover, &count, sizeof(count));
+   rover += sizeof(count);
+
+   for(int i = 0; i < numLumps; i++)
+   {
+      const ZipLump &lump = lumps[i];
+      zipcachedlump_t rec;
+
+      rec.gpFlags    = lump.gpFlags;
+      rec.flags      = lump.flags;
+      rec.method     = lump.method;
+      rec.compressed = lump.compressed;
+      rec.size       = lump.size;
+      rec.offset     = static_cast<uint32_t>(lump.offset);
+      rec.nameLength = static_cast<uint32_t>(strlen(lump.name));
+
+      memcpy(rover, &rec, sizeof(rec));
+      rover += sizeof(rec);
+      memcpy(rover, lump.name, rec.nameLength);
+      rover += rec.nameLength;
+   }
+
+   W_DirCacheStore(filename, buffer.get(), size);
+}
+
 //
 // ZipFile::readFromFile
 //
-// Extracts the directory from a physical ZIP file.
+// Extracts the directory from a physical ZIP file. If the file's name is
+// given, the directory is looked up in and saved to the directory cache.
 //
-bool ZipFile::readFromFile(FILE *f)
+bool ZipFile::readFromFile(FILE *f, const char *filename)
 {
    InBuffer reader;
    ZIPEndOfCentralDir zcd;
+   const byte *cached;
+   size_t      cachedSize;
+   uint32_t    crc;
 
    // remember our disk file
    file = f;
@@ -485,6 +648,16 @@ bool ZipFile::readFromFile(FILE *f)
    if(!readEndOfCentralDir(reader, zcd))
       return false;
 
+   // try the directory cache before reading the central directory itself
+   crc = ZIP_EndOfCentralDirCRC(zcd);
+   if(filename && (cached = W_DirCacheFind(filename, cachedSize)) &&
+      readCachedDirectory(cached, cachedSize, crc))
+      return true;
+
+   // allocate directory
+   numLumps = zcd.numEntriesTotal;
+   lumps    = ecalloc(ZipLump *, numLumps + 1, sizeof(ZipLump));
+
    // read in the directory
    if(!readCentralDirectory(reader, zcd.centralDirOffset, zcd.centralDirSize))
       return false;
@@ -493,6 +666,9 @@ bool ZipFile::readFromFile(FILE *f)
    if(numLumps > 1)
       qsort(lumps, numLumps, sizeof(ZipLump), ZIP_LumpSortCB);
 
+   if(filename)
+      storeCachedDirectory(filename, crc);
+
    return true;
 }
 
@@ -658,6 +834,271 @@ static void ZIP_ReadDeflated(InBuffer &fin, void *buffer, size_t len)
    reader.read(buffer, len);
 }
 
+//=============================================================================
+//
+// Inflated Lump Cache
+//
+// Inflating a deflated lump costs far more than reading it, and the zone
+// heap throws PU_CACHE copies away freely, so inflated data is kept in a
+// bounded LRU cache of its own. Entries are owned by their ZipLump and are
+// dropped when the ZipFile is destroyed.
+//
+
+struct zipcache_t
+{
+   ZipLump    *lump;
+   byte       *data;
+   zipcache_t *prev; // toward more recently used
+   zipcache_t *next; // toward less recently used
+};
+
+#define ZIPCACHE_DEFAULT 32 // default budget in megabytes
+
+static zipcache_t zipcachehead = { NULL, NULL, &zipcachehead, &zipcachehead };
+static size_t     zipcachesize;    // bytes currently held
+static size_t     zipcachemax;     // budget in bytes
+static bool       zipcacheinit;
+
+//
+// ZIP_cacheBudget
+//
+// -zipcache <megabytes> sets the budget; 0 disables the cache.
+//
+static size_t ZIP_cacheBudget()
+{
+   if(!zipcacheinit)
+   {
+      int p, mb = ZIPCACHE_DEFAULT;
+
+      if((p = M_CheckParm("-zipcache")) && p < myargc - 1)
+         mb = atoi(myargv[p + 1]);
+
+      zipcachemax  = mb > 0 ? static_cast<size_t>(mb) * 1024 * 1024 : 0;
+      zipcacheinit = true;
+   }
+
+   return zipcachemax;
+}
+
+//
+// ZIP_cacheable
+//
+// Only deflated lumps small enough not to flush the whole cache are kept.
+//
+static bool ZIP_cacheable(const ZipLump &lump)
+{
+   size_t budget = ZIP_cacheBudget();
+
+   return lump.method == ZipFile::METHOD_DEFLATE && lump.size > 0 &&
+          lump.size <= budget / 8;
+}
+
+static void ZIP_cacheUnlink(zipcache_t *entry)
+{
+   entry->prev->next = entry->next;
+   entry->next->prev = entry->prev;
+}
+
+static void ZIP_cacheLinkFront(zipcache_t *entry)
+{
+   entry->next = zipcachehead.next;
+   entry->prev = &zipcachehead;
+   zipcachehead.next->prev = entry;
+   zipcachehead.next = entry;
+}
+
+//
+// ZIP_cacheFree
+//
+static void ZIP_cacheFree(zipcache_t *entry)
+{
+   ZIP_cacheUnlink(entry);
+   zipcachesize -= entry->lump->size;
+   entry->lump->cache = NULL;
+   efree(entry->data);
+   efree(entry);
+}
+
+//
+// ZIP_cacheAdd
+//
+// Takes ownership of data, an inflated copy of lump, evicting the least 
+// recently used entries as needed to stay within the budget.
+//
+static void ZIP_cacheAdd(ZipLump &lump, byte *data)
+{
+   zipcache_t *entry;
+
+   if(lump.cache)
+      ZIP_cacheFree(lump.cache);
+
+   while(zipcachesize + lump.size > zipcachemax && 
+         zipcachehead.prev != &zipcachehead)
+      ZIP_cacheFree(zipcachehead.prev);
+
+   entry = estructalloc(zipcache_t, 1);
+   entry->lump = &lump;
+   entry->data = data;
+   ZIP_cacheLinkFront(entry);
+
+   lump.cache    = entry;
+   zipcachesize += lump.size;
+}
+
+//
+// ZIP_cacheLookup
+//
+// Copies the lump out of the cache if present, making it most recently used.
+//
+static bool ZIP_cacheLookup(ZipLump &lump, void *buffer)
+{
+   zipcache_t *entry;
+
+   if(!(entry = lump.cache))
+      return false;
+
+   ZIP_cacheUnlink(entry);
+   ZIP_cacheLinkFront(entry);
+   memcpy(buffer, entry->data, lump.size);
+
+   return true;
+}
+
+//=============================================================================
+//
+// Parallel Prefetch
+//
+// Lumps that will be needed soon can be inflated ahead of time into the
+// cache. Compressed data is read serially on the main thread, since the
+// lumps share a FILE, and then inflated on the worker threads. Nothing here
+// may call I_Error off the main thread, so a bad stream simply isn't
+// cached, and the error is raised by the normal read path later.
+//
+
+struct zipprefetch_t
+{
+   ZipLump *lump;
+   byte    *input;  // compressed data
+   byte    *output; // inflated data
+   bool     ok;
+};
+
+//
+// ZIP_inflateJob
+//
+// Worker callback; inflates one prefetched lump from memory.
+//
+static void ZIP_inflateJob(int jobnum, int threadnum, void *data)
+{
+   zipprefetch_t &job = static_cast<zipprefetch_t *>(data)[jobnum];
+   z_stream zlStream = z_stream();
+
+   job.ok = false;
+
+   if(inflateInit2(&zlStream, -MAX_WBITS) != Z_OK)
+      return;
+
+   zlStream.next_in   = job.input;
+   zlStream.avail_in  = static_cast<uInt>(job.lump->compressed);
+   zlStream.next_out  = job.output;
+   zlStream.avail_out = static_cast<uInt>(job.lump->size);
+
+   int code = inflate(&zlStream, Z_FINISH);
+
+   job.ok = ((code == Z_STREAM_END || code == Z_OK) && !zlStream.avail_out);
+
+   inflateEnd(&zlStream);
+}
+
+//
+// ZIP_PrefetchLumps
+//
+// Inflate the given zip lumps into the cache, in parallel where possible.
+// Lumps that are already cached, not deflated, or too big for the cache are
+// ignored, as is anything past the cache budget.
+//
+void ZIP_PrefetchLumps(ZipLump **lumps, int numlumps)
+{
+   PODCollection<zipprefetch_t> jobs;
+   size_t total = 0;
+
+   if(!ZIP_cacheBudget())
+      return;
+
+   for(int i = 0; i < numlumps; i++)
+   {
+      ZipLump &lump = *lumps[i];
+      InBuffer reader;
+      zipprefetch_t job;
+
+      if(lump.cache || !ZIP_cacheable(lump) || lump.compressed == 0)
+         continue;
+      if(total + lump.size > zipcachemax)
+         break;
+
+      reader.openExisting(lump.file->getFile(), InBuffer::LENDIAN);
+
+      if(lump.flags & ZipFile::LF_CALCOFFSET)
+         lump.setAddress(reader);
+      else if(reader.seek(lump.offset, SEEK_SET))
+         continue;
+
+      job.lump   = &lump;
+      job.input  = emalloc(byte *, lump.compressed);
+      job.output = emalloc(byte *, lump.size);
+      job.ok     = false;
+
+      if(reader.read(job.input, lump.compressed) != lump.compressed)
+      {
+         efree(job.input);
+         efree(job.output);
+         continue;
+      }
+
+      // reserve a placeholder so duplicates in the list are skipped
+      ZIP_cacheAdd(lump, NULL);
+      total += lump.size;
+
+      jobs.add(job);
+   }
+
+   if(jobs.isEmpty())
+      return;
+
+   M_RunJobs(ZIP_inflateJob, &jobs[0], static_cast<int>(jobs.getLength()));
+
+   for(size_t i = 0; i < jobs.getLength(); i++)
+   {
+      zipprefetch_t &job = jobs[i];
+
+      efree(job.input);
+
+      if(!job.lump->cache) // evicted by a later placeholder
+         efree(job.output);
+      else if(job.ok)
+         job.lump->cache->data = job.output;
+      else
+      {
+         ZIP_cacheFree(job.lump->cache);
+         efree(job.output);
+      }
+   }
+}
+
+//
+// ZIP_PurgeCache
+//
+// Drop all cached data belonging to a zip file's lumps.
+//
+static void ZIP_PurgeCache(ZipLump *lumps, int numlumps)
+{
+   for(int i = 0; i < numlumps; i++)
+   {
+      if(lumps[i].cache)
+         ZIP_cacheFree(lumps[i].cache);
+   }
+}
+
 //
 // ZipLump::setAddress
 //
@@ -704,6 +1145,10 @@ void ZipLump::read(void *buffer)
 {
    InBuffer reader;
 
+   // check the inflated lump cache first
+   if(ZIP_cacheLookup(*this, buffer))
+      return;
+
    reader.openExisting(file->getFile(), InBuffer::LENDIAN);
 
    // Calculate an offset beyond the lump's local file header, if such hasn't
@@ -725,6 +1170,12 @@ void ZipLump::read(void *buffer)
       break;
    case ZipFile::METHOD_DEFLATE:
       ZIP_ReadDeflated(reader, buffer, size);
+      if(ZIP_cacheable(*this))
+      {
+         byte *copy = emalloc(byte *, size);
+         memcpy(copy, buffer, size);
+         ZIP_cacheAdd(*this, copy);
+      }
       break;
    default:
       // shouldn't happen; files with other methods are removed from the directory
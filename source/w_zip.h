@@ -36,6 +36,7 @@ class  InBuffer;
 class  WadDirectory;
 struct ZIPEndOfCentralDir;
 class  ZipFile;
+struct zipcache_t;
 
 struct ZipLump
 {
@@ -47,6 +48,7 @@ struct ZipLump
    long      offset;     // file offset
    char     *name;       // full name 
    ZipFile  *file;       // parent zipfile
+   zipcache_t *cache;    // inflated data, if cached
 
    void setAddress(InBuffer &fin);
    void read(void *buffer);
@@ -94,6 +96,8 @@ protected:
    bool readEndOfCentralDir(InBuffer &fin, ZIPEndOfCentralDir &zcd);
    bool readCentralDirEntry(InBuffer &fin, ZipLump &lump, bool &skip);
    bool readCentralDirectory(InBuffer &fin, long offset, uint32_t size);
+   bool readCachedDirectory(const byte *data, size_t size, uint32_t crc);
+   void storeCachedDirectory(const char *filename, uint32_t crc);
 
 public:
    ZipFile() 
@@ -103,7 +107,7 @@ public:
    
    ~ZipFile();
 
-   bool readFromFile(FILE *f);
+   bool readFromFile(FILE *f, const char *filename = NULL);
 
    void checkForWadFiles(WadDirectory &parentDir);
 
@@ -113,6 +117,8 @@ public:
    FILE    *getFile()     const { return file;     }
 };
 
+void ZIP_PrefetchLumps(ZipLump **lumps, int numlumps);
+
 #endif
 
 // EOF
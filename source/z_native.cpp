@@ -97,6 +97,7 @@ typedef struct memblock
   size_t size;
   void **user;
   unsigned char tag;
+  unsigned char pool; // 1-based object pool, 0 if malloc'd
 
 #ifdef INSTRUMENTED
   const char *file;
@@ -121,6 +122,64 @@ static memblock_t *blockbytag[PU_MAX];   // used for tracking all zone blocks
 ZoneObject *ZoneObject::objectbytag[PU_MAX]; // like blockbytag but for objects
 void       *ZoneObject::newalloc;            // most recent ZoneObject alloc
 
+//=============================================================================
+//
+// Object Pools
+//
+// Level-lifetime ZoneObjects (mobjs, sector movers, ACS threads and the other
+// thinkers) are created and destroyed at a very high rate during play. Rather
+// than sending each of them through malloc, they are carved out of slabs that
+// are kept on per-size-class free lists. Pooled blocks keep a normal
+// memblock_t header so that tag reflection continues to work, but they are
+// not linked into the blockbytag chains; their lifetime is managed by the
+// ZoneObject tag chains, and a pool's slabs are given back to the system once
+// a level purge has emptied it.
+//
+
+#define ZPOOL_GRANULARITY 16
+#define ZPOOL_MAXSIZE     2048
+#define ZPOOL_NUMCLASSES  (ZPOOL_MAXSIZE / ZPOOL_GRANULARITY)
+#define ZPOOL_SLABBYTES   65536
+#define ZPOOL_MINSLOTS    8
+
+struct zpoolslab_t
+{
+   zpoolslab_t *next;
+};
+
+struct zonepool_t
+{
+   zpoolslab_t *slabs;    // slabs owned by this pool
+   memblock_t  *freelist; // free slots, linked through memblock_t::next
+   int numslabs;          // number of slabs allocated
+   int total;             // total slots in all slabs
+   int used;              // slots currently in use
+   int peak;              // high water mark of used
+};
+
+static zonepool_t zonepools[ZPOOL_NUMCLASSES];
+static bool       zonepoolsoff; // -nozonepool
+
+// slab header is padded so that slots keep the 16-byte block alignment
+static const size_t slabheader_size = (sizeof(zpoolslab_t) + 15) & ~15;
+
+//=============================================================================
+//
+// Level Arena
+//
+// Static level geometry (vertexes, segs, sectors, lines, sides, nodes, the
+// blockmap and so on) is bump-allocated out of a few large PU_LEVEL chunks
+// instead of living in many separate blocks. The geometry is then contiguous
+// in memory, and a level purge only has a handful of blocks to walk. Arena
+// allocations cannot be freed individually.
+//
+
+#define ZARENA_CHUNKSIZE (1024 * 1024)
+
+static byte  *arenachunk; // current chunk, or NULL if none
+static size_t arenaused;  // bytes used in current chunk
+static size_t arenasize;  // size of current chunk
+
 //=============================================================================
 //
 // Debug Macros
@@ -295,9 +354,228 @@ void Z_Init(void)
 {   
    atexit(Z_Close);            // exit handler
 
+   // object pools can be disabled for debugging
+   zonepoolsoff = !!M_CheckParm("-nozonepool");
+
    Z_LogPrintf("Initialized zone heap (using native implementation)\n");
 }
 
+//=============================================================================
+//
+// Object Pool Routines
+//
+
+//
+// Z_poolAddSlab
+//
+// Allocates a new slab for the given size class and threads all of its slots
+// onto the pool's free list.
+//
+static void Z_poolAddSlab(int cls, const char *file, int line)
+{
+   zonepool_t  &pool     = zonepools[cls];
+   size_t       slotsize = header_size + (cls + 1) * ZPOOL_GRANULARITY;
+   int          numslots = int((ZPOOL_SLABBYTES - slabheader_size) / slotsize);
+   size_t       slabsize;
+   zpoolslab_t *slab;
+   byte        *slot;
+
+   if(numslots < ZPOOL_MINSLOTS)
+      numslots = ZPOOL_MINSLOTS;
+
+   slabsize = slabheader_size + numslots * slotsize;
+
+   if(!(slab = (zpoolslab_t *)(malloc(slabsize))))
+   {
+      if(blockbytag[PU_CACHE])
+      {
+         Z_FreeTags(PU_CACHE, PU_CACHE);
+         slab = (zpoolslab_t *)(malloc(slabsize));
+      }
+   }
+
+   if(!slab)
+   {
+      I_FatalError(I_ERR_KILL, "Z_poolAddSlab: Failure trying to allocate %u bytes\n"
+                               "Source: %s:%d\n", (unsigned int)slabsize, file, line);
+   }
+
+   slab->next = pool.slabs;
+   pool.slabs = slab;
+
+   // thread the slots in address order
+   slot = (byte *)slab + slabheader_size + (numslots - 1) * slotsize;
+   for(int i = 0; i < numslots; i++, slot -= slotsize)
+   {
+      memblock_t *block = (memblock_t *)slot;
+
+      block->next = pool.freelist;
+      block->prev = NULL;
+      block->user = NULL;
+      block->size = 0;
+      block->tag  = PU_FREE;
+      block->pool = (unsigned char)(cls + 1);
+      IDCHECK(block->id = 0);
+
+      pool.freelist = block;
+   }
+
+   pool.numslabs++;
+   pool.total += numslots;
+}
+
+//
+// Z_poolAlloc
+//
+// Takes a zero-filled slot from the pool serving the given size.
+//
+static void *Z_poolAlloc(size_t size, int tag, const char *file, int line)
+{
+   int         cls  = int((size - 1) / ZPOOL_GRANULARITY);
+   zonepool_t &pool = zonepools[cls];
+   memblock_t *block;
+   byte       *ret;
+
+   if(!pool.freelist)
+      Z_poolAddSlab(cls, file, line);
+
+   block         = pool.freelist;
+   pool.freelist = block->next;
+
+   if(++pool.used > pool.peak)
+      pool.peak = pool.used;
+
+   block->next = NULL;
+   block->prev = NULL;
+   block->size = size;
+   block->user = NULL;
+   block->tag  = tag;
+
+   INSTRUMENT(memorybytag[tag] += block->size);
+   INSTRUMENT(block->file = file);
+   INSTRUMENT(block->line = line);
+
+   IDCHECK(block->id = ZONEID);
+
+   ret = (byte *)block + header_size;
+   memset(ret, 0, size);
+
+   Z_LogPrintf("* %p = Z_poolAlloc(size=%lu, tag=%d, source=%s:%d)\n",
+               ret, size, tag, file, line);
+
+   return ret;
+}
+
+//
+// Z_poolRelease
+//
+// Puts a pooled block back on its pool's free list. The block has already
+// been marked free by Z_Free.
+//
+static void Z_poolRelease(memblock_t *block)
+{
+   zonepool_t &pool = zonepools[block->pool - 1];
+
+   block->next   = pool.freelist;
+   pool.freelist = block;
+   --pool.used;
+}
+
+//
+// Z_poolTrim
+//
+// Gives the slabs of every empty pool back to the system. Called after a
+// purge that covered PU_LEVEL, at which point all pooled thinkers are gone.
+//
+static void Z_poolTrim()
+{
+   for(int cls = 0; cls < ZPOOL_NUMCLASSES; cls++)
+   {
+      zonepool_t &pool = zonepools[cls];
+
+      if(pool.used || !pool.slabs)
+         continue;
+
+      while(pool.slabs)
+      {
+         zpoolslab_t *next = pool.slabs->next;
+         free(pool.slabs);
+         pool.slabs = next;
+      }
+
+      pool.freelist = NULL;
+      pool.numslabs = 0;
+      pool.total    = 0;
+   }
+}
+
+//
+// Z_GetPoolStats
+//
+// Fills in occupancy statistics for every size class that currently owns at
+// least one slab, and returns the number of entries written.
+//
+int Z_GetPoolStats(zpoolstats_t *stats, int maxstats)
+{
+   int count = 0;
+
+   for(int cls = 0; cls < ZPOOL_NUMCLASSES && count < maxstats; cls++)
+   {
+      const zonepool_t &pool = zonepools[cls];
+
+      if(!pool.slabs)
+         continue;
+
+      stats[count].slotsize = (cls + 1) * ZPOOL_GRANULARITY;
+      stats[count].numslabs = pool.numslabs;
+      stats[count].total    = pool.total;
+      stats[count].used     = pool.used;
+      stats[count].peak     = pool.peak;
+      ++count;
+   }
+
+   return count;
+}
+
+//=============================================================================
+//
+// Level Arena Routines
+//
+
+//
+// Z_LevelCalloc
+//
+// Returns zero-filled memory from the level arena. Requests of half a chunk
+// or more are given a dedicated block so that they do not waste the rest of
+// the current chunk. Everything is released by Z_FreeTags on PU_LEVEL.
+//
+void *(Z_LevelCalloc)(size_t n1, size_t n2, const char *file, int line)
+{
+   size_t size = ((n1 * n2) + 15) & ~15;
+   byte  *ret;
+
+   if(!size)
+      return NULL;
+
+   if(size >= ZARENA_CHUNKSIZE / 2)
+      return memset((Z_Malloc)(size, PU_LEVEL, NULL, file, line), 0, size);
+
+   if(!arenachunk || arenasize - arenaused < size)
+   {
+      arenachunk = (byte *)((Z_Malloc)(ZARENA_CHUNKSIZE, PU_LEVEL, NULL, file, line));
+      arenasize  = ZARENA_CHUNKSIZE;
+      arenaused  = 0;
+   }
+
+   ret = arenachunk + arenaused;
+   arenaused += size;
+
+   Z_LogPrintf("* %p = Z_LevelCalloc(size=%lu, source=%s:%d)\n", 
+               ret, size, file, line);
+
+   return memset(ret, 0, size);
+}
+
 //=============================================================================
 //
 // Core Memory Management Routines
@@ -352,6 +630,7 @@ void *(Z_Malloc)(size_t size, int tag, void **user, const char *file, int line)
    
    block->tag  = tag;           // tag
    block->user = user;          // user
+   block->pool = 0;             // not from an object pool
    
    ret = ((byte *) block + header_size);
    if(user)                     // if there is a user
@@ -410,6 +689,14 @@ void (Z_Free)(void *p, const char *file, int line)
       if(block->user)            // Nullify user if one exists
          *block->user = NULL;
 
+      // pooled blocks go back onto their free list
+      if(block->pool)
+      {
+         Z_poolRelease(block);
+         Z_LogPrintf("* Z_Free(p=%p, file=%s:%d)\n", p, file, line);
+         return;
+      }
+
       if((*block->prev = block->next))
          block->next->prev = block->prev;
          
@@ -428,6 +715,15 @@ void (Z_FreeTags)(int lowtag, int hightag, const char *file, int line)
 
    // haleyjd 03/30/2011: delete ZoneObjects of the same tags as well
    ZoneObject::FreeTags(lowtag, hightag);
+
+   // level objects are gone; release emptied pools, and forget the level
+   // arena, whose chunks are about to be freed below.
+   if(lowtag <= PU_LEVEL && hightag >= PU_LEVEL)
+   {
+      Z_poolTrim();
+      arenachunk = NULL;
+      arenaused  = arenasize = 0;
+   }
    
    if(lowtag <= PU_FREE)
       lowtag = PU_FREE+1;
@@ -483,6 +779,15 @@ void (Z_ChangeTag)(void *ptr, int tag, const char *file, int line)
    if(block->tag == PU_PERMANENT)
       return;
 
+   // pooled blocks are not on any tag chain
+   if(block->pool)
+   {
+      INSTRUMENT(memorybytag[block->tag] -= block->size);
+      INSTRUMENT(memorybytag[tag] += block->size);
+      block->tag = tag;
+      return;
+   }
+
    if((*block->prev = block->next))
       block->next->prev = block->prev;
    if((block->next = blockbytag[tag]))
@@ -534,6 +839,15 @@ void *(Z_Realloc)(void *ptr, size_t n, int tag, void **user,
    if(block->tag == PU_PERMANENT)
       tag = PU_PERMANENT;
 
+   // pooled blocks cannot grow in place; move to the heap
+   if(block->pool)
+   {
+      p = (Z_Malloc)(n, tag, user, file, line);
+      memcpy(p, ptr, n < block->size ? n : block->size);
+      (Z_Free)(ptr, file, line);
+      return p;
+   }
+
    // nullify current user, if any
    if(block->user)
       *(block->user) = NULL;
@@ -998,6 +1312,10 @@ void *ZoneObject::operator new (size_t size)
 //
 void *ZoneObject::operator new(size_t size, int tag, void **user)
 {
+   // ownerless level objects come from the object pools
+   if(tag == PU_LEVEL && !user && size && size <= ZPOOL_MAXSIZE && !zonepoolsoff)
+      return (newalloc = Z_poolAlloc(size, tag, __FILE__, __LINE__));
+
    return (newalloc = Z_Calloc(1, size, tag, user));
 }
 
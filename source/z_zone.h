@@ -110,6 +110,7 @@ void *(Z_Realloca)(void *ptr, size_t n, const char *file, int line);
 char *(Z_Strdupa)(const char *s, const char *file, int line);
 void  (Z_CheckHeap)(const char *, int);   
 int   (Z_CheckTag)(void *, const char *, int);
+void *(Z_LevelCalloc)(size_t n1, size_t n2, const char *, int);
 
 void *Z_SysMalloc(size_t size);
 void *Z_SysCalloc(size_t n1, size_t n2);
@@ -128,6 +129,7 @@ void  Z_SysFree(void *p);
 #define Z_Strdupa(a)       (Z_Strdupa)  (a,      __FILE__,__LINE__)
 #define Z_CheckHeap()      (Z_CheckHeap)(        __FILE__,__LINE__)
 #define Z_CheckTag(a)      (Z_CheckTag) (a,      __FILE__,__LINE__)
+#define Z_LevelCalloc(a,b) (Z_LevelCalloc)(a,b,  __FILE__,__LINE__)
 
 #define emalloc(type, n) \
    static_cast<type>((Z_Malloc)(n, PU_STATIC, 0, __FILE__, __LINE__))
@@ -150,6 +152,13 @@ void  Z_SysFree(void *p);
 #define estructalloctag(type, n, tag) \
    static_cast<type *>((Z_Calloc)(n, sizeof(type), tag, 0, __FILE__, __LINE__))
 
+// Allocations from the level arena; see Z_LevelCalloc
+#define ecalloclevel(type, n1, n2) \
+   static_cast<type>((Z_LevelCalloc)(n1, n2, __FILE__, __LINE__))
+
+#define estructalloclevel(type, n) \
+   static_cast<type *>((Z_LevelCalloc)(n, sizeof(type), __FILE__, __LINE__))
+
 #define estrdup(s) (Z_Strdup)(s, PU_STATIC, 0, __FILE__, __LINE__)
 
 #define efree(p)   (Z_Free)(p, __FILE__, __LINE__)
@@ -174,6 +183,18 @@ void Z_PrintZoneHeap();
 
 void Z_DumpCore();
 
+// Object pool occupancy
+struct zpoolstats_t
+{
+   size_t slotsize; // object size served by this pool
+   int    numslabs; // number of slabs allocated
+   int    total;    // total slots
+   int    used;     // slots in use
+   int    peak;     // most slots ever in use at once
+};
+
+int Z_GetPoolStats(zpoolstats_t *stats, int maxstats);
+
 //
 // ZoneObject Class
 //